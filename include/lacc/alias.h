@@ -0,0 +1,42 @@
+#ifndef ALIAS_H
+#define ALIAS_H
+#if !defined(INTERNAL) || !defined(EXTERNAL)
+# error Missing amalgamation macros
+#endif
+
+#include "ir.h"
+
+/*
+ * Find symbols in function definition which can be accessed other than
+ * by name; local variables having their address taken, and variables
+ * with static storage duration. Pointers are traced back to the object
+ * or parameter they are derived from, following single assignments.
+ *
+ * Bitmasks are computed for symbols enumerated for dataflow analysis,
+ * with non-zero index.
+ */
+INTERNAL void alias_analysis(struct definition *def);
+
+/*
+ * Set of symbols which may be read or written by dereferencing var, as
+ * bitmask of symbol indices.
+ */
+INTERNAL unsigned long alias_set(struct var var);
+
+/*
+ * Set of symbols which may be read or written by a function call,
+ * through pointers escaping to the callee or by global name.
+ */
+INTERNAL unsigned long call_alias_set(void);
+
+/*
+ * Determine whether two memory references, each either DIRECT or DEREF,
+ * may access overlapping memory. References are disjoint if they are
+ * derived from different objects, or from different parameters where
+ * at least one is restrict qualified and never modified. With strict
+ * aliasing, accesses of incompatible types other than char are also
+ * disjoint.
+ */
+INTERNAL int may_alias(struct var a, struct var b);
+
+#endif
@@ -19,14 +19,41 @@ enum cstd {
     STD_C11
 };
 
+/*
+ * Visibility of symbols with external linkage, when linked into a
+ * shared object. Hidden and internal symbols are only referenced from
+ * within the same module.
+ */
+enum visibility {
+    VISIBILITY_UNSPECIFIED = 0,
+    VISIBILITY_DEFAULT,
+    VISIBILITY_HIDDEN,
+    VISIBILITY_INTERNAL,
+    VISIBILITY_PROTECTED
+};
+
 /* Global information about translation unit. */
 INTERNAL struct context {
     int errors;
     int verbose;
     int suppress_warning;
+    int align_functions;             /* function alignment in bytes */
+    int align_loops;                 /* loop header alignment in bytes */
     unsigned int pic : 1;            /* position independent code */
+    unsigned int strict_aliasing : 1;
+    unsigned int no_plt : 1;         /* call through GOT instead of PLT */
+    unsigned int function_sections : 1; /* .text.<name> per function */
+    unsigned int data_sections : 1;  /* .data.<name> per object */
+    unsigned int fast_math : 1;      /* define __FAST_MATH__ */
+    unsigned int no_honor_nans : 1;  /* assume no NaN operands */
+    unsigned int associative_math : 1; /* reassociate floating point */
+    unsigned int reciprocal_math : 1; /* divide by multiplying inverse */
+    unsigned int popcnt : 1;         /* target has popcnt */
+    unsigned int lzcnt : 1;          /* target has lzcnt */
+    unsigned int bmi : 1;            /* target has tzcnt */
     enum target target;
     enum cstd standard;
+    enum visibility visibility;      /* default for definitions */
 } context;
 
 /*
@@ -36,7 +63,8 @@ INTERNAL struct context {
 INTERNAL void verbose(const char *, ...);
 
 /*
- * Output warning to stderr. No-op if context.suppress_warning is set.
+ * Output warning to stderr. No-op if context.suppress_warning is set,
+ * or when reading a system header.
  */
 INTERNAL void warning(const char *, ...);
 
@@ -90,6 +90,11 @@ struct expression {
         IR_OP_VA_ARG, /* va_arg(l, T) */
         IR_OP_NOT,    /* ~l     */
         IR_OP_NEG,    /* -l     */
+        IR_OP_POPCNT, /* popcount(l) */
+        IR_OP_CLZ,    /* clz(l) */
+        IR_OP_CTZ,    /* ctz(l) */
+        IR_OP_FFS,    /* ffs(l) */
+        IR_OP_BSWAP,  /* bswap(l) */
         IR_OP_ADD,    /* l + r  */
         IR_OP_SUB,    /* l - r  */
         IR_OP_MUL,    /* l * r  */
@@ -124,15 +129,23 @@ struct expression {
  * Variable length arrays are allocated when declared, and deallocated
  * all at once when exiting function scope. Expression holds the size
  * in bytes to be allocated to VLA t.
+ *
+ * Conditional move assigns a source operand to t only if the scalar
+ * condition expr is true, leaving t unchanged otherwise. These are not
+ * created by the parser, only by optimization replacing branches. The
+ * source is stored in the function definition, at the given index.
  */
 struct statement {
     enum sttype {
-        IR_EXPR,      /* (expr)              */
-        IR_PARAM,     /* param (expr)        */
-        IR_VA_START,  /* va_start(expr)      */
-        IR_ASSIGN,    /* t = expr            */
-        IR_VLA_ALLOC  /* vla_alloc t, (expr) */
+        IR_EXPR,      /* (expr)                 */
+        IR_PARAM,     /* param (expr)           */
+        IR_VA_START,  /* va_start(expr)         */
+        IR_PREFETCH,  /* prefetch t, (expr)     */
+        IR_ASSIGN,    /* t = expr               */
+        IR_VLA_ALLOC, /* vla_alloc t, (expr)    */
+        IR_CMOV       /* if (expr) t = [source] */
     } st;
+    int source;
     unsigned long out;
     struct var t;
     struct expression expr;
@@ -159,12 +172,21 @@ struct block {
 
     /*
      * Branch targets.
-     * - (NULL, NULL): Terminal node, return expr from function.
+     * - (NULL, NULL): Terminal node, return expr from function, unless
+     *                 indirect is set.
      * - (x, NULL)   : Unconditional jump; break, continue, goto, loop.
      * - (x, y)      : False and true branch targets, respectively.
      */
     struct block *jump[2];
 
+    /*
+     * Toggle computed goto, jumping to the address given by expr. Any
+     * block with label address taken is a possible successor, and all
+     * of them are listed as targets when the function is parsed.
+     */
+    int indirect;
+    array_of(struct block *) targets;
+
     /*
      * Toggle last statement was return, meaning expr is valid. There
      * are cases where we reach end of control in a non-void function,
@@ -176,12 +198,32 @@ struct block {
     /* Used to mark nodes as visited during graph traversal. */
     enum color {
         WHITE,
+        GRAY,
         BLACK
     } color;
 
+    /*
+     * Static prediction of which successor of a conditional branch is
+     * most likely to be taken, used for block placement.
+     */
+    enum prediction {
+        LIKELY_NONE,
+        LIKELY_FALSE,
+        LIKELY_TRUE
+    } likely;
+
+    /*
+     * Outcome of branch on value of __builtin_expect, taking precedence
+     * over static prediction.
+     */
+    enum prediction expect;
+
     /* Liveness at the start and end of the block. */
     unsigned long in;
     unsigned long out;
+
+    /* Number of incoming edges, computed by the optimizer. */
+    int predecessors;
 };
 
 /*
@@ -235,6 +277,12 @@ struct definition {
      * everything at the end.
      */
     array_of(struct block *) nodes;
+
+    /*
+     * Source operands of conditional moves, which are rare enough to
+     * not be worth storing in every statement.
+     */
+    array_of(struct var) sources;
 };
 
 /* Convert variable to no-op IR_OP_CAST expression. */
@@ -261,4 +309,10 @@ INTERNAL struct var var_numeric(Type type, union value val);
  */
 INTERNAL struct symbol *create_label(struct definition *def);
 
+/*
+ * Create temporary variable, and associate it with the given
+ * definition.
+ */
+INTERNAL struct var create_var(struct definition *def, Type type);
+
 #endif
@@ -4,6 +4,7 @@
 # error Missing amalgamation macros
 #endif
 
+#include "context.h"
 #include "string.h"
 #include "token.h"
 #include "type.h"
@@ -40,9 +41,13 @@ struct symbol {
 
     unsigned int symtype : 8;
     unsigned int linkage : 8;
-    unsigned int referenced : 1; /* Mark symbol as used. */
+    unsigned int referenced : 1; /* Used, or label address taken. */
     unsigned int slot : 7;       /* Register allocation slot. */
     unsigned int index : 8;      /* Enumeration used in optimization. */
+    unsigned int visibility : 3; /* Given by attribute, if any. */
+    unsigned int hot : 1;        /* Function with hot attribute. */
+    unsigned int cold : 1;       /* Function with cold attribute. */
+    unsigned int assume_aligned : 4; /* Log2 of pointer alignment. */
 
     /*
      * Tag to disambiguate temporaries, strings, constants, labels, and
@@ -106,6 +111,18 @@ INTERNAL const char *sym_name(const struct symbol *sym);
  */
 INTERNAL int is_temporary(const struct symbol *sym);
 
+/*
+ * Get visibility of symbol with external linkage, from attribute or
+ * the default for definitions given on command line.
+ */
+INTERNAL enum visibility sym_visibility(const struct symbol *sym);
+
+/*
+ * Get name of text section for function definition. Functions with hot
+ * or cold attribute are placed in .text.hot or .text.unlikely.
+ */
+INTERNAL const char *sym_text_section(const struct symbol *sym);
+
 /*
  * Create a floating point constant, which can be stored and loaded from
  * memory.
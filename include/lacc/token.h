@@ -65,6 +65,7 @@ enum token_type {
     RESTRICT,
     ALIGNOF,
     BOOL,
+    ATTRIBUTE,
 
     STATIC_ASSERT = BOOL + 6,
 
@@ -8,20 +8,27 @@
 #include "x86_64/assemble.h"
 #include "x86_64/elf.h"
 #include "x86_64/instr.h"
+#include <lacc/alias.h>
 #include <lacc/context.h>
 
 #include <assert.h>
 #include <limits.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
 
 static int (*enter_context)(const struct symbol *);
 static int (*emit_instruction)(struct instruction);
 static int (*emit_data)(struct immediate);
+static int (*emit_alignment)(int);
 static int (*flush_backend)(void);
 
 /* Current function definition being compiled. */
 static struct definition *definition;
 
+/* Label of epilogue shared by return blocks, until it is emitted. */
+static const struct symbol *epilogue;
+
 /* Values from va_list initialization. */
 static struct {
     int gp_offset;
@@ -33,12 +40,58 @@ static struct {
 /* Store incoming PARAM operations before CALL. */
 static array_of(struct var) func_args;
 
+/*
+ * Address arithmetic folded into memory operands, computing base +
+ * index * scale + disp. Base is a pointer, or the address of a symbol.
+ * Index is a 64 bit integer scaled by 1, 2, 4 or 8, not present if
+ * scale is 0.
+ */
+struct address_mode {
+    enum {
+        MODE_NONE,      /* Compile statement as normal. */
+        MODE_SKIP,      /* Statement is folded into a later address. */
+        MODE_LEA,       /* Compute address with lea instruction. */
+        MODE_FOLD       /* Pointer is only dereferenced in next statement. */
+    } kind;
+    int scale;
+    int disp;
+    int folded;
+    struct var base;
+    struct var index;
+};
+
+/* Address mode of each statement in block being compiled. */
+static array_of(struct address_mode) modes;
+
+/*
+ * Pointer which is not computed, but is dereferenced directly using
+ * the address mode of its definition.
+ */
+static const struct symbol *folded_pointer;
+static struct address_mode folded_address;
+
+/*
+ * Number of reads and writes of each temporary in the function being
+ * compiled, indexed by symbol number starting from first_temporary.
+ * Counts saturate at 2, only distinguishing single use.
+ */
+struct temp_usage {
+    unsigned char reads;
+    unsigned char writes;
+};
+
+static array_of(struct temp_usage) temp_usage;
+static int first_temporary;
+
 /*
  * Use callee-saved registers %rbx, %r12, %r13, %r14 and %r15 for
  * temporary integer values.
  */
 #define TEMP_INT_REGS (sizeof(temp_int_reg) / sizeof(temp_int_reg[0]))
 
+/* Largest object copied with inline moves, instead of calling memcpy. */
+#define INLINE_COPY_MAX 128
+
 static enum reg
     temp_int_reg[] = {BX, R12, R13, R14, R15},
     param_int_reg[] = {DI, SI, DX, CX, R8, R9},
@@ -55,6 +108,25 @@ static int int_regs_used, sse_regs_used;
 /* Number of registers pushed to x87 stack. */
 static int x87_stack;
 
+/*
+ * Variables known to be held in registers after being loaded from or
+ * stored to memory, indexed by register. Loads of the same variable
+ * can reuse the register instead of reading memory again. Values are
+ * only tracked within a block, and are invalidated by any instruction
+ * writing to the register, or to memory the variable might occupy.
+ */
+struct reg_value {
+    struct var var;
+    struct address addr;
+    enum opcode opcode;
+    int w;
+};
+
+static struct reg_value reg_values[XMM15 + 1];
+
+/* Target of store through pointer currently being emitted, if known. */
+static const struct var *pointer_store;
+
 /*
  * Convert x87 register (ST0 through ST7) to stack relative position,
  * where top of stack means ST0.
@@ -96,7 +168,128 @@ static void relase_regs(void)
     sse_regs_used = 0;
 }
 
-static void compile_block(struct block *block, Type type, int stack);
+static void clear_reg_values(void)
+{
+    int r;
+
+    for (r = AX; r <= XMM15; ++r) {
+        reg_values[r].var.symbol = NULL;
+    }
+}
+
+static void invalidate_reg(enum reg r)
+{
+    if (r <= XMM15) {
+        reg_values[r].var.symbol = NULL;
+    }
+}
+
+/*
+ * Invalidate register values which can be stored in memory written to.
+ * Stack and static addresses are compared directly. Stores through
+ * pointers are checked with alias analysis, where an unknown target is
+ * assumed to be able to write anything having its address taken.
+ */
+static void invalidate_memory(struct memory mem)
+{
+    int r, direct;
+    struct var any = {0};
+    struct reg_value *val;
+
+    any.kind = DEREF;
+    any.type = basic_type__char;
+    direct = mem.addr.type == ADDR_NORMAL
+        && !mem.addr.offset
+        && (mem.addr.base == BP || (mem.addr.base == IP && mem.addr.sym));
+
+    for (r = AX; r <= XMM15; ++r) {
+        val = &reg_values[r];
+        if (!val->var.symbol)
+            continue;
+
+        if (direct) {
+            if (mem.addr.base != val->addr.base
+                || mem.addr.sym != val->addr.sym
+                || mem.addr.disp >= val->addr.disp + (int) size_of(val->var.type)
+                || val->addr.disp >= mem.addr.disp + mem.w)
+                continue;
+        } else if (!may_alias(val->var, pointer_store ? *pointer_store : any)) {
+            continue;
+        }
+
+        val->var.symbol = NULL;
+    }
+}
+
+/*
+ * Invalidate register values affected by instruction. Jumps do not
+ * change any values, but all are forgotten when entering a label.
+ */
+static void clobber(struct instruction instr)
+{
+    switch (instr.opcode) {
+    case INSTR_CMP:
+    case INSTR_TEST:
+    case INSTR_UCOMISS:
+    case INSTR_UCOMISD:
+    case INSTR_PUSH:
+    case INSTR_JMP:
+    case INSTR_JA:
+    case INSTR_JNA:
+    case INSTR_JP:
+    case INSTR_JG:
+    case INSTR_JNG:
+    case INSTR_JE:
+    case INSTR_JS:
+    case INSTR_JAE:
+    case INSTR_JNAE:
+    case INSTR_JGE:
+    case INSTR_JNGE:
+    case INSTR_JNE:
+    case INSTR_JNS:
+        return;
+    case INSTR_CALL:
+    case INSTR_LEAVE:
+    case INSTR_RET:
+    case INSTR_REP_MOVSQ:
+        clear_reg_values();
+        return;
+    case INSTR_CDQ:
+    case INSTR_CQO:
+        invalidate_reg(DX);
+        return;
+    case INSTR_MUL:
+    case INSTR_IMUL:
+    case INSTR_DIV:
+    case INSTR_IDIV:
+        invalidate_reg(AX);
+        invalidate_reg(DX);
+        break;
+    default:
+        break;
+    }
+
+    switch (instr.optype) {
+    case OPT_REG_REG:
+    case OPT_MEM_REG:
+    case OPT_IMM_REG:
+        invalidate_reg(instr.dest.reg.r);
+        break;
+    case OPT_REG_MEM:
+    case OPT_IMM_MEM:
+        invalidate_memory(instr.dest.mem);
+        break;
+    case OPT_REG:
+        invalidate_reg(instr.source.reg.r);
+        break;
+    case OPT_MEM:
+        invalidate_memory(instr.source.mem);
+        break;
+    default:
+        clear_reg_values();
+        break;
+    }
+}
 
 static void emit(enum opcode opcode, enum instr_optype optype, ...)
 {
@@ -141,9 +334,20 @@ static void emit(enum opcode opcode, enum instr_optype optype, ...)
     }
 
     va_end(args);
+    clobber(instr);
     emit_instruction(instr);
 }
 
+/*
+ * Control can reach a label from multiple places, so nothing is known
+ * about values in registers.
+ */
+static int enter_label(const struct symbol *label)
+{
+    clear_reg_values();
+    return enter_context(label);
+}
+
 static int is_standard_register_width(int width)
 {
     return width == 1
@@ -170,16 +374,29 @@ static int displacement_from_offset(size_t offset)
     return (int) offset;
 }
 
+/*
+ * External symbols are accessed through GOT or PLT in position
+ * independent code, as they can be defined in another module. Hidden
+ * and internal symbols are always in the same module, and referenced
+ * directly.
+ */
 static int is_global_offset(const struct symbol *sym)
 {
-    return context.pic && sym->linkage == LINK_EXTERN;
+    if (!context.pic || sym->linkage != LINK_EXTERN)
+        return 0;
+
+    switch (sym_visibility(sym)) {
+    case VISIBILITY_HIDDEN:
+    case VISIBILITY_INTERNAL:
+        return 0;
+    default:
+        return 1;
+    }
 }
 
 static int is_register_allocated(struct var v)
 {
-    return v.kind == DIRECT
-        && is_temporary(v.symbol)
-        && v.symbol->slot != 0;
+    return v.kind == DIRECT && v.symbol->slot != 0;
 }
 
 static enum reg allocated_register(struct var v)
@@ -192,6 +409,18 @@ static enum reg allocated_register(struct var v)
     return 0;
 }
 
+static int is_temp_int_reg(enum reg r)
+{
+    int i;
+
+    for (i = 0; i < TEMP_INT_REGS; ++i) {
+        if (temp_int_reg[i] == r)
+            return 1;
+    }
+
+    return 0;
+}
+
 static struct immediate value_of(struct var var, int w)
 {
     struct immediate imm = {0};
@@ -230,7 +459,7 @@ static struct address address_of(struct var var)
         assert(var.kind == DIRECT || var.kind == ADDRESS);
         switch (var.symbol->linkage) {
         case LINK_EXTERN:
-            assert(!context.pic);
+            assert(!is_global_offset(var.symbol));
         case LINK_INTERN:
             addr.base = IP;
             addr.disp = displacement_from_offset(var.offset);
@@ -252,6 +481,81 @@ static struct memory location_of(struct var var, int w)
     return location(address_of(var), w);
 }
 
+/*
+ * Determine if variable can be tracked in register after loading it
+ * from memory.
+ */
+static int is_reg_value(struct var var)
+{
+    return var.kind == DIRECT
+        && !is_field(var)
+        && !is_volatile(var.type)
+        && is_scalar(var.type)
+        && !is_long_double(var.type)
+        && !is_register_allocated(var)
+        && !is_global_offset(var.symbol);
+}
+
+static void set_reg_value(enum reg r, struct var var, enum opcode opcode, int w)
+{
+    struct reg_value *val;
+
+    assert(r <= XMM15);
+    assert(is_reg_value(var));
+    val = &reg_values[r];
+    val->var = var;
+    val->addr = address_of(var);
+    val->opcode = opcode;
+    val->w = w;
+}
+
+/*
+ * Find register holding the result of loading variable with the given
+ * instruction and width, preferring register r. Return 0 if none.
+ */
+static enum reg find_reg_value(
+    struct var var,
+    enum opcode opcode,
+    int w,
+    enum reg r)
+{
+    int ax, found;
+    const struct reg_value *val;
+
+    found = 0;
+    for (ax = AX; ax <= XMM15; ++ax) {
+        val = &reg_values[ax];
+        if (val->var.symbol == var.symbol
+            && val->var.offset == var.offset
+            && size_of(val->var.type) == size_of(var.type)
+            && val->opcode == opcode
+            && val->w == w)
+        {
+            if (ax == r)
+                return r;
+            if (!found) {
+                found = ax;
+            }
+        }
+    }
+
+    return found;
+}
+
+/* Copy loaded value to destination register, unless already there. */
+static void copy_reg_value(enum reg ax, struct registr dest)
+{
+    if (ax == dest.r)
+        return;
+
+    if (dest.r >= XMM0) {
+        emit(dest.w == 4 ? INSTR_MOVSS : INSTR_MOVSD,
+            OPT_REG_REG, reg(ax, dest.w), dest);
+    } else {
+        emit(INSTR_MOV, OPT_REG_REG, reg(ax, dest.w), dest);
+    }
+}
+
 static struct address address(int disp, enum reg base, enum reg off, int mult)
 {
     struct address addr = {0};
@@ -290,6 +594,21 @@ static struct immediate addr(const struct symbol *sym)
     return imm;
 }
 
+/*
+ * Call function by name. External functions in position independent
+ * code are called through the PLT, or with -fno-plt indirectly through
+ * the address stored in GOT.
+ */
+static void call_function(const struct symbol *sym)
+{
+    assert(is_function(sym->type));
+    if (context.no_plt && is_global_offset(sym)) {
+        emit(INSTR_CALL, OPT_MEM, location(got(sym), 8));
+    } else {
+        emit(INSTR_CALL, OPT_IMM, addr(sym));
+    }
+}
+
 static struct immediate constant(long n, int w)
 {
     struct immediate imm = {0};
@@ -300,6 +619,107 @@ static struct immediate constant(long n, int w)
     return imm;
 }
 
+/*
+ * Load 64 bit variable to register r, unless it is already allocated
+ * to a register. Return register holding the value.
+ */
+static enum reg load_qword(struct var var, enum reg r)
+{
+    enum reg ax;
+
+    assert(var.kind == DIRECT);
+    assert(size_of(var.type) == 8);
+    if ((ax = allocated_register(var)) != 0)
+        return ax;
+
+    if (is_global_offset(var.symbol)) {
+        emit(INSTR_MOV, OPT_MEM_REG, location(got(var.symbol), 8), reg(r, 8));
+        emit(INSTR_MOV, OPT_MEM_REG,
+            location(address(displacement_from_offset(var.offset), r, 0, 0), 8),
+            reg(r, 8));
+    } else if (is_reg_value(var)) {
+        if ((ax = find_reg_value(var, INSTR_MOV, 8, r)) != 0) {
+            copy_reg_value(ax, reg(r, 8));
+        } else {
+            emit(INSTR_MOV, OPT_MEM_REG, location_of(var, 8), reg(r, 8));
+        }
+        set_reg_value(r, var, INSTR_MOV, 8);
+    } else {
+        emit(INSTR_MOV, OPT_MEM_REG, location_of(var, 8), reg(r, 8));
+    }
+
+    return r;
+}
+
+/*
+ * Load base and index of address mode to registers, returning memory
+ * operand. Use %r11 for base and %r10 for index if the values are not
+ * already in registers. Stack and static addresses without index are
+ * encoded directly.
+ */
+static struct address address_from_mode(struct address_mode mode, int disp)
+{
+    struct address addr;
+    struct var base;
+
+    base = mode.base;
+    disp += mode.disp;
+    if (base.kind == DIRECT) {
+        addr = address(disp, load_qword(base, R11), 0, 0);
+    } else {
+        assert(base.kind == ADDRESS);
+        if (is_global_offset(base.symbol)) {
+            emit(INSTR_MOV, OPT_MEM_REG,
+                location(got(base.symbol), 8), reg(R11, 8));
+            disp += displacement_from_offset(base.offset);
+            addr = address(disp, R11, 0, 0);
+        } else if (base.symbol->linkage == LINK_NONE || !mode.scale) {
+            addr = address_of(base);
+            addr.disp += disp;
+        } else {
+            emit(INSTR_LEA, OPT_MEM_REG, location_of(base, 8), reg(R11, 8));
+            addr = address(disp, R11, 0, 0);
+        }
+    }
+
+    if (mode.scale) {
+        assert(!addr.sym);
+        addr.offset = load_qword(mode.index, R10);
+        addr.mult = mode.scale;
+    }
+
+    return addr;
+}
+
+/*
+ * Address of memory referenced by dereferencing pointer variable. The
+ * pointer is loaded to %r11 if it is not already in a register, unless
+ * it is folded into the memory operand.
+ */
+static struct address deref_address(struct var var)
+{
+    struct var ptr;
+
+    assert(var.kind == DEREF);
+    if (var.symbol && var.symbol == folded_pointer) {
+        return address_from_mode(
+            folded_address,
+            displacement_from_offset(var.offset));
+    }
+
+    if (!var.symbol) {
+        var.kind = IMMEDIATE;
+        emit(INSTR_MOV, OPT_IMM_REG, value_of(var, 8), reg(R11, 8));
+        return address(0, R11, 0, 0);
+    }
+
+    ptr = var_direct(var.symbol);
+    assert(is_pointer(ptr.type));
+    return address(
+        displacement_from_offset(var.offset),
+        load_qword(ptr, R11), 0, 0);
+}
+
 /*
  * Return smallest type big enough to cover the i'th eightbyte slice of
  * aggregate type. Scalar types are returned as is.
@@ -441,6 +861,13 @@ static void emit_load(
                 location(got(source.symbol), 8), reg(ax, 8));
             emit(opcode, OPT_MEM_REG, location(address(
                 displacement_from_offset(source.offset), ax, 0, 0), w), dest);
+        } else if (is_reg_value(source)) {
+            if ((ax = find_reg_value(source, opcode, dest.w, dest.r)) != 0) {
+                copy_reg_value(ax, dest);
+            } else {
+                emit(opcode, OPT_MEM_REG, location_of(source, w), dest);
+            }
+            set_reg_value(dest.r, source, opcode, dest.w);
         } else {
             emit(opcode, OPT_MEM_REG, location_of(source, w), dest);
         }
@@ -451,26 +878,7 @@ static void emit_load(
             ptr.offset = source.offset;
             emit(opcode, OPT_MEM_REG, location_of(ptr, w), dest);
         } else {
-            assert(is_pointer(ptr.type));
-            if (is_register_allocated(ptr)) {
-                ax = allocated_register(ptr);
-            } else if (is_global_offset(source.symbol)) {
-                ax = dest.r < XMM0 ? dest.r : R11;
-                emit(INSTR_MOV, OPT_MEM_REG,
-                    location(got(source.symbol), 8), reg(ax, 8));
-                emit(INSTR_MOV, OPT_MEM_REG,
-                    location(address(0, ax, 0, 0), w),
-                    reg(ax, 8));
-            } else {
-                ax = R11;
-                emit(INSTR_MOV, OPT_MEM_REG, location_of(ptr, 8), reg(ax, 8));
-            }
-            emit(opcode,
-                OPT_MEM_REG,
-                location(
-                    address(
-                        displacement_from_offset(source.offset), ax, 0, 0), w),
-                dest);
+            emit(opcode, OPT_MEM_REG, location(deref_address(source), w), dest);
         }
         break;
     case ADDRESS:
@@ -623,6 +1031,9 @@ static void load_address(struct var v, enum reg r)
         } else {
             emit(INSTR_LEA, OPT_MEM_REG, location_of(v, 8), reg(r, 8));
         }
+    } else if (folded_pointer && v.symbol == folded_pointer) {
+        assert(v.kind == DEREF);
+        emit(INSTR_LEA, OPT_MEM_REG, location(deref_address(v), 8), reg(r, 8));
     } else {
         assert(v.kind == DEREF);
         load(var_direct(v.symbol), r);
@@ -649,6 +1060,57 @@ static struct var x87_unsigned_adjust_constant(void)
     return var_direct(sym);
 }
 
+/*
+ * Copy object of known size from address in register src to address
+ * in register dst. Small objects are copied inline, using 16 byte SSE
+ * moves through %xmm0 and integer moves through %rax for the remaining
+ * bytes. Larger objects are copied with memcpy, which requires source
+ * and destination to be in %rsi and %rdi.
+ *
+ * Aligned SSE moves are used if both addresses are known to be 16 byte
+ * aligned.
+ */
+static void emit_copy(enum reg src, enum reg dst, size_t size, int align)
+{
+    int w;
+    size_t i;
+    enum opcode mov;
+
+    if (size > INLINE_COPY_MAX) {
+        assert(src == SI);
+        assert(dst == DI);
+        emit(INSTR_MOV, OPT_IMM_REG, constant(size, 4), reg(DX, 4));
+        call_function(decl_memcpy);
+        return;
+    }
+
+    mov = (align % 16 == 0) ? INSTR_MOVAPS : INSTR_MOVUPS;
+    for (i = 0; i < size; i += w) {
+        w = (size - i >= 16) ? 16
+          : (size - i >= 8) ? 8
+          : (size - i >= 4) ? 4
+          : (size - i >= 2) ? 2 : 1;
+        if (w == 16) {
+            emit(mov, OPT_MEM_REG,
+                location(address(i, src, 0, 0), w), reg(XMM0, w));
+            emit(mov, OPT_REG_MEM,
+                reg(XMM0, w), location(address(i, dst, 0, 0), w));
+        } else {
+            emit(INSTR_MOV, OPT_MEM_REG,
+                location(address(i, src, 0, 0), w), reg(AX, w));
+            emit(INSTR_MOV, OPT_REG_MEM,
+                reg(AX, w), location(address(i, dst, 0, 0), w));
+        }
+    }
+
+    /*
+     * Destination can be a local variable without its address taken,
+     * which is not considered by alias analysis of stores through
+     * pointers. Forget all values, like after calling memcpy.
+     */
+    clear_reg_values();
+}
+
 /* Push value to stack, rounded up to always be 8 byte aligned. */
 static void push(struct var v)
 {
@@ -688,10 +1150,15 @@ static void push(struct var v)
     } else {
         eb = EIGHTBYTES(v.type);
         emit(INSTR_SUB, OPT_IMM_REG, constant(eb * 8, 8), reg(SP, 8));
-        emit(INSTR_MOV, OPT_IMM_REG, constant(eb, 4), reg(CX, 4));
-        emit(INSTR_MOV, OPT_REG_REG, reg(SP, 8), reg(DI, 8));
-        load_address(v, SI);
-        emit(INSTR_REP_MOVSQ, OPT_NONE);
+        if (eb * 8 <= INLINE_COPY_MAX) {
+            load_address(v, SI);
+            emit_copy(SI, SP, eb * 8, 1);
+        } else {
+            emit(INSTR_MOV, OPT_IMM_REG, constant(eb, 4), reg(CX, 4));
+            emit(INSTR_MOV, OPT_REG_REG, reg(SP, 8), reg(DI, 8));
+            load_address(v, SI);
+            emit(INSTR_REP_MOVSQ, OPT_NONE);
+        }
     }
 }
 
@@ -734,7 +1201,7 @@ static enum reg load_x87(struct var v)
             load_x87(v);
             emit(INSTR_FADDP, OPT_REG, reg(st, 16));
             x87_stack--;
-            enter_context(label);
+            enter_label(label);
         }
         assert(int_regs_used == 1);
         relase_regs();
@@ -801,9 +1268,9 @@ static enum reg load_float_as_integer(
         }
         emit(INSTR_JAE, OPT_IMM, addr(convert));
         /* Value is representable as signed long. */
-        emit_load(opcode, val, reg(ax, 8));
+        emit(opcode, OPT_REG_REG, reg(xmm0, width), reg(ax, 8));
         emit(INSTR_JMP, OPT_IMM, addr(next));
-        enter_context(convert);
+        enter_label(convert);
         /* Trickery to convert value not within signed long. */
         if (is_float(val.type)) {
             emit(INSTR_SUBSS, OPT_REG_REG, reg(xmm1, 4), reg(xmm0, 4));
@@ -813,7 +1280,7 @@ static enum reg load_float_as_integer(
         emit(opcode, OPT_REG_REG, reg(xmm0, width), reg(ax, 8));
         emit(INSTR_MOV, OPT_IMM_REG, constant(LONG_MAX + 1ul, 8), reg(cx, 8));
         emit(INSTR_XOR, OPT_REG_REG, reg(cx, 8), reg(ax, 8));
-        enter_context(next);
+        enter_label(next);
     }
 
     return ax;
@@ -830,8 +1297,13 @@ static enum reg load_integer_as_float(
     assert(is_integer(val.type));
     assert(is_real(type));
 
+    /*
+     * Conversion only writes the low part of the register. Clear it
+     * first to not depend on whatever value was there before.
+     */
     xmm = get_sse_reg();
     opcode = (size_of(type) == 8) ? INSTR_CVTSI2SD : INSTR_CVTSI2SS;
+    emit(INSTR_PXOR, OPT_REG_REG, reg(xmm, 8), reg(xmm, 8));
     if (is_signed(val.type)) {
         if (size_of(val.type) < 4 || is_field(val)) {
             ax = get_int_reg();
@@ -845,6 +1317,13 @@ static enum reg load_integer_as_float(
         if (size_of(val.type) < 4) {
             load_int(val, ax, 4);
             emit(opcode, OPT_REG_REG, reg(ax, 4), reg(xmm, size_of(type)));
+        } else if (size_of(val.type) == 4) {
+            /*
+             * Writing the 32 bit register clears the upper half, and
+             * any unsigned int is then a positive signed long.
+             */
+            load_int(val, ax, 4);
+            emit(opcode, OPT_REG_REG, reg(ax, 8), reg(xmm, size_of(type)));
         } else {
             cx = get_int_reg();
             load_int(val, ax, 8);
@@ -854,14 +1333,11 @@ static enum reg load_integer_as_float(
              * Check if unsigned integer is small enough to be
              * interpreted as signed.
              */
-            if (size_of(val.type) == 4) {
-                emit(INSTR_MOV, OPT_REG_REG, reg(ax, 4), reg(ax, 4));
-            }
             emit(INSTR_TEST, OPT_REG_REG, reg(ax, 8), reg(ax, 8));
             emit(INSTR_JS, OPT_IMM, addr(label));
             emit(opcode, OPT_REG_REG, reg(ax, 8), reg(xmm, size_of(type)));
             emit(INSTR_JMP, OPT_IMM, addr(next));
-            enter_context(label);
+            enter_label(label);
             /*
              * Convert large unsigned integer by adding up two halves.
              */
@@ -875,7 +1351,7 @@ static enum reg load_integer_as_float(
             } else {
                 emit(INSTR_ADDSD, OPT_REG_REG, reg(xmm, 8), reg(xmm, 8));
             }
-            enter_context(next);
+            enter_label(next);
         }
     }
 
@@ -1058,6 +1534,7 @@ static void store_op(
     enum reg ax;
     enum opcode opc;
     struct var field;
+    struct memory mem;
 
     assert(optype == OPT_IMM || optype == OPT_REG);
     if (is_long_double(target.type)) {
@@ -1088,6 +1565,10 @@ static void store_op(
             optype = OPT_REG;
             op.reg = reg(CX, w);
         } else {
+            if (is_temp_int_reg(op.reg.r)) {
+                emit(INSTR_MOV, OPT_REG_REG, op.reg, reg(AX, w));
+                op.reg = reg(AX, w);
+            }
             if (target.field_offset) {
                 emit(INSTR_SHL, OPT_IMM_REG,
                     constant(target.field_offset, w), op.reg);
@@ -1123,27 +1604,22 @@ static void store_op(
                         displacement_from_offset(target.offset), R11, 0, 0), w));
             } else {
                 emit(opc, OPT_REG_MEM, op.reg, location_of(target, w));
+                if (is_reg_value(target) && (w == 8 || is_real(target.type))) {
+                    set_reg_value(op.reg.r, target, opc, w);
+                }
             }
         }
         break;
     default:
         assert(target.kind == DEREF);
-        if (!target.symbol) {
-            target.kind = IMMEDIATE;
-            load_int(target, R11, 8);
-        } else {
-            assert(is_pointer(target.symbol->type));
-            load_int(var_direct(target.symbol), R11, 8);
-        }
+        mem = location(deref_address(target), w);
+        pointer_store = &target;
         if (optype == OPT_IMM) {
-            emit(opc, OPT_IMM_MEM, op.imm,
-                location(address(
-                    displacement_from_offset(target.offset), R11, 0, 0), w));
+            emit(opc, OPT_IMM_MEM, op.imm, mem);
         } else {
-            emit(opc, OPT_REG_MEM, op.reg,
-                location(address(
-                    displacement_from_offset(target.offset), R11, 0, 0), w));
+            emit(opc, OPT_REG_MEM, op.reg, mem);
         }
+        pointer_store = NULL;
         break;
     }
 }
@@ -1349,61 +1825,612 @@ static int push_function_arguments(Type type, struct param_class respc)
     return mem_used;
 }
 
-/*
- * Assign stack location to locals, writing sym->stack_offset.
- *
- * Round up to nearest eightbyte, making all variables aligned.
- */
-static int allocate_locals(
-    struct definition *def,
-    int reg_offset,
-    int stack_offset)
+static int is_unary_operation(struct expression expr)
 {
-    int i;
-    struct symbol *sym;
-
-    for (i = 0; i < array_len(&def->locals); ++i) {
-        sym = array_get(&def->locals, i);
-        assert(!sym->stack_offset);
-        assert(sym->symtype == SYM_DEFINITION);
-        if (sym->linkage == LINK_NONE && sym->slot == 0 && !is_vla(sym->type)) {
-            stack_offset -= EIGHTBYTES(sym->type) * 8;
-            sym->stack_offset = stack_offset - reg_offset;
-        }
+    switch (expr.op) {
+    case IR_OP_CAST:
+    case IR_OP_CALL:
+    case IR_OP_VA_ARG:
+    case IR_OP_NOT:
+    case IR_OP_NEG:
+    case IR_OP_POPCNT:
+    case IR_OP_CLZ:
+    case IR_OP_CTZ:
+    case IR_OP_FFS:
+    case IR_OP_BSWAP:
+        return 1;
+    default:
+        return 0;
     }
-
-    return stack_offset;
 }
 
 /*
- * Assign a subset of local variables to temporary registers, populating
- * sym->slot.
- *
- * Return number of registers allocated.
+ * Range of blocks, by position in the function, where a local variable
+ * stored on stack is live. Variables with disjoint ranges can share the
+ * same stack slot.
  */
-static int allocate_registers(struct definition *def)
-{
-    int i, regs;
+struct live_range {
     struct symbol *sym;
+    int first;
+    int last;
+    int size;
+    int align;
+    int order;
+    int written;        /* Last block where variable is fully assigned. */
+    int exposed;        /* Read before assigned in some block. */
+};
+
+/* Part of stack frame which is not in use by any live variable. */
+struct stack_slot {
+    int offset;
+    int size;
+};
+
+/* Position of each block in the function, sorted by address. */
+struct block_position {
+    const struct block *block;
+    int i;
+};
 
-    regs = 0;
-    for (i = 0; i < array_len(&def->locals); ++i) {
-        sym = array_get(&def->locals, i);
-        if (is_temporary(sym)
-            && sym->slot == 0
-            && is_arithmetic(sym->type)
-            && (is_integer(sym->type) || is_pointer(sym->type))
-            && regs < TEMP_INT_REGS)
-        {
-            assert(sym->linkage == LINK_NONE);
-            sym->slot = ++regs;
-        }
-    }
+/* Range of blocks from loop header to back edge. */
+struct loop {
+    int first;
+    int last;
+};
 
-    return regs;
+static array_of(struct live_range) live_ranges;
+static array_of(struct live_range *) active_ranges;
+static array_of(struct stack_slot) free_slots;
+static array_of(struct block_position) block_positions;
+static array_of(struct loop) loops;
+
+/* Blocks aligned with -falign-loops, in the function being compiled. */
+static array_of(const struct block *) back_edge_targets;
+
+static int compare_range_symbol(const void *a, const void *b)
+{
+    const struct live_range *l, *r;
+
+    l = (const struct live_range *) a;
+    r = (const struct live_range *) b;
+    if (l->sym == r->sym)
+        return 0;
+
+    return ((unsigned long) l->sym < (unsigned long) r->sym) ? -1 : 1;
 }
 
-/*
+static int compare_range_start(const void *a, const void *b)
+{
+    const struct live_range *l, *r;
+
+    l = (const struct live_range *) a;
+    r = (const struct live_range *) b;
+    if (l->first != r->first)
+        return l->first - r->first;
+
+    return l->order - r->order;
+}
+
+static int compare_block_position(const void *a, const void *b)
+{
+    const struct block_position *l, *r;
+
+    l = (const struct block_position *) a;
+    r = (const struct block_position *) b;
+    if (l->block == r->block)
+        return 0;
+
+    return ((unsigned long) l->block < (unsigned long) r->block) ? -1 : 1;
+}
+
+static struct live_range *find_live_range(const struct symbol *sym)
+{
+    struct live_range key = {0};
+
+    if (!sym || !array_len(&live_ranges))
+        return NULL;
+
+    key.sym = (struct symbol *) sym;
+    return bsearch(&key, live_ranges.data, array_len(&live_ranges),
+        sizeof(struct live_range), &compare_range_symbol);
+}
+
+static int block_position(const struct block *block)
+{
+    struct block_position key = {0}, *pos;
+
+    key.block = block;
+    pos = bsearch(&key, block_positions.data, array_len(&block_positions),
+        sizeof(struct block_position), &compare_block_position);
+
+    assert(pos);
+    return pos->i;
+}
+
+/* Index position of each block in the order they are emitted. */
+static void index_block_positions(struct definition *def)
+{
+    int i, n;
+    struct block_position pos;
+
+    n = array_len(&def->nodes);
+    array_empty(&block_positions);
+    for (i = 0; i < n; ++i) {
+        pos.block = array_get(&def->nodes, i);
+        pos.i = i;
+        array_push_back(&block_positions, pos);
+    }
+
+    qsort(block_positions.data, n, sizeof(struct block_position),
+        &compare_block_position);
+}
+
+static void add_live_block(struct live_range *range, int i)
+{
+    if (range->first == -1 || i < range->first) {
+        range->first = i;
+    }
+
+    if (range->last < i) {
+        range->last = i;
+    }
+}
+
+/*
+ * Objects having their address taken can be accessed anywhere through
+ * pointers, and are considered live in the whole function.
+ */
+static void read_live_var(struct var var, int i, int n)
+{
+    struct live_range *range;
+
+    range = find_live_range(var.symbol);
+    if (!range)
+        return;
+
+    if (var.kind == ADDRESS) {
+        range->first = 0;
+        range->last = n - 1;
+        range->exposed = 1;
+    } else {
+        add_live_block(range, i);
+        if (range->written != i) {
+            range->exposed = 1;
+        }
+    }
+}
+
+static void read_live_expression(struct expression expr, int i, int n)
+{
+    read_live_var(expr.l, i, n);
+    if (!is_unary_operation(expr)) {
+        read_live_var(expr.r, i, n);
+    }
+}
+
+/*
+ * Assignment to the whole variable means the value before is not read
+ * in the rest of the block. Partial assignment counts as read.
+ */
+static void write_live_var(struct var var, int i, int n)
+{
+    struct live_range *range;
+
+    if (var.kind != DIRECT
+        || var.offset
+        || is_field(var)
+        || size_of(var.type) != size_of(var.symbol->type))
+    {
+        read_live_var(var, i, n);
+    } else if ((range = find_live_range(var.symbol)) != NULL) {
+        add_live_block(range, i);
+        range->written = i;
+    }
+}
+
+/*
+ * Compute range of blocks where each local variable is live. Ranges
+ * are extended to cover loops, unless the variable is only used in a
+ * single block, and always assigned before read.
+ */
+static void compute_live_ranges(struct definition *def)
+{
+    int i, j, n, changed;
+    struct block *block;
+    struct statement *st;
+    struct live_range *range;
+    struct loop loop;
+
+    n = array_len(&def->nodes);
+    array_empty(&loops);
+    index_block_positions(def);
+    qsort(live_ranges.data, array_len(&live_ranges),
+        sizeof(struct live_range), &compare_range_symbol);
+
+    for (i = 0; i < n; ++i) {
+        block = array_get(&def->nodes, i);
+        for (j = 0; j < array_len(&block->code); ++j) {
+            st = &array_get(&block->code, j);
+            read_live_expression(st->expr, i, n);
+            switch (st->st) {
+            case IR_ASSIGN:
+                write_live_var(st->t, i, n);
+                break;
+            case IR_CMOV:
+                read_live_var(array_get(&def->sources, st->source), i, n);
+                read_live_var(st->t, i, n);
+                break;
+            case IR_VLA_ALLOC:
+                range = find_live_range(st->t.symbol->value.vla_address);
+                if (range) {
+                    add_live_block(range, i);
+                    range->written = i;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (block->jump[1] || block->has_return_value || block->indirect) {
+            read_live_expression(block->expr, i, n);
+        }
+
+        for (j = 0; j < 2 && block->jump[j]; ++j) {
+            loop.first = block_position(block->jump[j]);
+            if (loop.first <= i) {
+                loop.last = i;
+                array_push_back(&loops, loop);
+            }
+        }
+
+        for (j = 0; j < array_len(&block->targets); ++j) {
+            loop.first = block_position(array_get(&block->targets, j));
+            if (loop.first <= i) {
+                loop.last = i;
+                array_push_back(&loops, loop);
+            }
+        }
+    }
+
+    for (i = 0; i < array_len(&live_ranges); ++i) {
+        range = &array_get(&live_ranges, i);
+        if (range->first == -1 || (range->first == range->last && !range->exposed))
+            continue;
+
+        do {
+            changed = 0;
+            for (j = 0; j < array_len(&loops); ++j) {
+                loop = array_get(&loops, j);
+                if (loop.first <= range->last
+                    && loop.last >= range->first
+                    && (loop.first < range->first || loop.last > range->last))
+                {
+                    range->first = loop.first < range->first
+                        ? loop.first : range->first;
+                    range->last = loop.last > range->last
+                        ? loop.last : range->last;
+                    changed = 1;
+                }
+            }
+        } while (changed);
+    }
+}
+
+/*
+ * Find smallest free slot where variable fits with correct alignment,
+ * relative to %rbp. Return index, or -1 if none.
+ */
+static int find_free_slot(const struct live_range *range)
+{
+    int i, found;
+    struct stack_slot slot;
+
+    found = -1;
+    for (i = 0; i < array_len(&free_slots); ++i) {
+        slot = array_get(&free_slots, i);
+        if (slot.size >= range->size
+            && slot.offset % range->align == 0
+            && (found == -1 || slot.size < array_get(&free_slots, found).size))
+        {
+            found = i;
+        }
+    }
+
+    return found;
+}
+
+/*
+ * Functions which can return more than once. Execution resumes after
+ * the call when jumping back, where variables live at the time of the
+ * first return must still hold their values. This is not visible in
+ * the control flow graph.
+ */
+static int is_returns_twice(struct expression expr)
+{
+    const char *name;
+
+    if (expr.op != IR_OP_CALL || expr.l.kind != ADDRESS)
+        return 0;
+
+    name = str_raw(expr.l.symbol->name);
+    return !strcmp(name, "setjmp")
+        || !strcmp(name, "_setjmp")
+        || !strcmp(name, "sigsetjmp")
+        || !strcmp(name, "__sigsetjmp")
+        || !strcmp(name, "vfork");
+}
+
+static int has_returns_twice_call(struct definition *def)
+{
+    int i, j;
+    struct block *block;
+
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        for (j = 0; j < array_len(&block->code); ++j) {
+            if (is_returns_twice(array_get(&block->code, j).expr))
+                return 1;
+        }
+
+        if ((block->jump[1] || block->has_return_value)
+            && is_returns_twice(block->expr))
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Assign stack offsets to local variables, letting variables which are
+ * not live at the same time share slots. Scalars are packed by size and
+ * alignment, while aggregates are rounded up to whole eightbytes to be
+ * able to move them to and from registers.
+ *
+ * Every variable gets its own slot in functions calling setjmp or
+ * similar, as live ranges do not account for returning twice.
+ */
+static int allocate_locals(
+    struct definition *def,
+    int reg_offset,
+    int stack_offset)
+{
+    int i, j, offset;
+    struct symbol *sym;
+    struct live_range range = {0}, *active;
+    struct stack_slot slot;
+
+    array_empty(&live_ranges);
+    array_empty(&active_ranges);
+    array_empty(&free_slots);
+    for (i = 0; i < array_len(&def->locals); ++i) {
+        sym = array_get(&def->locals, i);
+        assert(!sym->stack_offset);
+        assert(sym->symtype == SYM_DEFINITION);
+        if (sym->linkage == LINK_NONE && sym->slot == 0 && !is_vla(sym->type)) {
+            range.sym = sym;
+            range.first = -1;
+            range.last = -1;
+            range.written = -1;
+            range.order = i;
+            if (is_scalar(sym->type)) {
+                range.size = size_of(sym->type);
+                range.align = type_alignment(sym->type);
+            } else {
+                range.size = EIGHTBYTES(sym->type) * 8;
+                range.align = 8;
+            }
+            array_push_back(&live_ranges, range);
+        }
+    }
+
+    if (has_returns_twice_call(def)) {
+        for (i = 0; i < array_len(&live_ranges); ++i) {
+            array_get(&live_ranges, i).first = 0;
+            array_get(&live_ranges, i).last = array_len(&def->nodes);
+        }
+    } else {
+        compute_live_ranges(def);
+    }
+
+    qsort(live_ranges.data, array_len(&live_ranges),
+        sizeof(struct live_range), &compare_range_start);
+
+    offset = stack_offset - reg_offset;
+    for (i = 0; i < array_len(&live_ranges); ++i) {
+        range = array_get(&live_ranges, i);
+        for (j = 0; j < array_len(&active_ranges); ++j) {
+            active = array_get(&active_ranges, j);
+            if (active->last < range.first) {
+                slot.offset = active->sym->stack_offset;
+                slot.size = active->size;
+                array_push_back(&free_slots, slot);
+                array_erase(&active_ranges, j);
+                j--;
+            }
+        }
+
+        j = find_free_slot(&range);
+        if (j != -1) {
+            slot = array_get(&free_slots, j);
+            array_erase(&free_slots, j);
+        } else {
+            offset = -offset + range.size;
+            offset = -((offset + range.align - 1) / range.align * range.align);
+            slot.offset = offset;
+            slot.size = range.size;
+        }
+
+        range.sym->stack_offset = slot.offset;
+        array_push_back(&active_ranges, &array_get(&live_ranges, i));
+    }
+
+    return offset + reg_offset;
+}
+
+static int add_param_reference(int n, struct var var, const struct symbol *sym)
+{
+    if (n < 0 || var.symbol != sym)
+        return n;
+
+    if (var.kind == DEREF)
+        return n + 1;
+
+    if (var.kind != DIRECT
+        || var.offset
+        || is_field(var)
+        || size_of(var.type) != size_of(sym->type))
+        return -1;
+
+    return n + 1;
+}
+
+static int add_param_expression(
+    int n,
+    struct expression expr,
+    const struct symbol *sym)
+{
+    n = add_param_reference(n, expr.l, sym);
+    if (!is_unary_operation(expr)) {
+        n = add_param_reference(n, expr.r, sym);
+    }
+
+    return n;
+}
+
+/*
+ * Count references to parameter in function body. Return -1 if the
+ * address is taken, or the parameter is accessed other than as a
+ * whole.
+ */
+static int count_param_references(
+    struct definition *def,
+    const struct symbol *sym)
+{
+    int i, j, n;
+    struct block *block;
+    struct statement *st;
+
+    n = 0;
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        for (j = 0; j < array_len(&block->code); ++j) {
+            st = &array_get(&block->code, j);
+            switch (st->st) {
+            case IR_CMOV:
+                n = add_param_reference(
+                    n, array_get(&def->sources, st->source), sym);
+                /* Fallthrough. */
+            case IR_ASSIGN:
+            case IR_VLA_ALLOC:
+                n = add_param_reference(n, st->t, sym);
+                /* Fallthrough. */
+            default:
+                n = add_param_expression(n, st->expr, sym);
+                break;
+            }
+        }
+
+        if (block->jump[1] || block->has_return_value || block->indirect) {
+            n = add_param_expression(n, block->expr, sym);
+        }
+    }
+
+    return n;
+}
+
+static int has_function_call(struct definition *def)
+{
+    int i, j;
+    struct block *block;
+
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        for (j = 0; j < array_len(&block->code); ++j) {
+            if (array_get(&block->code, j).expr.op == IR_OP_CALL)
+                return 1;
+        }
+
+        if ((block->jump[1] || block->has_return_value || block->indirect)
+            && block->expr.op == IR_OP_CALL)
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Integer and pointer parameters passed in registers can be kept in a
+ * callee saved register for the whole function, unless the address is
+ * taken. Only do this in functions making calls, where the incoming
+ * registers are overwritten. In leaf functions, saving and restoring
+ * the callee saved register costs more than loading from the stack.
+ */
+static int allocate_param_registers(struct definition *def, int regs)
+{
+    int i, next_integer_reg, next_sse_reg;
+    struct symbol *sym;
+    struct param_class pc;
+
+    if (!has_function_call(def))
+        return regs;
+
+    next_integer_reg = 0;
+    next_sse_reg = 0;
+    pc = classify(type_next(def->symbol->type));
+    if (pc.eightbyte[0] == PC_MEMORY) {
+        next_integer_reg = 1;
+    }
+
+    for (i = 0; i < array_len(&def->params) && regs < TEMP_INT_REGS; ++i) {
+        sym = array_get(&def->params, i);
+        pc = classify(sym->type);
+        if (!alloc_register_params(pc, &next_integer_reg, &next_sse_reg))
+            continue;
+
+        if ((is_integer(sym->type) || is_pointer(sym->type))
+            && !is_volatile(sym->type)
+            && count_param_references(def, sym) > 0)
+        {
+            assert(sym->linkage == LINK_NONE);
+            assert(sym->slot == 0);
+            sym->slot = ++regs;
+        }
+    }
+
+    return regs;
+}
+
+/*
+ * Assign a subset of parameters and local variables to temporary
+ * registers, populating sym->slot. Parameters are preferred, as they
+ * would otherwise be stored on entry and loaded on every use.
+ *
+ * Return number of registers allocated.
+ */
+static int allocate_registers(struct definition *def)
+{
+    int i, regs;
+    struct symbol *sym;
+
+    regs = allocate_param_registers(def, 0);
+    for (i = 0; i < array_len(&def->locals); ++i) {
+        sym = array_get(&def->locals, i);
+        if (is_temporary(sym)
+            && sym->slot == 0
+            && is_arithmetic(sym->type)
+            && (is_integer(sym->type) || is_pointer(sym->type))
+            && regs < TEMP_INT_REGS)
+        {
+            assert(sym->linkage == LINK_NONE);
+            sym->slot = ++regs;
+        }
+    }
+
+    return regs;
+}
+
+/*
  * Offset from %rbp where address of return value is stored, in case of
  * function with class PC_MEMORY. The return address is passed in the
  * first integer register on enter, and needs to be preserved to write
@@ -1441,6 +2468,7 @@ static int enter(struct definition *def)
         next_sse_reg = 0,
         mem_offset = 16,    /* Offset of PC_MEMORY parameters. */
         reg_offset = 0,     /* Offset of %rsp to save temp registers. */
+        save_area_offset,   /* Offset of %rbp to register save area. */
         stack_offset = 0;   /* Offset of %rsp for local variables. */
     struct var ref;
     struct symbol *sym;
@@ -1457,6 +2485,7 @@ static int enter(struct definition *def)
     /* Figure out how many registers are used for temporaries. */
     regs = allocate_registers(def);
     reg_offset = regs * 8;
+    save_area_offset = reg_offset + reg_offset % 16;
 
     /*
      * Address of return value is passed as first integer argument. If
@@ -1468,7 +2497,7 @@ static int enter(struct definition *def)
         next_integer_reg = 1;
         return_address_offset = -8 - reg_offset;
         if (is_vararg(type)) {
-            return_address_offset = -176 - reg_offset;
+            return_address_offset = -176 - save_area_offset;
         }
     }
 
@@ -1478,10 +2507,11 @@ static int enter(struct definition *def)
      * there are 8 bytes for each of the 6 integer registers, and 16
      * bytes for each of the 8 SSE registers, for a total of 176 bytes.
      * If return type is MEMORY, the return address is automatically
-     * included in register spill area.
+     * included in register spill area. The area is placed below saved
+     * temporary registers, aligned to 16 bytes for SSE stores.
      */
     if (is_vararg(type)) {
-        stack_offset = -176;
+        stack_offset = -176 - (save_area_offset - reg_offset);
     }
 
     /*
@@ -1499,8 +2529,10 @@ static int enter(struct definition *def)
             argpc[register_args].pc = arg;
             argpc[register_args].i = i;
             register_args++;
-            stack_offset -= n * 8;
-            sym->stack_offset = stack_offset - reg_offset;
+            if (!sym->slot) {
+                stack_offset -= n * 8;
+                sym->stack_offset = stack_offset - reg_offset;
+            }
         } else {
             sym->stack_offset = mem_offset;
             mem_offset += n * 8;
@@ -1545,7 +2577,7 @@ static int enter(struct definition *def)
         vararg.gp_offset = 8*next_integer_reg;
         vararg.fp_offset = 8*MAX_INTEGER_ARGS + 16*next_sse_reg;
         vararg.overflow_arg_area_offset = mem_offset;
-        vararg.reg_save_area_offset = 0;
+        vararg.reg_save_area_offset = -save_area_offset;
         emit(INSTR_TEST, OPT_REG_REG, reg(AX, 1), reg(AX, 1));
         emit(INSTR_JE, OPT_IMM, addr(sym));
         for (i = 0; i < MAX_SSE_ARGS; ++i) {
@@ -1555,7 +2587,7 @@ static int enter(struct definition *def)
                 location(address(vararg.reg_save_area_offset, BP, 0, 0), 8));
         }
 
-        enter_context(sym);
+        enter_label(sym);
         for (i = 0; i < MAX_INTEGER_ARGS; ++i) {
             vararg.reg_save_area_offset -= 8;
             emit(INSTR_MOV, OPT_REG_MEM,
@@ -1564,16 +2596,25 @@ static int enter(struct definition *def)
         }
     }
 
-    /* Move arguments from register to stack. */
+    /*
+     * Move arguments from register to stack, or to the temporary
+     * register allocated for the parameter.
+     */
     next_integer_reg = (res.eightbyte[0] == PC_MEMORY);
     next_sse_reg = 0;
     for (i = 0; i < register_args; ++i) {
         arg = argpc[i].pc;
         sym = array_get(&def->params, argpc[i].i);
         ref = var_direct(sym);
-        store_object_from_registers(ref, arg,
-            param_int_reg + next_integer_reg,
-            param_sse_reg + next_sse_reg);
+        if (sym->slot) {
+            emit(INSTR_MOV, OPT_REG_REG,
+                reg(param_int_reg[next_integer_reg], 8),
+                reg(allocated_register(ref), 8));
+        } else {
+            store_object_from_registers(ref, arg,
+                param_int_reg + next_integer_reg,
+                param_sse_reg + next_sse_reg);
+        }
         count_register_classifications(arg, &next_integer_reg, &next_sse_reg);
     }
 
@@ -1799,7 +2840,7 @@ static void compile__builtin_va_arg(struct var res, struct var args)
         }
 
         emit(INSTR_JMP, OPT_IMM, addr(done));
-        enter_context(stack);
+        enter_label(stack);
     }
 
     /*
@@ -1820,8 +2861,7 @@ static void compile__builtin_va_arg(struct var res, struct var args)
         }
     } else {
         load_address(res, DI);
-        emit(INSTR_MOV, OPT_IMM_REG, constant(w, 4), reg(DX, 4));
-        emit(INSTR_CALL, OPT_IMM, addr(decl_memcpy));
+        emit_copy(SI, DI, w, 1);
     }
 
     /*
@@ -1840,7 +2880,7 @@ static void compile__builtin_va_arg(struct var res, struct var args)
 
     if (pc.eightbyte[0] == PC_INTEGER || pc.eightbyte[0] == PC_SSE) {
         assert(done);
-        enter_context(done);
+        enter_label(done);
     }
 }
 
@@ -1869,7 +2909,7 @@ static enum reg compile_call(struct var target, struct var ptr)
 
     if (ptr.kind == ADDRESS) {
         assert(!ptr.offset);
-        emit(INSTR_CALL, OPT_IMM, addr(ptr.symbol));
+        call_function(ptr.symbol);
     } else {
         assert(ptr.kind != IMMEDIATE);
         load(ptr, R11);
@@ -2091,7 +3131,8 @@ static enum reg compile_add(
             if (operand_equal(target, r)) {
                 if (is_int_constant(l)) {
                     if ((cx = allocated_register(r)) != 0) {
-                        emit(INSTR_ADD, OPT_REG_REG, reg(ax, w), reg(cx, w));
+                        emit(INSTR_ADD, OPT_IMM_REG,
+                            value_of(l, w), reg(cx, w));
                         ax = cx;
                     } else {
                         emit(INSTR_ADD, OPT_IMM_MEM,
@@ -2111,7 +3152,8 @@ static enum reg compile_add(
             } else if (operand_equal(target, l)) {
                 if (is_int_constant(r)) {
                     if ((cx = allocated_register(l)) != 0) {
-                        emit(INSTR_ADD, OPT_REG_REG, reg(ax, w), reg(cx, w));
+                        emit(INSTR_ADD, OPT_IMM_REG,
+                            value_of(r, w), reg(cx, w));
                         ax = cx;
                     } else {
                         emit(INSTR_ADD, OPT_IMM_MEM,
@@ -2220,18 +3262,114 @@ static enum reg compile_not(
     return ax;
 }
 
-static enum reg compile_neg(
+/*
+ * Count bits set in AX. Without popcnt, sum bits in parallel within
+ * each byte, then add up all bytes by multiplying with 0x0101...
+ */
+static void compile_popcount(int w)
+{
+    unsigned long m1, m2, m4, h01;
+
+    if (context.popcnt) {
+        emit(INSTR_POPCNT, OPT_REG_REG, reg(AX, w), reg(AX, w));
+        return;
+    }
+
+    m1 = 0x5555555555555555ul;
+    m2 = 0x3333333333333333ul;
+    m4 = 0x0F0F0F0F0F0F0F0Ful;
+    h01 = 0x0101010101010101ul;
+    if (w == 4) {
+        m1 &= 0xFFFFFFFFul;
+        m2 &= 0xFFFFFFFFul;
+        m4 &= 0xFFFFFFFFul;
+        h01 &= 0xFFFFFFFFul;
+    }
+
+    emit(INSTR_MOV, OPT_REG_REG, reg(AX, w), reg(CX, w));
+    emit(INSTR_SHR, OPT_IMM_REG, constant(1, 1), reg(CX, w));
+    emit(INSTR_MOV, OPT_IMM_REG, constant(m1, w), reg(DX, w));
+    emit(INSTR_AND, OPT_REG_REG, reg(DX, w), reg(CX, w));
+    emit(INSTR_SUB, OPT_REG_REG, reg(CX, w), reg(AX, w));
+    emit(INSTR_MOV, OPT_REG_REG, reg(AX, w), reg(CX, w));
+    emit(INSTR_SHR, OPT_IMM_REG, constant(2, 1), reg(CX, w));
+    emit(INSTR_MOV, OPT_IMM_REG, constant(m2, w), reg(DX, w));
+    emit(INSTR_AND, OPT_REG_REG, reg(DX, w), reg(AX, w));
+    emit(INSTR_AND, OPT_REG_REG, reg(DX, w), reg(CX, w));
+    emit(INSTR_ADD, OPT_REG_REG, reg(CX, w), reg(AX, w));
+    emit(INSTR_MOV, OPT_REG_REG, reg(AX, w), reg(CX, w));
+    emit(INSTR_SHR, OPT_IMM_REG, constant(4, 1), reg(CX, w));
+    emit(INSTR_ADD, OPT_REG_REG, reg(CX, w), reg(AX, w));
+    emit(INSTR_MOV, OPT_IMM_REG, constant(m4, w), reg(DX, w));
+    emit(INSTR_AND, OPT_REG_REG, reg(DX, w), reg(AX, w));
+    emit(INSTR_MOV, OPT_IMM_REG, constant(h01, w), reg(DX, w));
+    emit(INSTR_MUL, OPT_REG, reg(DX, w));
+    emit(INSTR_SHR, OPT_IMM_REG, constant(w * 8 - 8, 1), reg(AX, w));
+}
+
+/*
+ * Builtin bit operations on 32 or 64 bit operand. Use lzcnt and tzcnt
+ * only if enabled, otherwise bsr and bsf give the same result for
+ * non-zero input.
+ */
+static enum reg compile_bit_operation(
     struct var target,
+    enum optype op,
     struct var l)
 {
-    static struct symbol *c32, *c64;
-
-    enum reg xmm0, xmm1;
-    struct var val;
-    union value num = {0};
-    size_t w;
+    int w;
+    enum reg ax;
 
-    if (is_float(l.type)) {
+    w = size_of(l.type);
+    assert(w == 4 || w == 8);
+    ax = load(l, AX);
+    switch (op) {
+    default: assert(0);
+    case IR_OP_POPCNT:
+        compile_popcount(w);
+        break;
+    case IR_OP_CLZ:
+        if (context.lzcnt) {
+            emit(INSTR_LZCNT, OPT_REG_REG, reg(AX, w), reg(AX, w));
+        } else {
+            emit(INSTR_BSR, OPT_REG_REG, reg(AX, w), reg(AX, w));
+            emit(INSTR_XOR, OPT_IMM_REG, constant(w * 8 - 1, 4), reg(AX, 4));
+        }
+        break;
+    case IR_OP_CTZ:
+        emit(context.bmi ? INSTR_TZCNT : INSTR_BSF,
+            OPT_REG_REG, reg(AX, w), reg(AX, w));
+        break;
+    case IR_OP_FFS:
+        emit(INSTR_BSF, OPT_REG_REG, reg(AX, w), reg(AX, w));
+        emit(INSTR_MOV, OPT_IMM_REG, constant(-1, 4), reg(DX, 4));
+        emit(INSTR_CMOVE, OPT_REG_REG, reg(DX, 4), reg(AX, 4));
+        emit(INSTR_ADD, OPT_IMM_REG, constant(1, 4), reg(AX, 4));
+        break;
+    case IR_OP_BSWAP:
+        emit(INSTR_BSWAP, OPT_REG, reg(AX, w));
+        break;
+    }
+
+    if (!is_void(target.type)) {
+        store(ax, target);
+    }
+
+    return ax;
+}
+
+static enum reg compile_neg(
+    struct var target,
+    struct var l)
+{
+    static struct symbol *c32, *c64;
+
+    enum reg xmm0, xmm1;
+    struct var val;
+    union value num = {0};
+    size_t w;
+
+    if (is_float(l.type)) {
         if (!c32) {
             num.u = 1u << 31;
             c32 = sym_create_constant(basic_type__float, num);
@@ -2306,6 +3444,176 @@ static enum reg compile_mul(
     return ax;
 }
 
+/*
+ * Multiplier and shift amount replacing division by constant, computed
+ * as described in Hacker's Delight, chapter 10. The quotient is found
+ * in the high half of the product of dividend and multiplier. Unsigned
+ * divisors can need a multiplier one bit wider than the register, in
+ * which case the dividend is added back to the product.
+ */
+struct magic {
+    unsigned long mul;
+    int shift;
+    int add;
+};
+
+static unsigned long width_mask(int w)
+{
+    return (w == 8) ? ~0ul : 0xFFFFFFFFul;
+}
+
+static struct magic signed_magic(long d, int w)
+{
+    int p, bits;
+    unsigned long ad, anc, delta, q1, r1, q2, r2, t, top, mask;
+    struct magic mag = {0};
+
+    bits = w * 8;
+    mask = width_mask(w);
+    top = 1ul << (bits - 1);
+    ad = (d < 0) ? -(unsigned long) d & mask : (unsigned long) d;
+    t = top + (((unsigned long) d & mask) >> (bits - 1));
+    anc = t - 1 - t % ad;
+    p = bits - 1;
+    q1 = top / anc;
+    r1 = top - q1 * anc;
+    q2 = top / ad;
+    r2 = top - q2 * ad;
+    do {
+        p++;
+        q1 = (2 * q1) & mask;
+        r1 = (2 * r1) & mask;
+        if (r1 >= anc) {
+            q1 = (q1 + 1) & mask;
+            r1 -= anc;
+        }
+        q2 = (2 * q2) & mask;
+        r2 = (2 * r2) & mask;
+        if (r2 >= ad) {
+            q2 = (q2 + 1) & mask;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    mag.mul = (q2 + 1) & mask;
+    if (d < 0) {
+        mag.mul = -mag.mul & mask;
+    }
+
+    mag.shift = p - bits;
+    return mag;
+}
+
+static struct magic unsigned_magic(unsigned long d, int w)
+{
+    int p, bits;
+    unsigned long q, r, delta, top, mask, p2;
+    struct magic mag = {0};
+
+    bits = w * 8;
+    mask = width_mask(w);
+    top = 1ul << (bits - 1);
+    p = bits - 1;
+    p2 = 0;
+    q = (top - 1) / d;
+    r = (top - 1) - q * d;
+    do {
+        p++;
+        p2 = (p == bits) ? 1 : 2 * p2;
+        if (r + 1 >= d - r) {
+            if (q >= top - 1) {
+                mag.add = 1;
+            }
+            q = (2 * q + 1) & mask;
+            r = (2 * r + 1 - d) & mask;
+        } else {
+            if (q >= top) {
+                mag.add = 1;
+            }
+            q = (2 * q) & mask;
+            r = (2 * r + 1) & mask;
+        }
+        delta = d - 1 - r;
+    } while (p < 2 * bits && p2 < delta);
+
+    mag.mul = (q + 1) & mask;
+    mag.shift = p - bits;
+    return mag;
+}
+
+/*
+ * Division by constant is replaced by multiplication, except for
+ * powers of two, which are left for the optimizer, and trivial or
+ * undefined cases.
+ */
+static int is_magic_divisor(Type type, struct var r)
+{
+    int w;
+    unsigned long d;
+
+    if (r.kind != IMMEDIATE || r.symbol || !is_integer(r.type))
+        return 0;
+
+    w = size_of(type);
+    d = r.imm.u & width_mask(w);
+    if (is_signed(type) && (d & (1ul << (w * 8 - 1)))) {
+        d = -d & width_mask(w);
+    }
+
+    return (d & (d - 1)) != 0;
+}
+
+/*
+ * Compute quotient of dividend in %rax and constant divisor, without
+ * using division instruction. The result is stored in %rdx, and the
+ * dividend is kept in %rcx.
+ */
+static void emit_magic_division(Type type, long d)
+{
+    int w;
+    unsigned long top;
+    struct magic mag;
+
+    w = size_of(type);
+    top = 1ul << (w * 8 - 1);
+    emit(INSTR_MOV, OPT_REG_REG, reg(AX, w), reg(CX, w));
+    if (is_signed(type)) {
+        if (w == 4) {
+            d = (int) d;
+        }
+        mag = signed_magic(d, w);
+        emit(INSTR_MOV, OPT_IMM_REG, constant(mag.mul, w), reg(DX, w));
+        emit(INSTR_IMUL, OPT_REG, reg(DX, w));
+        if (d > 0 && (mag.mul & top)) {
+            emit(INSTR_ADD, OPT_REG_REG, reg(CX, w), reg(DX, w));
+        } else if (d < 0 && !(mag.mul & top)) {
+            emit(INSTR_SUB, OPT_REG_REG, reg(CX, w), reg(DX, w));
+        }
+        if (mag.shift) {
+            emit(INSTR_SAR, OPT_IMM_REG, constant(mag.shift, 1), reg(DX, w));
+        }
+        emit(INSTR_MOV, OPT_REG_REG, reg(DX, w), reg(AX, w));
+        emit(INSTR_SHR, OPT_IMM_REG, constant(w * 8 - 1, 1), reg(AX, w));
+        emit(INSTR_ADD, OPT_REG_REG, reg(AX, w), reg(DX, w));
+    } else {
+        mag = unsigned_magic(d & width_mask(w), w);
+        emit(INSTR_MOV, OPT_IMM_REG, constant(mag.mul, w), reg(DX, w));
+        emit(INSTR_MUL, OPT_REG, reg(DX, w));
+        if (mag.add) {
+            assert(mag.shift > 0);
+            emit(INSTR_MOV, OPT_REG_REG, reg(CX, w), reg(AX, w));
+            emit(INSTR_SUB, OPT_REG_REG, reg(DX, w), reg(AX, w));
+            emit(INSTR_SHR, OPT_IMM_REG, constant(1, 1), reg(AX, w));
+            emit(INSTR_ADD, OPT_REG_REG, reg(AX, w), reg(DX, w));
+            mag.shift -= 1;
+        }
+        if (mag.shift) {
+            emit(INSTR_SHR, OPT_IMM_REG, constant(mag.shift, 1), reg(DX, w));
+        }
+    }
+}
+
 static enum reg compile_div(
     struct var target,
     Type type,
@@ -2337,6 +3645,15 @@ static enum reg compile_div(
     } else {
         ax = load_cast(l, l.type);
         assert(ax == AX);
+        if (is_magic_divisor(type, r)) {
+            w = size_of(type);
+            emit_magic_division(type, r.imm.i);
+            emit(INSTR_MOV, OPT_REG_REG, reg(DX, w), reg(AX, w));
+            if (!is_void(target.type)) {
+                store(AX, target);
+            }
+            return AX;
+        }
         if (is_signed(l.type)) {
             if (size_of(l.type) == 8) {
                 emit(INSTR_CQO, OPT_NONE);
@@ -2373,12 +3690,25 @@ static enum reg compile_mod(
     struct var l,
     struct var r)
 {
+    int w;
     enum opcode opc;
     enum reg ax;
     assert(!is_real(type));
 
     ax = load_cast(l, l.type);
     assert(ax == AX);
+    if (is_magic_divisor(type, r)) {
+        w = size_of(type);
+        emit_magic_division(type, r.imm.i);
+        emit(INSTR_MOV, OPT_IMM_REG, constant(r.imm.i, w), reg(AX, w));
+        emit(INSTR_MUL, OPT_REG, reg(DX, w));
+        emit(INSTR_SUB, OPT_REG_REG, reg(AX, w), reg(CX, w));
+        if (!is_void(target.type)) {
+            store(CX, target);
+        }
+        return CX;
+    }
+
     if (is_signed(l.type)) {
         if (size_of(l.type) == 8) {
             emit(INSTR_CQO, OPT_NONE);
@@ -2441,19 +3771,30 @@ static enum reg compile_bitwise(
 
 /*
  * Shift instruction encoding is either by immediate, or implicit %cl
- * register. Encode as if something other than %cl could be chosen.
- * 
+ * register. Shift by constant amount is masked to the number of bits
+ * in the register, like the processor would do.
+ *
  * Behavior is undefined if shift is greater than integer width, so
  * don't care about overflow or sign.
  */
+static void emit_shift(enum opcode opcode, struct var r, int w)
+{
+    if (r.kind == IMMEDIATE && !r.symbol) {
+        emit(opcode, OPT_IMM_REG, constant(r.imm.u & (w * 8 - 1), 1),
+            reg(AX, w));
+    } else {
+        load(r, CX);
+        emit(opcode, OPT_REG_REG, reg(CX, 1), reg(AX, w));
+    }
+}
+
 static enum reg compile_shl(
     struct var target,
     struct var l,
     struct var r)
 {
     load(l, AX);
-    load(r, CX);
-    emit(INSTR_SHL, OPT_REG_REG, reg(CX, 1), reg(AX, size_of(l.type)));
+    emit_shift(INSTR_SHL, r, size_of(l.type));
     if (!is_void(target.type)) {
         store(AX, target);
     }
@@ -2467,12 +3808,8 @@ static enum reg compile_shr(
     struct var r)
 {
     load(l, AX);
-    load(r, CX);
-    if (is_unsigned(l.type)) {
-        emit(INSTR_SHR, OPT_REG_REG, reg(CX, 1), reg(AX, size_of(l.type)));
-    } else {
-        emit(INSTR_SAR, OPT_REG_REG, reg(CX, 1), reg(AX, size_of(l.type)));
-    }
+    emit_shift(is_unsigned(l.type) ? INSTR_SHR : INSTR_SAR,
+        r, size_of(l.type));
 
     if (!is_void(target.type)) {
         store(AX, target);
@@ -2493,7 +3830,7 @@ static enum reg compile_shr(
 static enum reg set_compare_value(Type type, enum opcode op)
 {
     emit(op, OPT_REG, reg(AX, 1));
-    if (is_real(type)) {
+    if (is_real(type) && !context.no_honor_nans) {
         if (op == INSTR_SETE) {
             emit(INSTR_SETNP, OPT_REG, reg(CX, 1));
             emit(INSTR_AND, OPT_REG_REG, reg(CX, 1), reg(AX, 1));
@@ -2508,6 +3845,35 @@ static enum reg set_compare_value(Type type, enum opcode op)
     return AX;
 }
 
+/*
+ * Alignment known for memory referenced by variable, either from
+ * definition of global symbol, or assumed for pointer by
+ * __builtin_assume_aligned.
+ */
+static int known_alignment(struct var var)
+{
+    int align;
+
+    switch (var.kind) {
+    case DIRECT:
+        if (var.symbol->linkage == LINK_NONE)
+            return 1;
+        align = sym_alignment(var.symbol);
+        break;
+    case DEREF:
+        align = 1 << var.symbol->assume_aligned;
+        break;
+    default:
+        return 1;
+    }
+
+    while (var.offset % align) {
+        align /= 2;
+    }
+
+    return align;
+}
+
 /*
  * Write object from address returned by evaluating an expression. Used
  * for assignment of objects that do not fit in a single register.
@@ -2520,18 +3886,25 @@ static enum reg set_compare_value(Type type, enum opcode op)
  */
 static void store_copy_object(struct var var, struct var target)
 {
+    int align;
+
     if (is_array(var.type)) {
         assert(target.kind == DIRECT);
         assert(is_string(var));
         assert(type_equal(target.type, var.type));
         emit(INSTR_LEA, OPT_MEM_REG, location_of(var, 8), reg(SI, 8));
+        align = 1;
     } else {
         load_address(var, SI);
+        align = known_alignment(var);
     }
 
     load_address(target, DI);
-    emit(INSTR_MOV, OPT_IMM_REG, constant(size_of(target.type), 4), reg(DX, 4));
-    emit(INSTR_CALL, OPT_IMM, addr(decl_memcpy));
+    if (known_alignment(target) < align) {
+        align = known_alignment(target);
+    }
+
+    emit_copy(SI, DI, size_of(target.type), align);
 }
 
 static enum reg compile_cast(
@@ -2643,6 +4016,13 @@ static enum reg compile_assign(struct var target, struct expression expr)
     case IR_OP_NEG:
         ax = compile_neg(target, expr.l);
         break;
+    case IR_OP_POPCNT:
+    case IR_OP_CLZ:
+    case IR_OP_CTZ:
+    case IR_OP_FFS:
+    case IR_OP_BSWAP:
+        ax = compile_bit_operation(target, expr.op, expr.l);
+        break;
     case IR_OP_ADD:
         ax = compile_add(target, expr.type, expr.l, expr.r);
         break;
@@ -2717,6 +4097,126 @@ static void compile_vla_alloc(
     store(SP, var_direct(sym->value.vla_address));
 }
 
+/*
+ * Assign source to target only if condition is true, without branching.
+ * The condition is evaluated first to set flags, which must not be
+ * clobbered by loading operands. Only plain moves are used after the
+ * comparison, not for example xor to clear a register.
+ *
+ * Targets in memory are written back unconditionally. This is only
+ * done for local variables without their address taken, where storing
+ * the unchanged value cannot be observed.
+ */
+static void compile_cmov(
+    struct var target,
+    struct var source,
+    struct expression cond)
+{
+    int w;
+    enum reg ax, dx;
+    enum opcode cmov;
+
+    assert(is_scalar(cond.type));
+    if (is_comparison(cond)) {
+        switch (compile_compare(cond.op, cond.l, cond.r)) {
+        default: assert(0);
+        case INSTR_SETE:
+            cmov = INSTR_CMOVE;
+            break;
+        case INSTR_SETNE:
+            cmov = INSTR_CMOVNE;
+            break;
+        case INSTR_SETG:
+            cmov = INSTR_CMOVG;
+            break;
+        case INSTR_SETNG:
+            cmov = INSTR_CMOVNG;
+            break;
+        case INSTR_SETA:
+            cmov = INSTR_CMOVA;
+            break;
+        case INSTR_SETNA:
+            cmov = INSTR_CMOVNA;
+            break;
+        case INSTR_SETGE:
+            cmov = INSTR_CMOVGE;
+            break;
+        case INSTR_SETNGE:
+            cmov = INSTR_CMOVNGE;
+            break;
+        case INSTR_SETAE:
+            cmov = INSTR_CMOVAE;
+            break;
+        case INSTR_SETNAE:
+            cmov = INSTR_CMOVNAE;
+            break;
+        }
+    } else {
+        assert(!is_real(cond.type));
+        ax = compile_expression(cond);
+        w = size_of(cond.type);
+        emit(INSTR_CMP, OPT_IMM_REG, constant(0, w), reg(ax, w));
+        cmov = INSTR_CMOVNE;
+    }
+
+    w = size_of(target.type);
+    assert(w == 4 || w == 8);
+    assert(target.kind == DIRECT && !is_field(target));
+    assert(target.symbol->linkage == LINK_NONE);
+    dx = allocated_register(target);
+    if (!dx) {
+        dx = DX;
+        emit_load(INSTR_MOV, target, reg(dx, w));
+    }
+
+    if (source.kind == IMMEDIATE) {
+        emit(INSTR_MOV, OPT_IMM_REG, value_of(source, w), reg(R11, w));
+        emit(cmov, OPT_REG_REG, reg(R11, w), reg(dx, w));
+    } else if ((ax = allocated_register(source)) != 0) {
+        emit(cmov, OPT_REG_REG, reg(ax, w), reg(dx, w));
+    } else if (is_global_offset(source.symbol)) {
+        emit_load(INSTR_MOV, source, reg(R11, w));
+        emit(cmov, OPT_REG_REG, reg(R11, w), reg(dx, w));
+    } else {
+        assert(source.kind == DIRECT && !is_field(source));
+        emit(cmov, OPT_MEM_REG, location_of(source, w), reg(dx, w));
+    }
+
+    if (dx == DX) {
+        store(dx, target);
+    }
+}
+
+/*
+ * Prefetch memory at address. Hint is encoded as rw << 2 | locality,
+ * where locality 3 means keeping data in all levels of cache.
+ */
+static void compile_prefetch(struct var hint, struct var addr)
+{
+    enum reg ax;
+    enum opcode op;
+
+    assert(hint.kind == IMMEDIATE);
+    if (hint.imm.i >> 2) {
+        op = INSTR_PREFETCHW;
+    } else {
+        switch (hint.imm.i & 3) {
+        default: assert(0);
+        case 0: op = INSTR_PREFETCHNTA; break;
+        case 1: op = INSTR_PREFETCHT2; break;
+        case 2: op = INSTR_PREFETCHT1; break;
+        case 3: op = INSTR_PREFETCHT0; break;
+        }
+    }
+
+    ax = allocated_register(addr);
+    if (!ax) {
+        ax = load(addr, AX);
+    }
+
+    emit(op, OPT_MEM, location(address(0, ax, 0, 0), 1));
+}
+
 static void compile_statement(struct statement stmt)
 {
     switch (stmt.st) {
@@ -2728,6 +4228,10 @@ static void compile_statement(struct statement stmt)
         assert(is_identity(stmt.expr));
         compile__builtin_va_start(stmt.expr.l);
         break;
+    case IR_PREFETCH:
+        assert(is_identity(stmt.expr));
+        compile_prefetch(stmt.t, stmt.expr.l);
+        break;
     case IR_EXPR:
         stmt.t.type = basic_type__void;
     case IR_ASSIGN:
@@ -2738,6 +4242,12 @@ static void compile_statement(struct statement stmt)
         assert(stmt.t.symbol);
         compile_vla_alloc(stmt.t.symbol, stmt.expr);
         break;
+    case IR_CMOV:
+        compile_cmov(
+            stmt.t,
+            array_get(&definition->sources, stmt.source),
+            stmt.expr);
+        break;
     }
 
     relase_regs();
@@ -2809,45 +4319,741 @@ static void compile_return(Type func, struct expression expr)
             location(address(return_address_offset, BP, 0, 0), 8), reg(DI, 8));
         emit(INSTR_CMP, OPT_REG_REG, reg(DI, 8), reg(SI, 8));
         emit(INSTR_JE, OPT_IMM, addr(label));
-        emit(INSTR_MOV, OPT_IMM_REG, constant(w, 8), reg(DX, 8));
-        emit(INSTR_CALL, OPT_IMM, addr(decl_memcpy));
+        emit_copy(SI, DI, w, 1);
+        enter_label(label);
         emit(INSTR_MOV, OPT_MEM_REG,
             location(address(return_address_offset, BP, 0, 0), 8), reg(AX, 8));
-        enter_context(label);
         break;
     }
 
     assert(x87_stack == 0);
 }
 
+/*
+ * Emit conditional jump to one of the successors of block, followed by
+ * unconditional jump to the other unless it is the next block to be
+ * emitted. Opcodes jtrue and jfalse jump iff the condition evaluates
+ * to true and false, respectively.
+ */
+static void compile_branch(
+    struct block *block,
+    struct block *next,
+    enum opcode jtrue,
+    enum opcode jfalse)
+{
+    if (block->jump[1] == next) {
+        emit(jfalse, OPT_IMM, addr(block->jump[0]->label));
+    } else {
+        emit(jtrue, OPT_IMM, addr(block->jump[1]->label));
+        if (block->jump[0] != next) {
+            emit(INSTR_JMP, OPT_IMM, addr(block->jump[0]->label));
+        }
+    }
+}
+
+/*
+ * Branch on result of floating point comparison, where unordered
+ * operands compare not equal. Jump to the first successor when equal
+ * is set, otherwise the second. With -fno-honor-nans, the parity flag
+ * is ignored.
+ */
+static void compile_unordered_branch(
+    struct block *block,
+    struct block *next,
+    int equal)
+{
+    struct block *eq, *ne;
+
+    if (context.no_honor_nans) {
+        if (equal) {
+            compile_branch(block, next, INSTR_JE, INSTR_JNE);
+        } else {
+            compile_branch(block, next, INSTR_JNE, INSTR_JE);
+        }
+        return;
+    }
+
+    eq = block->jump[equal != 0];
+    ne = block->jump[equal == 0];
+    if (next == ne) {
+        emit(INSTR_JP, OPT_IMM, addr(ne->label));
+        emit(INSTR_JE, OPT_IMM, addr(eq->label));
+    } else {
+        emit(INSTR_JNE, OPT_IMM, addr(ne->label));
+        emit(INSTR_JP, OPT_IMM, addr(ne->label));
+        if (eq != next) {
+            emit(INSTR_JMP, OPT_IMM, addr(eq->label));
+        }
+    }
+}
+
+static struct temp_usage *usage_of(const struct symbol *sym)
+{
+    int i;
+
+    if (!sym || !is_temporary(sym))
+        return NULL;
+
+    i = sym->n - first_temporary;
+    if (i < 0 || i >= array_len(&temp_usage))
+        return NULL;
+
+    return &array_get(&temp_usage, i);
+}
+
+static void count_read(struct var var)
+{
+    struct temp_usage *usage;
+
+    usage = usage_of(var.symbol);
+    if (usage && usage->reads < 2) {
+        usage->reads++;
+    }
+}
+
+static void count_write(struct var var)
+{
+    struct temp_usage *usage;
+
+    usage = usage_of(var.symbol);
+    if (usage && usage->writes < 2) {
+        usage->writes++;
+    }
+}
+
+static void count_expression(struct expression expr)
+{
+    count_read(expr.l);
+    if (!is_unary_operation(expr)) {
+        count_read(expr.r);
+    }
+}
+
+/*
+ * Count reads and writes of each temporary in function definition.
+ */
+static void count_temporary_usage(struct definition *def)
+{
+    int i, j, lo, hi, n;
+    struct block *block;
+    struct statement *st;
+    const struct symbol *sym;
+
+    lo = SHRT_MAX;
+    hi = SHRT_MIN;
+    for (i = 0; i < array_len(&def->locals); ++i) {
+        sym = array_get(&def->locals, i);
+        if (is_temporary(sym)) {
+            lo = (sym->n < lo) ? sym->n : lo;
+            hi = (sym->n > hi) ? sym->n : hi;
+        }
+    }
+
+    array_empty(&temp_usage);
+    if (lo > hi)
+        return;
+
+    n = hi - lo + 1;
+    first_temporary = lo;
+    array_realloc(&temp_usage, n);
+    temp_usage.length = n;
+    array_zero(&temp_usage);
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        for (j = 0; j < array_len(&block->code); ++j) {
+            st = &array_get(&block->code, j);
+            switch (st->st) {
+            case IR_ASSIGN:
+            case IR_VLA_ALLOC:
+                if (st->t.kind == DIRECT) {
+                    count_write(st->t);
+                } else {
+                    count_read(st->t);
+                }
+                break;
+            case IR_CMOV:
+                count_read(st->t);
+                count_write(st->t);
+                count_read(array_get(&def->sources, st->source));
+                break;
+            default:
+                break;
+            }
+            count_expression(st->expr);
+        }
+        if (block->jump[1] || block->has_return_value || block->indirect) {
+            count_expression(block->expr);
+        }
+    }
+}
+
+static int is_single_use(struct var var)
+{
+    struct temp_usage *usage;
+
+    usage = usage_of(var.symbol);
+    return usage && usage->reads == 1 && usage->writes == 1;
+}
+
+static int is_qword_operand(struct var var)
+{
+    return var.kind == DIRECT
+        && !is_field(var)
+        && !is_volatile(var.type)
+        && (is_integer(var.type) || is_pointer(var.type))
+        && size_of(var.type) == 8;
+}
+
+/*
+ * Determine if variable can be modified by statements in the range
+ * [from, to) of block. Only temporaries are known to not be written
+ * through pointers or by function calls.
+ */
+static int is_clobbered(
+    const struct block *block,
+    int from,
+    int to,
+    struct var var)
+{
+    const struct statement *st;
+
+    if (var.kind != DIRECT)
+        return 0;
+
+    for (; from < to; ++from) {
+        st = &array_get(&block->code, from);
+        switch (st->st) {
+        case IR_ASSIGN:
+        case IR_VLA_ALLOC:
+        case IR_CMOV:
+            if (st->t.kind == DIRECT && st->t.symbol == var.symbol)
+                return 1;
+            if (st->t.kind == DEREF && !is_temporary(var.symbol))
+                return 1;
+            break;
+        default:
+            break;
+        }
+
+        if (!is_temporary(var.symbol)
+            && (st->st == IR_VA_START || has_side_effects(st->expr)))
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Find statement before position i in block defining single use
+ * temporary variable, or -1 if not found.
+ */
+static int find_definition(const struct block *block, int i, struct var var)
+{
+    const struct statement *st;
+
+    if (!is_qword_operand(var) || var.offset || !is_single_use(var))
+        return -1;
+
+    while (i--) {
+        st = &array_get(&block->code, i);
+        if (st->t.kind == DIRECT && st->t.symbol == var.symbol) {
+            return st->st == IR_ASSIGN ? i : -1;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * Fold definition of temporary at position j into address mode used at
+ * position i, if it computes a scaled index or another address.
+ */
+static int fold_definition(
+    const struct block *block,
+    int j,
+    int i,
+    struct address_mode *mode)
+{
+    struct var x;
+    struct expression expr;
+    const struct address_mode *prev;
+
+    prev = &array_get(&modes, j);
+    expr = array_get(&block->code, j).expr;
+    if (prev->kind == MODE_LEA) {
+        if (is_clobbered(block, j + 1, i, prev->base)
+            || (prev->scale && is_clobbered(block, j + 1, i, prev->index)))
+            return 0;
+        *mode = *prev;
+        return 1;
+    }
+
+    if (expr.op != IR_OP_MUL && expr.op != IR_OP_SHL)
+        return 0;
+
+    x = expr.l;
+    if (expr.op == IR_OP_MUL && expr.l.kind == IMMEDIATE) {
+        x = expr.r;
+        expr.r = expr.l;
+    }
+
+    if (!is_qword_operand(x)
+        || expr.r.kind != IMMEDIATE
+        || expr.r.symbol
+        || !is_integer(expr.r.type)
+        || is_clobbered(block, j + 1, i, x))
+        return 0;
+
+    if (expr.op == IR_OP_SHL) {
+        if (expr.r.imm.i < 0 || expr.r.imm.i > 3)
+            return 0;
+        expr.r.imm.i = 1 << expr.r.imm.i;
+    }
+
+    switch (expr.r.imm.i) {
+    default: return 0;
+    case 1:
+    case 2:
+    case 4:
+    case 8:
+        break;
+    }
+
+    mode->index = x;
+    mode->scale = (int) expr.r.imm.i;
+    return 1;
+}
+
+/*
+ * Decompose operand of address calculation at position i in block.
+ * Index of a statement folded into the address is written to def.
+ */
+static int decompose_address(
+    const struct block *block,
+    int i,
+    struct var var,
+    struct address_mode *mode,
+    int *def)
+{
+    *def = -1;
+    memset(mode, 0, sizeof(*mode));
+    switch (var.kind) {
+    case IMMEDIATE:
+        if (var.symbol || !is_integer(var.type)
+            || var.imm.i < INT_MIN || var.imm.i > INT_MAX)
+            return 0;
+        mode->disp = (int) var.imm.i;
+        break;
+    case ADDRESS:
+        if (var.symbol->linkage == LINK_NONE
+            && (is_temporary(var.symbol) || is_vla(var.symbol->type)))
+            return 0;
+        mode->base = var;
+        break;
+    case DIRECT:
+        if (!is_qword_operand(var))
+            return 0;
+        *def = find_definition(block, i, var);
+        if (*def >= 0 && fold_definition(block, *def, i, mode)) {
+            mode->folded += 1;
+        } else {
+            *def = -1;
+            mode->base = var;
+        }
+        break;
+    default:
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Combine two partial address modes, converting a second base to index
+ * with scale 1. Fail if the result cannot be encoded as memory operand.
+ */
+static int combine_address(
+    struct address_mode a,
+    struct address_mode b,
+    struct address_mode *mode)
+{
+    long disp;
+    struct address_mode c;
+
+    disp = (long) a.disp + b.disp;
+    if (disp < INT_MIN || disp > INT_MAX)
+        return 0;
+
+    if (!a.base.symbol) {
+        c = a;
+        a = b;
+        b = c;
+    }
+
+    if (a.base.symbol && b.base.symbol) {
+        if (a.scale || b.scale)
+            return 0;
+        if (b.base.kind != DIRECT) {
+            if (a.base.kind != DIRECT)
+                return 0;
+            c = a;
+            a = b;
+            b = c;
+        }
+        b.index = b.base;
+        b.scale = 1;
+    } else if (a.scale && b.scale) {
+        return 0;
+    }
+
+    *mode = a;
+    mode->disp = (int) disp;
+    mode->folded = a.folded + b.folded;
+    if (b.scale) {
+        mode->index = b.index;
+        mode->scale = b.scale;
+    }
+
+    if (!mode->base.symbol) {
+        if (mode->scale != 1)
+            return 0;
+        mode->base = mode->index;
+        mode->scale = 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Determine if pointer computed by statement can be folded into memory
+ * operand of the following statement, dereferencing it exactly once.
+ */
+static int is_fold_operand(struct var var, const struct symbol *sym)
+{
+    return var.kind == DEREF
+        && var.symbol == sym
+        && is_scalar(var.type)
+        && !is_long_double(var.type)
+        && !is_field(var);
+}
+
+static int is_fold_statement(
+    const struct statement *st,
+    const struct symbol *sym)
+{
+    if ((st->st != IR_ASSIGN && st->st != IR_EXPR)
+        || has_side_effects(st->expr))
+        return 0;
+
+    return (st->st == IR_ASSIGN && is_fold_operand(st->t, sym))
+        || is_fold_operand(st->expr.l, sym)
+        || (!is_unary_operation(st->expr) && is_fold_operand(st->expr.r, sym));
+}
+
+static int is_fold_branch(const struct block *block, const struct symbol *sym)
+{
+    if ((!block->jump[1] && !block->has_return_value && !block->indirect)
+        || has_side_effects(block->expr)
+        || !is_scalar(block->expr.type))
+        return 0;
+
+    return is_fold_operand(block->expr.l, sym)
+        || (!is_unary_operation(block->expr) && is_fold_operand(block->expr.r, sym));
+}
+
+/*
+ * Match statement computing t = a + b, where both operands are 64 bit,
+ * and the result can be expressed as a memory operand.
+ */
+static void select_address_mode(const struct block *block, int i)
+{
+    int j, k;
+    struct address_mode a, b, *mode;
+    const struct statement *st;
+    const struct symbol *sym;
+
+    st = &array_get(&block->code, i);
+    if (st->st != IR_ASSIGN
+        || st->expr.op != IR_OP_ADD
+        || !is_qword_operand(st->t)
+        || !decompose_address(block, i, st->expr.l, &a, &j)
+        || !decompose_address(block, i, st->expr.r, &b, &k))
+        return;
+
+    mode = &array_get(&modes, i);
+    if (!combine_address(a, b, mode))
+        return;
+
+    sym = st->t.symbol;
+    if (is_single_use(st->t) && !st->t.offset
+        && ((i + 1 < array_len(&block->code)
+                && is_fold_statement(&array_get(&block->code, i + 1), sym))
+            || (i + 1 == array_len(&block->code)
+                && is_fold_branch(block, sym))))
+    {
+        mode->kind = MODE_FOLD;
+    } else if (mode->folded) {
+        mode->kind = MODE_LEA;
+    } else {
+        mode->kind = MODE_NONE;
+        return;
+    }
+
+    if (j >= 0) {
+        array_get(&modes, j).kind = MODE_SKIP;
+    }
+
+    if (k >= 0) {
+        array_get(&modes, k).kind = MODE_SKIP;
+    }
+}
+
+/*
+ * Compute address of statement folding address arithmetic.
+ */
+static void compile_lea(struct var target, struct address_mode mode)
+{
+    enum reg ax;
+    struct address addr;
+
+    addr = address_from_mode(mode, 0);
+    if ((ax = allocated_register(target)) != 0) {
+        emit(INSTR_LEA, OPT_MEM_REG, location(addr, 8), reg(ax, 8));
+    } else {
+        emit(INSTR_LEA, OPT_MEM_REG, location(addr, 8), reg(AX, 8));
+        store(AX, target);
+    }
+}
+
+/*
+ * Restore callee saved registers used for register allocation, and
+ * return from function.
+ */
+static void compile_epilogue(int regs)
+{
+    int i;
+
+    if (regs) {
+        emit(INSTR_LEA, OPT_MEM_REG,
+            location(address(-regs * 8, BP, 0, 0), 8),
+            reg(SP, 8));
+        for (i = regs; i > 0; --i) {
+            emit(INSTR_POP, OPT_REG, reg(temp_int_reg[i - 1], 8));
+        }
+    }
+
+    emit(INSTR_LEAVE, OPT_NONE);
+    emit(INSTR_RET, OPT_NONE);
+}
+
+static void add_back_edge_target(const struct block *target, int i)
+{
+    int j;
+
+    if (block_position(target) > i)
+        return;
+
+    for (j = 0; j < array_len(&back_edge_targets); ++j) {
+        if (array_get(&back_edge_targets, j) == target)
+            return;
+    }
+
+    array_push_back(&back_edge_targets, target);
+}
+
+/*
+ * Find blocks that are the target of a jump from itself or a block
+ * placed after it.
+ */
+static void find_back_edge_targets(struct definition *def)
+{
+    int i, j;
+    const struct block *block;
+
+    array_empty(&back_edge_targets);
+    index_block_positions(def);
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        for (j = 0; j < 2 && block->jump[j]; ++j) {
+            add_back_edge_target(block->jump[j], i);
+        }
+
+        for (j = 0; j < array_len(&block->targets); ++j) {
+            add_back_edge_target(array_get(&block->targets, j), i);
+        }
+    }
+}
+
+static int is_back_edge_target(const struct block *block)
+{
+    int i;
+
+    for (i = 0; i < array_len(&back_edge_targets); ++i) {
+        if (array_get(&back_edge_targets, i) == block)
+            return 1;
+    }
+
+    return 0;
+}
+
 /*
  * Emit code for all statements in a block, jump to children based on
- * compare result, or return value in case of no children.
+ * compare result, jump to computed address, or return value in case of
+ * no children. Jumps to the block emitted next are omitted, falling
+ * through instead.
  *
  * Most of the complexity deals with interpreting the last block->expr
  * object, branchhing to the correct next block. All scalar expressions
  * are allowed.
  */
-static void compile_block(struct block *block, Type type, int regs)
+/*
+ * Determine if statement stores a constant with all bits zero to local
+ * variable in memory.
+ */
+static int is_zero_store(struct statement st)
 {
-    int i;
+    union value val = {0};
+
+    if (st.st != IR_ASSIGN
+        || st.t.kind != DIRECT
+        || st.t.symbol->linkage != LINK_NONE
+        || is_field(st.t)
+        || is_volatile(st.t.type)
+        || is_register_allocated(st.t)
+        || !is_identity(st.expr)
+        || st.expr.l.kind != IMMEDIATE
+        || is_string(st.expr.l))
+        return 0;
+
+    switch (type_of(st.t.type)) {
+    case T_FLOAT:
+        val.f = st.expr.l.imm.f;
+        break;
+    case T_DOUBLE:
+        val.d = st.expr.l.imm.d;
+        break;
+    case T_LDOUBLE:
+        return 0;
+    default:
+        val.u = st.expr.l.imm.u;
+        break;
+    }
+
+    return val.u == 0;
+}
+
+/*
+ * Clear local aggregate with 16 byte SSE stores of a zeroed %xmm0, if
+ * statements starting at index i store zero to at least 16 contiguous
+ * bytes of the same variable. Zero initialization is expressed in IR
+ * as one assignment per member or eight byte chunk, which otherwise
+ * becomes a long series of integer moves.
+ *
+ * Return number of statements compiled, or 0 if no such run is found.
+ */
+static int compile_zero_run(struct block *block, int i)
+{
+    int n, w;
+    size_t j, size;
+    struct var target;
+    struct statement st;
+
+    st = array_get(&block->code, i);
+    if (!is_zero_store(st))
+        return 0;
+
+    target = st.t;
+    size = size_of(st.t.type);
+    for (n = 1; i + n < array_len(&block->code); ++n) {
+        st = array_get(&block->code, i + n);
+        if (array_get(&modes, i + n).kind != MODE_NONE
+            || !is_zero_store(st)
+            || st.t.symbol != target.symbol
+            || st.t.offset != target.offset + size)
+            break;
+
+        size += size_of(st.t.type);
+    }
+
+    if (size < 16)
+        return 0;
+
+    emit(INSTR_PXOR, OPT_REG_REG, reg(XMM0, 8), reg(XMM0, 8));
+    for (j = 0; j < size; j += w) {
+        w = (size - j >= 16) ? 16
+          : (size - j >= 8) ? 8
+          : (size - j >= 4) ? 4
+          : (size - j >= 2) ? 2 : 1;
+        if (w == 16) {
+            emit(INSTR_MOVUPS, OPT_REG_MEM,
+                reg(XMM0, w), location_of(target, w));
+        } else {
+            emit(INSTR_MOV, OPT_IMM_MEM,
+                constant(0, w), location_of(target, w));
+        }
+        target.offset += w;
+    }
+
+    return n;
+}
+
+static void compile_block(
+    struct block *block,
+    struct block *next,
+    Type type,
+    int regs)
+{
+    int i, n;
     enum reg ax;
     enum reg xmm0, xmm1;
     enum opcode cmp;
     struct statement st;
 
     assert(is_function(type));
-    if (block->color == BLACK)
-        return;
+    if (context.align_loops > 1 && is_back_edge_target(block)) {
+        emit_alignment(context.align_loops);
+    }
+
+    enter_label(block->label);
+    i = array_len(&block->code);
+    array_empty(&modes);
+    array_realloc(&modes, i);
+    modes.length = i;
+    array_zero(&modes);
+    for (i = 0; i < array_len(&block->code); ++i) {
+        select_address_mode(block, i);
+    }
 
-    block->color = BLACK;
-    enter_context(block->label);
     for (i = 0; i < array_len(&block->code); ++i) {
         st = array_get(&block->code, i);
-        compile_statement(st);
+        switch (array_get(&modes, i).kind) {
+        case MODE_SKIP:
+            break;
+        case MODE_FOLD:
+            folded_pointer = st.t.symbol;
+            folded_address = array_get(&modes, i);
+            break;
+        case MODE_LEA:
+            compile_lea(st.t, array_get(&modes, i));
+            relase_regs();
+            break;
+        case MODE_NONE:
+            n = compile_zero_run(block, i);
+            if (n) {
+                i += n - 1;
+            } else {
+                compile_statement(st);
+            }
+            folded_pointer = NULL;
+            break;
+        }
     }
 
-    if (!block->jump[0] && !block->jump[1]) {
+    if (block->indirect) {
+        ax = compile_expression(block->expr);
+        emit(INSTR_JMP, OPT_REG, reg(ax, 8));
+        relase_regs();
+    } else if (!block->jump[0] && !block->jump[1]) {
         if (block->has_return_value) {
             assert(is_object(block->expr.type));
             assert(type_equal(block->expr.type, type_next(type)));
@@ -2855,21 +5061,18 @@ static void compile_block(struct block *block, Type type, int regs)
             relase_regs();
             assert(x87_stack == 0);
         }
-        if (regs) {
-            emit(INSTR_LEA, OPT_MEM_REG,
-                location(address(-regs * 8, BP, 0, 0), 8),
-                reg(SP, 8));
-            for (i = regs; i > 0; --i) {
-                emit(INSTR_POP, OPT_REG, reg(temp_int_reg[i - 1], 8));
-            }
+        if (!epilogue) {
+            compile_epilogue(regs);
+        } else if (next) {
+            emit(INSTR_JMP, OPT_IMM, addr(epilogue));
+        } else {
+            enter_label(epilogue);
+            compile_epilogue(regs);
+            epilogue = NULL;
         }
-        emit(INSTR_LEAVE, OPT_NONE);
-        emit(INSTR_RET, OPT_NONE);
     } else if (!block->jump[1]) {
-        if (block->jump[0]->color == BLACK) {
+        if (block->jump[0] != next) {
             emit(INSTR_JMP, OPT_IMM, addr(block->jump[0]->label));
-        } else {
-            compile_block(block->jump[0], type, regs);
         }
     } else {
         assert(block->jump[0]);
@@ -2881,45 +5084,41 @@ static void compile_block(struct block *block, Type type, int regs)
             default: assert(0);
             case INSTR_SETE:
                 if (is_real(block->expr.l.type)) {
-                    emit(INSTR_JNE, OPT_IMM, addr(block->jump[0]->label));
-                    emit(INSTR_JP, OPT_IMM, addr(block->jump[0]->label));
-                    emit(INSTR_JMP, OPT_IMM, addr(block->jump[1]->label));
+                    compile_unordered_branch(block, next, 1);
                 } else {
-                    emit(INSTR_JNE, OPT_IMM, addr(block->jump[0]->label));
+                    compile_branch(block, next, INSTR_JE, INSTR_JNE);
                 }
                 break;
             case INSTR_SETNE:
                 if (is_real(block->expr.l.type)) {
-                    emit(INSTR_JNE, OPT_IMM, addr(block->jump[1]->label));
-                    emit(INSTR_JP, OPT_IMM, addr(block->jump[1]->label));
-                    emit(INSTR_JMP, OPT_IMM, addr(block->jump[0]->label));
+                    compile_unordered_branch(block, next, 0);
                 } else {
-                    emit(INSTR_JE, OPT_IMM, addr(block->jump[0]->label));
+                    compile_branch(block, next, INSTR_JNE, INSTR_JE);
                 }
                 break;
             case INSTR_SETG:
-                emit(INSTR_JNG, OPT_IMM, addr(block->jump[0]->label));
+                compile_branch(block, next, INSTR_JG, INSTR_JNG);
                 break;
             case INSTR_SETNG:
-                emit(INSTR_JG, OPT_IMM, addr(block->jump[0]->label));
+                compile_branch(block, next, INSTR_JNG, INSTR_JG);
                 break;
             case INSTR_SETA:
-                emit(INSTR_JNA, OPT_IMM, addr(block->jump[0]->label));
+                compile_branch(block, next, INSTR_JA, INSTR_JNA);
                 break;
             case INSTR_SETNA:
-                emit(INSTR_JA, OPT_IMM, addr(block->jump[0]->label));
+                compile_branch(block, next, INSTR_JNA, INSTR_JA);
                 break;
             case INSTR_SETGE:
-                emit(INSTR_JNGE, OPT_IMM, addr(block->jump[0]->label));
+                compile_branch(block, next, INSTR_JGE, INSTR_JNGE);
                 break;
             case INSTR_SETNGE:
-                emit(INSTR_JGE, OPT_IMM, addr(block->jump[0]->label));
+                compile_branch(block, next, INSTR_JNGE, INSTR_JGE);
                 break;
             case INSTR_SETAE:
-                emit(INSTR_JNAE, OPT_IMM, addr(block->jump[0]->label));
+                compile_branch(block, next, INSTR_JAE, INSTR_JNAE);
                 break;
             case INSTR_SETNAE:
-                emit(INSTR_JAE, OPT_IMM, addr(block->jump[0]->label));
+                compile_branch(block, next, INSTR_JNAE, INSTR_JAE);
                 break;
             }
         } else {
@@ -2933,26 +5132,19 @@ static void compile_block(struct block *block, Type type, int regs)
                 } else {
                     emit(INSTR_UCOMISD, OPT_REG_REG, reg(xmm0, 8), reg(xmm1, 8));
                 }
-                emit(INSTR_JNE, OPT_IMM, addr(block->jump[1]->label));
-                emit(INSTR_JP, OPT_IMM, addr(block->jump[1]->label));
-                emit(INSTR_JMP, OPT_IMM, addr(block->jump[0]->label));
+                compile_unordered_branch(block, next, 0);
             } else {
                 i = size_of(block->expr.type);
                 assert(i == 1 || i == 2 || i == 4 || i == 8);
                 emit(INSTR_CMP, OPT_IMM_REG, constant(0, i), reg(ax, i));
-                emit(INSTR_JE, OPT_IMM, addr(block->jump[0]->label));
+                compile_branch(block, next, INSTR_JNE, INSTR_JE);
             }
         }
 
         relase_regs();
-        if (block->jump[1]->color == BLACK) {
-            emit(INSTR_JMP, OPT_IMM, addr(block->jump[1]->label));
-        } else {
-            compile_block(block->jump[1], type, regs);
-        }
-
-        compile_block(block->jump[0], type, regs);
     }
+
+    folded_pointer = NULL;
 }
 
 static void compile_data_assign(struct var target, struct var val)
@@ -3112,9 +5304,52 @@ static void compile_data(struct definition *def)
     zero_fill_data(total_size - initialized);
 }
 
+static void mark_reachable(struct block *block)
+{
+    int i;
+
+    if (block->color == BLACK)
+        return;
+
+    block->color = BLACK;
+    if (block->jump[0]) {
+        mark_reachable(block->jump[0]);
+        if (block->jump[1]) {
+            mark_reachable(block->jump[1]);
+        }
+    }
+
+    for (i = 0; i < array_len(&block->targets); ++i) {
+        mark_reachable(array_get(&block->targets, i));
+    }
+}
+
+/*
+ * Restoring callee saved registers takes more space than a jump, so
+ * return blocks share a single epilogue if there are more than one.
+ */
+static int is_epilogue_shared(struct definition *def, int regs)
+{
+    int i, n;
+    struct block *block;
+
+    if (!regs)
+        return 0;
+
+    for (i = 0, n = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        if (block->color == BLACK && !block->jump[0] && !block->indirect) {
+            n++;
+        }
+    }
+
+    return n > 1;
+}
+
 static void compile_function(struct definition *def)
 {
-    int regs;
+    int i, regs;
+    struct block *block, *next;
 
     assert(is_function(def->symbol->type));
     enter_context(def->symbol);
@@ -3123,9 +5358,46 @@ static void compile_function(struct definition *def)
 
     /* Make sure parameters and local variables are placed on stack. */
     regs = enter(def);
+    count_temporary_usage(def);
+    alias_analysis(def);
+
+    /*
+     * Assemble blocks reachable from function entry, in the order they
+     * are listed in the definition. Blocks with label address taken
+     * are always included.
+     */
+    mark_reachable(def->body);
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        if (block->label->referenced) {
+            mark_reachable(block);
+        }
+    }
 
-    /* Recursively assemble body. */
-    compile_block(def->body, def->symbol->type, regs);
+    if (context.align_loops > 1) {
+        find_back_edge_targets(def);
+    }
+
+    epilogue = is_epilogue_shared(def, regs) ? create_label(def) : NULL;
+    for (i = 0, block = NULL; i < array_len(&def->nodes); ++i) {
+        next = array_get(&def->nodes, i);
+        if (next->color == BLACK) {
+            if (block) {
+                compile_block(block, next, def->symbol->type, regs);
+            } else if (next != def->body) {
+                emit(INSTR_JMP, OPT_IMM, addr(def->body->label));
+            }
+            block = next;
+        }
+    }
+
+    assert(block);
+    compile_block(block, NULL, def->symbol->type, regs);
+    if (epilogue) {
+        enter_label(epilogue);
+        compile_epilogue(regs);
+        epilogue = NULL;
+    }
 }
 
 INTERNAL void set_compile_target(FILE *stream, const char *file)
@@ -3141,6 +5413,7 @@ INTERNAL void set_compile_target(FILE *stream, const char *file)
         enter_context = asm_symbol;
         emit_instruction = asm_text;
         emit_data = asm_data;
+        emit_alignment = asm_align;
         flush_backend = asm_flush;
         break;
     case TARGET_x86_64_ELF:
@@ -3148,6 +5421,7 @@ INTERNAL void set_compile_target(FILE *stream, const char *file)
         enter_context = elf_symbol;
         emit_instruction = elf_text;
         emit_data = elf_data;
+        emit_alignment = elf_align;
         flush_backend = elf_flush;
         break;
     }
@@ -3196,6 +5470,14 @@ INTERNAL int declare(const struct symbol *sym)
 INTERNAL void flush(void)
 {
     array_clear(&func_args);
+    array_clear(&modes);
+    array_clear(&temp_usage);
+    array_clear(&live_ranges);
+    array_clear(&active_ranges);
+    array_clear(&free_slots);
+    array_clear(&block_positions);
+    array_clear(&loops);
+    array_clear(&back_edge_targets);
     if (flush_backend) {
         flush_backend();
     }
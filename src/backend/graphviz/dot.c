@@ -167,6 +167,21 @@ static void dot_print_expr(struct expression expr)
     case IR_OP_NEG:
         fprintf(stream, "-%s", vartostr(expr.l));
         break;
+    case IR_OP_POPCNT:
+        fprintf(stream, "popcount(%s)", vartostr(expr.l));
+        break;
+    case IR_OP_CLZ:
+        fprintf(stream, "clz(%s)", vartostr(expr.l));
+        break;
+    case IR_OP_CTZ:
+        fprintf(stream, "ctz(%s)", vartostr(expr.l));
+        break;
+    case IR_OP_FFS:
+        fprintf(stream, "ffs(%s)", vartostr(expr.l));
+        break;
+    case IR_OP_BSWAP:
+        fprintf(stream, "bswap(%s)", vartostr(expr.l));
+        break;
     case IR_OP_ADD:
         fprintf(stream, "%s + %s", vartostr(expr.l), vartostr(expr.r));
         break;
@@ -212,10 +227,11 @@ static void dot_print_expr(struct expression expr)
     }
 }
 
-static void dot_print_node(struct block *node)
+static void dot_print_node(const struct definition *def, struct block *node)
 {
     int i;
     struct statement s;
+    struct block *next;
 
     if (node->color == BLACK)
         return;
@@ -240,10 +256,21 @@ static void dot_print_node(struct block *node)
             dot_print_expr(s.expr);
             fputs(")", stream);
             break;
+        case IR_PREFETCH:
+            fprintf(stream, " | prefetch %s, (", vartostr(s.t));
+            dot_print_expr(s.expr);
+            fputs(")", stream);
+            break;
         case IR_EXPR:
             fputs(" | ", stream);
             dot_print_expr(s.expr);
             break;
+        case IR_CMOV:
+            fputs(" | if ", stream);
+            dot_print_expr(s.expr);
+            fprintf(stream, " %s = %s", vartostr(s.t),
+                vartostr(array_get(&def->sources, s.source)));
+            break;
         case IR_VLA_ALLOC:
             fprintf(stream, " | vla_alloc %s:%s (",
                 vartostr(s.t),
@@ -254,7 +281,17 @@ static void dot_print_node(struct block *node)
         }
     }
 
-    if (!node->jump[0] && !node->jump[1]) {
+    if (node->indirect) {
+        fputs(" | goto *", stream);
+        dot_print_expr(node->expr);
+        fprintf(stream, " }\"];\n");
+        for (i = 0; i < array_len(&node->targets); ++i) {
+            next = array_get(&node->targets, i);
+            dot_print_node(def, next);
+            fprintf(stream, "\t%s:s -> %s:n;\n",
+                sanitize(node->label), sanitize(next->label));
+        }
+    } else if (!node->jump[0] && !node->jump[1]) {
         if (node->has_return_value) {
             fputs(" | return ", stream);
             dot_print_expr(node->expr);
@@ -266,8 +303,8 @@ static void dot_print_node(struct block *node)
         dot_print_expr(node->expr);
         fprintf(stream, " goto %s", escape(node->jump[1]->label));
         fprintf(stream, " }\"];\n");
-        dot_print_node(node->jump[0]);
-        dot_print_node(node->jump[1]);
+        dot_print_node(def, node->jump[0]);
+        dot_print_node(def, node->jump[1]);
         fprintf(stream, "\t%s:s -> %s:n;\n",
             sanitize(node->label), sanitize(node->jump[0]->label));
         fprintf(stream, "\t%s:s -> %s:n;\n",
@@ -276,7 +313,7 @@ static void dot_print_node(struct block *node)
         assert(node->jump[0]);
         assert(!node->jump[1]);
         fprintf(stream, " }\"];\n");
-        dot_print_node(node->jump[0]);
+        dot_print_node(def, node->jump[0]);
         fprintf(stream, "\t%s:s -> %s:n;\n",
             sanitize(node->label), sanitize(node->jump[0]->label));
     }
@@ -302,6 +339,6 @@ INTERNAL void dotgen(struct definition *def)
         fprintf(stream, "\tlabelloc=\"t\"\n");
     }
 
-    dot_print_node(def->body);
+    dot_print_node(def, def->body);
     fprintf(stream, "}\n");
 }
@@ -4,6 +4,7 @@
 #endif
 #include "abi.h"
 #include "assemble.h"
+#include <lacc/context.h>
 
 #include <assert.h>
 #include <ctype.h>
@@ -165,6 +166,31 @@ INTERNAL void asm_init(FILE *output, const char *file)
     }
 }
 
+/*
+ * Emit visibility directive for external symbol, not needed in case of
+ * default visibility.
+ */
+static void asm_visibility(const struct symbol *sym)
+{
+    if (sym->linkage != LINK_EXTERN)
+        return;
+
+    switch (sym_visibility(sym)) {
+    default: assert(0);
+    case VISIBILITY_DEFAULT:
+        break;
+    case VISIBILITY_HIDDEN:
+        I1(".hidden", sym_name(sym));
+        break;
+    case VISIBILITY_INTERNAL:
+        I1(".internal", sym_name(sym));
+        break;
+    case VISIBILITY_PROTECTED:
+        I1(".protected", sym_name(sym));
+        break;
+    }
+}
+
 INTERNAL int asm_symbol(const struct symbol *sym)
 {
     /*
@@ -179,22 +205,47 @@ INTERNAL int asm_symbol(const struct symbol *sym)
     switch (sym->symtype) {
     case SYM_TENTATIVE:
         assert(is_object(sym->type));
+        if (sym->linkage == LINK_INTERN && context.data_sections) {
+            out("\t.section\t.bss.%s,\"aw\",@nobits\n", sym_name(sym));
+            out("\t.align\t%d\n", sym_alignment(sym));
+            out("\t.type\t%s, @object\n", sym_name(sym));
+            out("\t.size\t%s, %d\n", sym_name(sym), size_of(sym->type));
+            out("%s:\n", sym_name(sym));
+            out("\t.zero\t%d\n", size_of(sym->type));
+            break;
+        }
         if (sym->linkage == LINK_INTERN)
             out("\t.local %s\n", sym_name(sym));
+        asm_visibility(sym);
         out("\t.comm %s,%d,%d\n",
             sym_name(sym), size_of(sym->type), type_alignment(sym->type));
         break;
     case SYM_DEFINITION:
         if (is_function(sym->type)) {
-            I0(".text");
+            if (context.function_sections) {
+                out("\t.section\t%s.%s,\"ax\",@progbits\n",
+                    sym_text_section(sym), sym_name(sym));
+            } else if (sym->hot || sym->cold) {
+                out("\t.section\t%s,\"ax\",@progbits\n",
+                    sym_text_section(sym));
+            } else {
+                I0(".text");
+            }
+            asm_align(context.align_functions);
             if (sym->linkage == LINK_EXTERN)
                 I1(".globl", sym_name(sym));
+            asm_visibility(sym);
             I2(".type", sym_name(sym), "@function");
             out("%s:\n", sym_name(sym));
         } else {
-            I0(".data");
+            if (context.data_sections) {
+                out("\t.section\t.data.%s,\"aw\"\n", sym_name(sym));
+            } else {
+                I0(".data");
+            }
             if (sym->linkage == LINK_EXTERN)
                 I1(".globl", sym_name(sym));
+            asm_visibility(sym);
             out("\t.align\t%d\n", sym_alignment(sym));
             out("\t.type\t%s, @object\n", sym_name(sym));
             out("\t.size\t%s, %d\n", sym_name(sym), size_of(sym->type));
@@ -233,6 +284,9 @@ INTERNAL int asm_symbol(const struct symbol *sym)
     case SYM_LABEL:
         out("%s:\n", sym_name(sym));
         break;
+    case SYM_DECLARATION:
+        asm_visibility(sym);
+        break;
     default:
         break;
     }
@@ -240,6 +294,24 @@ INTERNAL int asm_symbol(const struct symbol *sym)
     return 0;
 }
 
+/*
+ * Let the assembler fill padding with multi-byte no-op instructions
+ * appropriate for the target.
+ */
+INTERNAL int asm_align(int align)
+{
+    int n;
+
+    assert(align > 0 && !(align & (align - 1)));
+    if (align > 1) {
+        for (n = 0; (1 << n) < align; ++n)
+            ;
+        out("\t.p2align %d\n", n);
+    }
+
+    return 0;
+}
+
 INTERNAL int asm_text(struct instruction instr)
 {
     int ws = 0,
@@ -305,6 +377,7 @@ INTERNAL int asm_text(struct instruction instr)
     case INSTR_SUBSS:    I2("subss", source, destin); break;
     case INSTR_NOT:      U1("not", ws, source); break;
     case INSTR_MUL:      U1("mul", ws, source); break;
+    case INSTR_IMUL:     U1("imul", ws, source); break;
     case INSTR_XOR:      U2("xor", wd, source, destin); break;
     case INSTR_AND:      U2("and", wd, source, destin); break;
     case INSTR_OR:       U2("or", wd, source, destin); break;
@@ -327,6 +400,7 @@ INTERNAL int asm_text(struct instruction instr)
     case INSTR_MOVAPS:
         I2("movaps", source, destin);
         break;
+    case INSTR_MOVUPS:   I2("movups", source, destin); break;
     case INSTR_MOVSS:    I2("movss", source, destin); break;
     case INSTR_MOVSD:    I2("movsd", source, destin); break;
     case INSTR_MULSD:    I2("mulsd", source, destin); break;
@@ -346,12 +420,38 @@ INTERNAL int asm_text(struct instruction instr)
     case INSTR_TEST:     U2("test", wd, source, destin); break;
     case INSTR_UCOMISS:  I2("ucomiss", source, destin); break;
     case INSTR_UCOMISD:  I2("ucomisd", source, destin); break;
+    case INSTR_CMOVE:    I2("cmove", source, destin); break;
+    case INSTR_CMOVNE:   I2("cmovne", source, destin); break;
+    case INSTR_CMOVA:    I2("cmova", source, destin); break;
+    case INSTR_CMOVNA:   I2("cmovna", source, destin); break;
+    case INSTR_CMOVAE:   I2("cmovae", source, destin); break;
+    case INSTR_CMOVNAE:  I2("cmovnae", source, destin); break;
+    case INSTR_CMOVG:    I2("cmovg", source, destin); break;
+    case INSTR_CMOVNG:   I2("cmovng", source, destin); break;
+    case INSTR_CMOVGE:   I2("cmovge", source, destin); break;
+    case INSTR_CMOVNGE:  I2("cmovnge", source, destin); break;
     case INSTR_CMP:      U2("cmp", wd, source, destin); break;
     case INSTR_LEA:      U2("lea", wd, source, destin); break;
     case INSTR_PUSH:     U1("push", ws, source); break;
     case INSTR_POP:      U1("pop", ws, source); break;
     case INSTR_PXOR:     I2("pxor", source, destin); break;
-    case INSTR_JMP:      I1("jmp", source); break;
+    case INSTR_POPCNT:   I2("popcnt", source, destin); break;
+    case INSTR_LZCNT:    I2("lzcnt", source, destin); break;
+    case INSTR_TZCNT:    I2("tzcnt", source, destin); break;
+    case INSTR_BSR:      I2("bsr", source, destin); break;
+    case INSTR_BSF:      I2("bsf", source, destin); break;
+    case INSTR_BSWAP:    I1("bswap", source); break;
+    case INSTR_PREFETCHT0: I1("prefetcht0", source); break;
+    case INSTR_PREFETCHT1: I1("prefetcht1", source); break;
+    case INSTR_PREFETCHT2: I1("prefetcht2", source); break;
+    case INSTR_PREFETCHNTA:I1("prefetchnta", source); break;
+    case INSTR_PREFETCHW:  I1("prefetchw", source); break;
+    case INSTR_JMP:
+        if (instr.optype == OPT_REG)
+            out("\tjmp\t*%s\n", source);
+        else
+            I1("jmp", source);
+        break;
     case INSTR_JE:       I1("je", source); break;
     case INSTR_JA:       I1("ja", source); break;
     case INSTR_JNA:      I1("jna", source); break;
@@ -366,7 +466,7 @@ INTERNAL int asm_text(struct instruction instr)
     case INSTR_JNE:      I1("jne", source); break;
     case INSTR_JNS:      I1("jns", source); break;
     case INSTR_CALL:
-        if (instr.optype == OPT_REG)
+        if (instr.optype == OPT_REG || instr.optype == OPT_MEM)
             out("\tcall\t*%s\n", source);
         else
             I1("call", source);
@@ -19,6 +19,9 @@ INTERNAL int asm_symbol(const struct symbol *sym);
 /* Add instruction to function context. */
 INTERNAL int asm_text(struct instruction instr);
 
+/* Align next instruction to power of two number of bytes. */
+INTERNAL int asm_align(int align);
+
 /* Add data to internal symbol context. */
 INTERNAL int asm_data(struct immediate data);
 
@@ -8,8 +8,10 @@
 #include <lacc/context.h>
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
-#define SHNUM 10        /* Number of section headers. */
+#define SHNUM 10        /* Number of fixed section headers. */
 
 #define SHID_ZERO 0
 #define SHID_SHSTRTAB 1
@@ -22,9 +24,6 @@
 #define SHID_RODATA 8
 #define SHID_TEXT 9
 
-#define SHDR_CHAIN_OFFSET(a, b) \
-    shdr[b].sh_offset = shdr[a].sh_offset + shdr[a].sh_size
-
 #define symtab_index_of(s) ((s)->stack_offset)
 #define symtab_lookup(s) (&sbuf[SHID_SYMTAB].sym[(s)->stack_offset])
 
@@ -52,11 +51,11 @@ static Elf64_Ehdr header = {
     0x0,                /* Program header size. */
     0,                  /* Number of program header entries. */
     sizeof(Elf64_Shdr), /* e_shentsize. */
-    SHNUM,              /* e_shnum, number of section headers. */
+    0,                  /* e_shnum, number of section headers (TODO). */
     SHID_SHSTRTAB       /* e_shstrndx, index of shstrtab. */
 };
 
-static char *shname[] = {
+static const char *default_shname[] = {
     NULL,
     ".shstrtab",
     ".strtab",
@@ -69,14 +68,14 @@ static char *shname[] = {
     ".text"
 };
 
-static Elf64_Shdr shdr[] = {
+static const Elf64_Shdr default_shdr[] = {
     {0},                /* First section header must be all-zero. */
     { /* .shstrtab */
         0,              /* sh_name, index into shstrtab. */
         SHT_STRTAB,     /* sh_type. */
         0,              /* sh_flags. */
         0x0,            /* sh_addr. */
-        sizeof(Elf64_Ehdr) + SHNUM * sizeof(Elf64_Shdr),
+        0,              /* sh_offset (TODO). */
         0,              /* sh_size (TODO). */
         SHN_UNDEF,      /* sh_link. */
         0,              /* sh_info. */
@@ -104,7 +103,7 @@ static Elf64_Shdr shdr[] = {
         0,              /* sh_size (TODO). */
         SHID_STRTAB,    /* sh_link, section number of strtab. */
         0,              /* sh_info, index of first non-local symbol. */
-        4,              /* sh_addralign. */
+        8,              /* sh_addralign. */
         sizeof(Elf64_Sym)
     },
     { /* .rela.text */
@@ -181,19 +180,49 @@ static Elf64_Shdr shdr[] = {
     }
 };
 
+/*
+ * Section headers, indexed by section id. The fixed sections are copied
+ * from default values, and more are added for -ffunction-sections and
+ * -fdata-sections.
+ */
+static Elf64_Shdr *shdr;
+
 /* Data associated with each section. */
 static union {
     unsigned char *data;
     Elf64_Sym *sym;
     Elf64_Rela *rela;
-} sbuf[SHNUM];
+} *sbuf;
+
+/*
+ * Name of each section, capacity of data buffer in bytes, id of the
+ * section holding relocations for it, and index of the section symbol
+ * in .symtab, if any.
+ */
+static struct section {
+    char *name;
+    size_t cap;
+    int rela;
+    int sym;
+} *sinfo;
+
+static int shnum;
+
+/* Sections currently written to by elf_text and elf_data. */
+static int text_section = SHID_TEXT;
+static int data_section = SHID_DATA;
+
+/* Sections for hot and cold functions, created on first use. */
+static int text_hot_section, text_unlikely_section;
 
 /*
  * Pending relocations, waiting for sym->stack_offset to be resolved to
- * index into .symtab.
+ * index into .symtab. Relocations against a section have no symbol,
+ * and the index is known up front.
  */
 struct pending_relocation {
     const struct symbol *symbol;
+    int index;
     enum rel_type type;
     int section;                /* section id of .rela.X */
     int offset;                 /* offset into .text */
@@ -202,10 +231,6 @@ struct pending_relocation {
 
 static array_of(struct pending_relocation) pending_relocation_list;
 
-static int
-    n_rela_data,
-    n_rela_text;
-
 /*
  * Keep track of function being assembled, updating st_size after each
  * instruction.
@@ -237,17 +262,108 @@ struct pending_displacement {
 
 static array_of(struct pending_displacement) pending_displacement_list;
 
+/*
+ * Add section with header copied from one of the fixed sections,
+ * returning the new section id. Name is freed on flush.
+ */
+static int elf_section_add(char *name, int from)
+{
+    int shid;
+
+    assert(0 < from && from < SHNUM);
+    shid = shnum++;
+    shdr = realloc(shdr, shnum * sizeof(*shdr));
+    sbuf = realloc(sbuf, shnum * sizeof(*sbuf));
+    sinfo = realloc(sinfo, shnum * sizeof(*sinfo));
+    shdr[shid] = default_shdr[from];
+    sbuf[shid].data = NULL;
+    sinfo[shid].name = name;
+    sinfo[shid].cap = 0;
+    sinfo[shid].rela = 0;
+    sinfo[shid].sym = 0;
+    return shid;
+}
+
+/*
+ * Add section for a single function or object, named by appending the
+ * symbol name to the given section name.
+ */
+static int elf_section_add_symbol(
+    int from,
+    const char *prefix,
+    const struct symbol *sym)
+{
+    char *name;
+    const char *str;
+
+    str = sym_name(sym);
+    name = malloc(strlen(prefix) + strlen(str) + 2);
+    sprintf(name, "%s.%s", prefix, str);
+    return elf_section_add(name, from);
+}
+
+/*
+ * Get text section for function definition, which is either .text, a
+ * shared section for hot or cold functions, or a separate section for
+ * each function.
+ */
+static int elf_section_text(const struct symbol *sym)
+{
+    int *shid;
+    char *name;
+    const char *prefix;
+
+    prefix = sym_text_section(sym);
+    if (context.function_sections) {
+        return elf_section_add_symbol(SHID_TEXT, prefix, sym);
+    }
+
+    if (sym->cold) {
+        shid = &text_unlikely_section;
+    } else if (sym->hot) {
+        shid = &text_hot_section;
+    } else {
+        return SHID_TEXT;
+    }
+
+    if (!*shid) {
+        name = malloc(strlen(prefix) + 1);
+        strcpy(name, prefix);
+        *shid = elf_section_add(name, SHID_TEXT);
+    }
+
+    return *shid;
+}
+
+/*
+ * Get section holding relocations for text or data section, creating
+ * it on first use.
+ */
+static int elf_section_rela(int shid)
+{
+    int rela;
+    char *name;
+
+    if (!sinfo[shid].rela) {
+        assert(shid >= SHNUM);
+        name = malloc(strlen(sinfo[shid].name) + 6);
+        sprintf(name, ".rela%s", sinfo[shid].name);
+        rela = elf_section_add(name,
+            shdr[shid].sh_flags & SHF_EXECINSTR
+                ? SHID_RELA_TEXT
+                : SHID_RELA_DATA);
+        shdr[rela].sh_info = shid;
+        sinfo[shid].rela = rela;
+    }
+
+    return sinfo[shid].rela;
+}
+
 /* Write bytes to section. If ptr is NULL, fill with zeros. */
 static int elf_section_write(int shid, const void *data, size_t n)
 {
-    /*
-     * Section data buffer capacity, in bytes. Buffer is kept in sbuf,
-     * indexed by section id. 
-     */
-    static size_t scap[SHNUM];
-
     size_t offset;
-    assert(0 < shid && shid < SHNUM);
+    assert(0 < shid && shid < shnum);
     assert(
         shdr[shid].sh_type == SHT_STRTAB ||
         shdr[shid].sh_type == SHT_SYMTAB ||
@@ -256,18 +372,18 @@ static int elf_section_write(int shid, const void *data, size_t n)
 
     offset = shdr[shid].sh_size;
     if (shdr[shid].sh_type != SHT_NOBITS) {
-        if (offset + n >= scap[shid]) {
+        if (offset + n >= sinfo[shid].cap) {
             assert(n > 0);
-            if (!scap[shid]) {
+            if (!sinfo[shid].cap) {
                 assert(!offset);
                 assert(!sbuf[shid].data);
-                scap[shid] = 10 * n;
-                sbuf[shid].data = malloc(scap[shid]);
+                sinfo[shid].cap = 10 * n;
+                sbuf[shid].data = malloc(sinfo[shid].cap);
             } else {
                 assert(offset);
                 assert(sbuf[shid].data);
-                scap[shid] = 2 * scap[shid] + n;
-                sbuf[shid].data = realloc(sbuf[shid].data, scap[shid]);
+                sinfo[shid].cap = 2 * sinfo[shid].cap + n;
+                sbuf[shid].data = realloc(sbuf[shid].data, sinfo[shid].cap);
             }
         }
         if (data) {
@@ -289,12 +405,16 @@ static int elf_section_write(int shid, const void *data, size_t n)
 static int elf_section_align(int shid, int align)
 {
     size_t offset;
-    assert(0 < shid && shid < SHNUM);
+    assert(0 < shid && shid < shnum);
     assert(
         shdr[shid].sh_type == SHT_STRTAB ||
         shdr[shid].sh_type == SHT_PROGBITS ||
         shdr[shid].sh_type == SHT_NOBITS);
 
+    if (shdr[shid].sh_addralign < align) {
+        shdr[shid].sh_addralign = align;
+    }
+
     offset = shdr[shid].sh_size;
     if (offset % align != 0)
         elf_section_write(shid, NULL, align - (offset % align));
@@ -309,7 +429,7 @@ static int elf_strtab_add(int shid, const char *str)
 {
     int pos;
 
-    assert(0 < shid && shid < SHNUM);
+    assert(0 < shid && shid < shnum);
     assert(shdr[shid].sh_type == SHT_STRTAB);
 
     if (!shdr[shid].sh_size)
@@ -375,6 +495,21 @@ static void elf_symtab_assoc(struct symbol *sym, Elf64_Sym entry)
     }
 }
 
+static unsigned char elf_visibility(const struct symbol *sym)
+{
+    switch (sym_visibility(sym)) {
+    default: assert(0);
+    case VISIBILITY_DEFAULT:
+        return STV_DEFAULT;
+    case VISIBILITY_HIDDEN:
+        return STV_HIDDEN;
+    case VISIBILITY_INTERNAL:
+        return STV_INTERNAL;
+    case VISIBILITY_PROTECTED:
+        return STV_PROTECTED;
+    }
+}
+
 /*
  * Write global symtab entries to section data.
  *
@@ -389,6 +524,7 @@ static void flush_symtab_globals(void)
 
     for (i = 0; i < array_len(&globals); ++i) {
         var = array_get(&globals, i);
+        var.entry.st_other = elf_visibility(var.sym);
         var.sym->stack_offset = elf_symtab_add(var.entry);
     }
 
@@ -402,17 +538,6 @@ static void flush_symtab_globals(void)
     array_clear(&globals);
 }
 
-static void elf_add_reloc(struct pending_relocation entry)
-{
-    array_push_back(&pending_relocation_list, entry);
-    if (entry.section == SHID_RELA_TEXT) {
-        n_rela_text++;
-    } else {
-        assert(entry.section == SHID_RELA_DATA);
-        n_rela_data++;
-    }
-}
-
 INTERNAL void elf_add_reloc_text(
     const struct symbol *symbol,
     enum rel_type type,
@@ -422,10 +547,10 @@ INTERNAL void elf_add_reloc_text(
     struct pending_relocation r = {0};
     r.symbol = symbol;
     r.type = type;
-    r.section = SHID_RELA_TEXT;
-    r.offset = shdr[SHID_TEXT].sh_size + offset;
+    r.section = elf_section_rela(text_section);
+    r.offset = shdr[text_section].sh_size + offset;
     r.addend = addend;
-    elf_add_reloc(r);
+    array_push_back(&pending_relocation_list, r);
 }
 
 static void elf_add_reloc_data(
@@ -436,10 +561,48 @@ static void elf_add_reloc_data(
     struct pending_relocation r = {0};
     r.symbol = symbol;
     r.type = type;
-    r.section = SHID_RELA_DATA;
-    r.offset = shdr[SHID_DATA].sh_size;
+    r.section = elf_section_rela(data_section);
+    r.offset = shdr[data_section].sh_size;
     r.addend = addend;
-    elf_add_reloc(r);
+    array_push_back(&pending_relocation_list, r);
+}
+
+/*
+ * Index of local symbol representing the start of a section, added to
+ * .symtab on first use.
+ */
+static int elf_section_symbol(int shid)
+{
+    Elf64_Sym entry = {0};
+
+    if (!sinfo[shid].sym) {
+        entry.st_info = (STB_LOCAL << 4) | STT_SECTION;
+        entry.st_shndx = shid;
+        sinfo[shid].sym = elf_symtab_add(entry);
+    }
+
+    return sinfo[shid].sym;
+}
+
+/*
+ * Labels are not in the symbol table, and are only resolved within the
+ * function. Reference from data, like a table of addresses used with
+ * computed goto, is relocated relative to the text section instead.
+ * Static data is compiled right after the function it belongs to, so
+ * label offsets are known, and still in the current text section.
+ */
+static void elf_add_reloc_data_label(const struct symbol *label, int addend)
+{
+    struct pending_relocation r = {0};
+    assert(label->symtype == SYM_LABEL);
+    assert(label->stack_offset);
+
+    r.index = elf_section_symbol(text_section);
+    r.type = R_X86_64_64;
+    r.section = elf_section_rela(data_section);
+    r.offset = shdr[data_section].sh_size;
+    r.addend = label->stack_offset + addend;
+    array_push_back(&pending_relocation_list, r);
 }
 
 /*
@@ -450,42 +613,35 @@ static void elf_add_reloc_data(
  */
 static void flush_relocations(void)
 {
-    Elf64_Rela
-        *entry,
-        *data_entry = NULL,
-        *text_entry = NULL;
+    int i, shid, index;
+    Elf64_Rela *entry;
     struct pending_relocation pending;
-    int i;
 
-    if (n_rela_text) {
-        sbuf[SHID_RELA_TEXT].rela = calloc(n_rela_text, sizeof(Elf64_Rela));
-        shdr[SHID_RELA_TEXT].sh_size = n_rela_text * sizeof(Elf64_Rela);
-        text_entry = sbuf[SHID_RELA_TEXT].rela;
+    for (i = 0; i < array_len(&pending_relocation_list); ++i) {
+        pending = array_get(&pending_relocation_list, i);
+        assert(shdr[pending.section].sh_type == SHT_RELA);
+        shdr[pending.section].sh_size += sizeof(Elf64_Rela);
     }
 
-    if (n_rela_data) {
-        sbuf[SHID_RELA_DATA].rela = calloc(n_rela_data, sizeof(Elf64_Rela));
-        shdr[SHID_RELA_DATA].sh_size = n_rela_data * sizeof(Elf64_Rela);
-        data_entry = sbuf[SHID_RELA_DATA].rela;
+    for (shid = 1; shid < shnum; ++shid) {
+        if (shdr[shid].sh_type == SHT_RELA && shdr[shid].sh_size) {
+            sbuf[shid].rela = calloc(1, shdr[shid].sh_size);
+            shdr[shid].sh_size = 0;
+        }
     }
 
-    assert(array_len(&pending_relocation_list) == n_rela_text + n_rela_data);
-    for (i = 0; i < n_rela_text + n_rela_data; ++i) {
+    for (i = 0; i < array_len(&pending_relocation_list); ++i) {
         pending = array_get(&pending_relocation_list, i);
         assert(pending.type != R_X86_64_NONE);
-        if (pending.section == SHID_RELA_DATA) {
-            assert(n_rela_data);
-            entry = data_entry++;
-        } else {
-            assert(n_rela_text);
-            assert(pending.section == SHID_RELA_TEXT);
-            entry = text_entry++;
-        }
-
+        shid = pending.section;
+        entry = &sbuf[shid].rela[shdr[shid].sh_size / sizeof(Elf64_Rela)];
+        shdr[shid].sh_size += sizeof(Elf64_Rela);
         entry->r_offset = pending.offset;
         entry->r_addend = pending.addend;
-        entry->r_info =
-            ELF64_R_INFO(symtab_index_of(pending.symbol), pending.type);
+        index = pending.symbol
+            ? symtab_index_of(pending.symbol)
+            : pending.index;
+        entry->r_info = ELF64_R_INFO(index, pending.type);
 
         /*
          * Subtract 4 to account for the size occupied by the relocation
@@ -495,6 +651,7 @@ static void flush_relocations(void)
         case R_X86_64_PC32:
         case R_X86_64_PLT32:
         case R_X86_64_GOTPCREL:
+        case R_X86_64_GOTPCRELX:
             entry->r_addend -= 4;
             break;
         default:
@@ -519,7 +676,7 @@ INTERNAL void elf_flush_text_displacements(void)
         entry = array_get(&pending_displacement_list, i);
         assert(entry.label->stack_offset);
 
-        ptr = (int *) (sbuf[SHID_TEXT].data + entry.text_offset);
+        ptr = (int *) (sbuf[text_section].data + entry.text_offset);
         *ptr += entry.label->stack_offset - entry.text_offset;
     }
 
@@ -532,11 +689,11 @@ INTERNAL int elf_text_displacement(const struct symbol *label, int instr_offset)
     assert(label->symtype == SYM_LABEL);
 
     if (label->stack_offset) {
-        return label->stack_offset - shdr[SHID_TEXT].sh_size - instr_offset;
+        return label->stack_offset - shdr[text_section].sh_size - instr_offset;
     }
 
     entry.label = label;
-    entry.text_offset = shdr[SHID_TEXT].sh_size + instr_offset;
+    entry.text_offset = shdr[text_section].sh_size + instr_offset;
     array_push_back(&pending_displacement_list, entry);
     return 0;
 }
@@ -555,9 +712,21 @@ INTERNAL void elf_init(FILE *output, const char *file)
         {0, (STB_LOCAL << 4) | STT_SECTION, 0, SHID_TEXT, 0, 0}
     };
 
+    int i;
     Elf64_Sym entry = {0};
 
     object_file_output = output;
+    shnum = SHNUM;
+    shdr = malloc(sizeof(default_shdr));
+    sbuf = calloc(SHNUM, sizeof(*sbuf));
+    sinfo = calloc(SHNUM, sizeof(*sinfo));
+    memcpy(shdr, default_shdr, sizeof(default_shdr));
+    for (i = 0; i < SHNUM; ++i) {
+        sinfo[i].name = (char *) default_shname[i];
+    }
+
+    sinfo[SHID_TEXT].rela = SHID_RELA_TEXT;
+    sinfo[SHID_DATA].rela = SHID_RELA_DATA;
     elf_symtab_add(entry);
     if (file) {
         entry.st_name = elf_strtab_add(SHID_STRTAB, file);
@@ -566,17 +735,56 @@ INTERNAL void elf_init(FILE *output, const char *file)
         elf_symtab_add(entry);
     }
 
+    i = shdr[SHID_SYMTAB].sh_size / sizeof(Elf64_Sym);
+    sinfo[SHID_DATA].sym = i;
+    sinfo[SHID_TEXT].sym = i + 1;
     elf_section_write(SHID_SYMTAB, &default_symbols, sizeof(default_symbols));
 }
 
+/*
+ * Write no-op instructions to .text until aligned to the given number
+ * of bytes. Use the multi-byte sequences recommended for x86_64, which
+ * decode as a single instruction each.
+ */
+static int elf_text_pad(int align)
+{
+    static const unsigned char nop[9][9] = {
+        {0x90},
+        {0x66, 0x90},
+        {0x0F, 0x1F, 0x00},
+        {0x0F, 0x1F, 0x40, 0x00},
+        {0x0F, 0x1F, 0x44, 0x00, 0x00},
+        {0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00},
+        {0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00},
+        {0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+        {0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00}
+    };
+
+    int n, w, padding;
+
+    assert(align > 0 && !(align & (align - 1)));
+    if (shdr[text_section].sh_addralign < align) {
+        shdr[text_section].sh_addralign = align;
+    }
+
+    padding = (align - shdr[text_section].sh_size % align) % align;
+    for (n = padding; n > 0; n -= w) {
+        w = (n > 9) ? 9 : n;
+        elf_section_write(text_section, nop[w - 1], w);
+    }
+
+    return padding;
+}
+
 INTERNAL int elf_symbol(const struct symbol *sym)
 {
+    int shid;
     Elf64_Sym entry = {0};
     assert(sym->linkage != LINK_NONE);
     assert(!sym->stack_offset);
 
     if (sym->symtype == SYM_LABEL) {
-        ((struct symbol *) sym)->stack_offset = shdr[SHID_TEXT].sh_size;
+        ((struct symbol *) sym)->stack_offset = shdr[text_section].sh_size;
         return 0;
     }
 
@@ -587,15 +795,20 @@ INTERNAL int elf_symbol(const struct symbol *sym)
     if (is_function(sym->type)) {
         entry.st_info |= STT_FUNC;
         if (sym->symtype == SYM_DEFINITION) {
-            entry.st_shndx = SHID_TEXT;
-            entry.st_value = shdr[SHID_TEXT].sh_size;
+            text_section = elf_section_text(sym);
+            elf_text_pad(context.align_functions);
+            entry.st_shndx = text_section;
+            entry.st_value = shdr[text_section].sh_size;
         }
         /* st_size is updated while assembling instructions. */
     } else if (sym->symtype == SYM_DEFINITION) {
-        elf_section_align(SHID_DATA, sym_alignment(sym));
-        entry.st_shndx = SHID_DATA;
+        data_section = context.data_sections
+            ? elf_section_add_symbol(SHID_DATA, default_shname[SHID_DATA], sym)
+            : SHID_DATA;
+        elf_section_align(data_section, sym_alignment(sym));
+        entry.st_shndx = data_section;
         entry.st_size = size_of(sym->type);
-        entry.st_value = shdr[SHID_DATA].sh_size;
+        entry.st_value = shdr[data_section].sh_size;
         entry.st_info |= STT_OBJECT;
     } else if (
         sym->symtype == SYM_STRING_VALUE ||
@@ -618,12 +831,15 @@ INTERNAL int elf_symbol(const struct symbol *sym)
             elf_section_write(SHID_RODATA, &sym->value.constant, entry.st_size);
         }
     } else if (sym->linkage == LINK_INTERN) {
-        elf_section_align(SHID_BSS, sym_alignment(sym));
-        entry.st_shndx = SHID_BSS;
+        shid = context.data_sections
+            ? elf_section_add_symbol(SHID_BSS, default_shname[SHID_BSS], sym)
+            : SHID_BSS;
+        elf_section_align(shid, sym_alignment(sym));
+        entry.st_shndx = shid;
         entry.st_size = size_of(sym->type);
-        entry.st_value = shdr[SHID_BSS].sh_size;
+        entry.st_value = shdr[shid].sh_size;
         entry.st_info |= STT_OBJECT;
-        shdr[SHID_BSS].sh_size += entry.st_size;
+        shdr[shid].sh_size += entry.st_size;
     } else if (sym->symtype == SYM_TENTATIVE) {
         assert(sym->linkage == LINK_EXTERN);
         entry.st_shndx = SHN_COMMON;
@@ -640,13 +856,20 @@ INTERNAL int elf_text(struct instruction instr)
     assert(current_function_entry);
 
     if (c.val[0] != 0x90) {
-        elf_section_write(SHID_TEXT, &c.val, c.len);
+        elf_section_write(text_section, &c.val, c.len);
         current_function_entry->st_size += c.len;
     }
 
     return 0;
 }
 
+INTERNAL int elf_align(int align)
+{
+    assert(current_function_entry);
+    current_function_entry->st_size += elf_text_pad(align);
+    return 0;
+}
+
 INTERNAL int elf_data(struct immediate imm)
 {
     const void *ptr = NULL;
@@ -666,7 +889,11 @@ INTERNAL int elf_data(struct immediate imm)
     case IMM_ADDR:
         assert(imm.d.addr.sym);
         assert(imm.w == 8);
-        elf_add_reloc_data(imm.d.addr.sym, R_X86_64_64, imm.d.addr.disp);
+        if (imm.d.addr.sym->symtype == SYM_LABEL) {
+            elf_add_reloc_data_label(imm.d.addr.sym, imm.d.addr.disp);
+        } else {
+            elf_add_reloc_data(imm.d.addr.sym, R_X86_64_64, imm.d.addr.disp);
+        }
         break;
     case IMM_STRING:
         assert(w == imm.d.string.len + 1 || w == imm.d.string.len);
@@ -674,16 +901,17 @@ INTERNAL int elf_data(struct immediate imm)
         break;
     }
 
-    return elf_section_write(SHID_DATA, ptr, w);
+    return elf_section_write(data_section, ptr, w);
 }
 
 INTERNAL int elf_flush(void)
 {
     int i;
+    size_t offset;
 
     assert(object_file_output);
-    for (i = 1; i < SHNUM; ++i) {
-        shdr[i].sh_name = elf_strtab_add(SHID_SHSTRTAB, shname[i]);
+    for (i = 1; i < shnum; ++i) {
+        shdr[i].sh_name = elf_strtab_add(SHID_SHSTRTAB, sinfo[i].name);
     }
 
     /* Write remaining data to section buffers. */
@@ -691,49 +919,55 @@ INTERNAL int elf_flush(void)
     flush_relocations();
     array_clear(&pending_displacement_list);
 
-    /* Add padding to force proper alignment. */
-    elf_section_align(SHID_SHSTRTAB, 0x10);
-    elf_section_align(SHID_STRTAB, 0x10);
-    elf_section_align(SHID_STRTAB, 0x10);
-    elf_section_align(SHID_DATA, 0x10);
-    elf_section_align(SHID_RODATA, 0x10);
-
-    /* Fill in missing offset and size values */
-    SHDR_CHAIN_OFFSET(SHID_SHSTRTAB, SHID_STRTAB);
-    SHDR_CHAIN_OFFSET(SHID_STRTAB, SHID_SYMTAB);
-    SHDR_CHAIN_OFFSET(SHID_SYMTAB, SHID_RELA_TEXT);
-    SHDR_CHAIN_OFFSET(SHID_RELA_TEXT, SHID_RELA_DATA);
-    SHDR_CHAIN_OFFSET(SHID_RELA_DATA, SHID_BSS);
-    SHDR_CHAIN_OFFSET(SHID_RELA_DATA, SHID_DATA);
-    SHDR_CHAIN_OFFSET(SHID_DATA, SHID_RODATA);
-    SHDR_CHAIN_OFFSET(SHID_RODATA, SHID_TEXT);
+    /*
+     * Fill in missing offset values, placing section data in order
+     * after the headers. Sections without data take up no space.
+     */
+    header.e_shnum = shnum;
+    offset = sizeof(header) + shnum * sizeof(*shdr);
+    for (i = 1; i < shnum; ++i) {
+        if (shdr[i].sh_addralign > 1) {
+            offset += (shdr[i].sh_addralign - offset % shdr[i].sh_addralign)
+                % shdr[i].sh_addralign;
+        }
+
+        shdr[i].sh_offset = offset;
+        if (shdr[i].sh_type != SHT_NOBITS) {
+            offset += shdr[i].sh_size;
+        }
+    }
 
     /* Write headers and section data. */
     fwrite(&header, sizeof(header), 1, object_file_output);
-    fwrite(&shdr, sizeof(shdr), 1, object_file_output);
-    for (i = 1; i < SHNUM; ++i) {
-        if (!shdr[i].sh_size)
+    fwrite(shdr, sizeof(*shdr), shnum, object_file_output);
+    offset = sizeof(header) + shnum * sizeof(*shdr);
+    for (i = 1; i < shnum; ++i) {
+        if (!shdr[i].sh_size || shdr[i].sh_type == SHT_NOBITS)
             continue;
 
-        switch (shdr[i].sh_type) {
-        case SHT_PROGBITS:
-        case SHT_STRTAB:
-            fwrite(sbuf[i].data, shdr[i].sh_size, 1, object_file_output);
-            free(sbuf[i].data);
-            break;
-        case SHT_SYMTAB:
-            fwrite(sbuf[i].sym, shdr[i].sh_size, 1, object_file_output);
-            free(sbuf[i].sym);
-            break;
-        case SHT_RELA:
-            fwrite(sbuf[i].rela, shdr[i].sh_size, 1, object_file_output);
-            free(sbuf[i].rela);
-            break;
-        default:
-            assert(shdr[i].sh_type == SHT_NOBITS);
-            break;
+        for (; offset < shdr[i].sh_offset; ++offset) {
+            fputc(0, object_file_output);
         }
+
+        fwrite(sbuf[i].data, shdr[i].sh_size, 1, object_file_output);
+        offset = shdr[i].sh_offset + shdr[i].sh_size;
+        free(sbuf[i].data);
+    }
+
+    for (i = SHNUM; i < shnum; ++i) {
+        free(sinfo[i].name);
     }
 
+    free(shdr);
+    free(sbuf);
+    free(sinfo);
+    shdr = NULL;
+    sbuf = NULL;
+    sinfo = NULL;
+    shnum = 0;
+    text_section = SHID_TEXT;
+    data_section = SHID_DATA;
+    text_hot_section = 0;
+    text_unlikely_section = 0;
     return 0;
 }
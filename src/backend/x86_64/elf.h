@@ -76,7 +76,7 @@ typedef struct {
 typedef struct {
     Elf64_Word      st_name;        /* Symbol name. */
     unsigned char   st_info;        /* Type and Binding attributes. */
-    unsigned char   st_other;       /* Reserved. */
+    unsigned char   st_other;       /* Visibility. */
     Elf64_Half      st_shndx;       /* Section table index. */
     Elf64_Addr      st_value;       /* Symbol value. */
     Elf64_Xword     st_size;        /* Size of object. */
@@ -91,6 +91,11 @@ typedef struct {
 #define STT_SECTION 3
 #define STT_FILE 4
 
+#define STV_DEFAULT 0
+#define STV_INTERNAL 1
+#define STV_HIDDEN 2
+#define STV_PROTECTED 3
+
 typedef struct {
     Elf64_Addr      r_offset;       /* Address of reference. */
     Elf64_Xword     r_info;         /* Symbol index and reloc type. */
@@ -115,7 +120,8 @@ enum rel_type {
     R_X86_64_64 = 1,                /* word64   S + A. */
     R_X86_64_PC32 = 2,              /* word32   S + A - P */
     R_X86_64_PLT32 = 4,             /* word32   L + A - P */
-    R_X86_64_GOTPCREL = 9           /* word32   G + GOT + A - P */
+    R_X86_64_GOTPCREL = 9,          /* word32   G + GOT + A - P */
+    R_X86_64_GOTPCRELX = 41         /* word32   G + GOT + A - P */
 };
 
 #define ELF64_R_INFO(s, t) ((((long) s) << 32) + (((long) t) & 0xFFFFFFFFL))
@@ -126,6 +132,9 @@ INTERNAL int elf_symbol(const struct symbol *sym);
 
 INTERNAL int elf_text(struct instruction instr);
 
+/* Pad text with no-op instructions to power of two alignment. */
+INTERNAL int elf_align(int align);
+
 INTERNAL int elf_data(struct immediate data);
 
 /* Write pending label offsets. Required after each function. */
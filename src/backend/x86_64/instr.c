@@ -23,7 +23,7 @@
     ((is_64_bit(arg) && (arg).r < XMM0) || is_64_bit_reg(arg.r) || \
         (arg.w == 1 && (arg.r == DI || arg.r == SI)))
 #define mrex(arg) \
-    (!arg.sym && ((is_64_bit_reg(arg.base) || is_64_bit_reg(arg.offset))))
+    (arg.sym ? 0 : is_64_bit_reg(arg.base) | is_64_bit_reg(arg.offset) << 1)
 
 #define PREFIX_SSE 0x0F
 #define PREFIX_OPERAND_SIZE 0x66
@@ -35,11 +35,13 @@
  * R: Extension of ModRM reg field (most significant bit)
  * X: Extension of SIB index field
  * B: Extension of ModRM r/m field, SIB base field, or Opcode reg field
+ *
+ * For memory operands, mrex evaluates to the X and B bits needed for
+ * base and index registers.
  */
 #define REX 0x40
 #define W(arg) (is_64_bit(arg) << 3)
 #define R(arg) (is_64_bit_reg((arg).r) << 2)
-#define X(arg) 0
 #define B(arg) is_64_bit_reg((arg).r)
 
 /*
@@ -112,6 +114,10 @@ enum tttn {
  *
  * Some instructions, such as lea, require explicit offset to be
  * included. Marked 'mod(A)' in the manual.
+ *
+ * Base register %rsp or %r12 can only be encoded with SIB byte, and
+ * %rbp or %r13 always need a displacement. Index is scaled by 1, 2, 4
+ * or 8, and cannot be %rsp.
  */
 static void encode_addr(
     struct code *c,
@@ -120,54 +126,67 @@ static void encode_addr(
     int addend,
     int require_offset)
 {
-    unsigned int mod;
+    int disp;
+    unsigned int mod, rm, scale;
     enum rel_type reloc;
-    assert(addr.mult == 1 || !addr.mult);
 
     if (addr.sym) {
+        assert(!addr.offset);
         c->val[c->len++] = ((reg & 0x7) << 3) | 0x5;
-        if (addr.type == ADDR_GLOBAL_OFFSET) {
-            reloc = R_X86_64_GOTPCREL;
+        if (addr.sym->symtype == SYM_LABEL) {
+            /* Label in the same section is resolved without relocation. */
+            disp = elf_text_displacement(addr.sym, c->len)
+                + addr.disp - addend - 4;
+            memcpy(&c->val[c->len], &disp, 4);
         } else {
-            assert(addr.type == ADDR_NORMAL);
-            reloc = R_X86_64_PC32;
+            if (addr.type == ADDR_GLOBAL_OFFSET) {
+                reloc = R_X86_64_GOTPCREL;
+            } else {
+                assert(addr.type == ADDR_NORMAL);
+                reloc = R_X86_64_PC32;
+            }
+            elf_add_reloc_text(addr.sym, reloc, c->len, addr.disp - addend);
+            memset(&c->val[c->len], 0, 4);
         }
-        elf_add_reloc_text(addr.sym, reloc, c->len, addr.disp - addend);
-        memset(&c->val[c->len], 0, 4);
         c->len += 4;
-    } else if (addr.base == SP) {
-        assert(in_byte_range(addr.disp));
-        assert(addr.offset == 0);
-        mod = (addr.disp == 0 || require_offset) ? 0x00 : 0x40;
-        c->val[c->len++] = mod | (reg << 3) | 0x04; /* ModR/M */
-        c->val[c->len++] = 0x24; /* SIB */
-        if (addr.disp != 0 || require_offset) {
-            c->val[c->len++] = addr.disp;
-        }
     } else {
+        assert(addr.base);
+        rm = (addr.base - 1) % 8;
+        if (!in_byte_range(addr.disp)) {
+            mod = 0x80;
+        } else if (addr.disp != 0 || require_offset || rm == 5) {
+            mod = 0x40;
+        } else {
+            mod = 0x00;
+        }
+
         /* ModR/M */
-        c->val[c->len++] =
-            ((reg & 0x7) << 3) | ((!addr.offset) ? ((addr.base - 1) % 8) : 4);
-        if (in_byte_range(addr.disp)) {
-            if (addr.disp != 0 || require_offset) {
-                c->val[c->len - 1] |= 0x40;
-            }
+        if (addr.offset || rm == 4) {
+            c->val[c->len++] = mod | ((reg & 0x7) << 3) | 0x4;
         } else {
-            c->val[c->len - 1] |= 0x80;
+            c->val[c->len++] = mod | ((reg & 0x7) << 3) | rm;
         }
 
         /* SIB */
         if (addr.offset) {
-            assert(!is_64_bit_reg(addr.base));
-            c->val[c->len++] = ((addr.offset - 1) << 3) | (addr.base - 1);
+            assert(addr.offset != SP);
+            switch (addr.mult) {
+            default: assert(0);
+            case 1: scale = 0; break;
+            case 2: scale = 1; break;
+            case 4: scale = 2; break;
+            case 8: scale = 3; break;
+            }
+            c->val[c->len++] =
+                (scale << 6) | (((addr.offset - 1) % 8) << 3) | rm;
+        } else if (rm == 4) {
+            c->val[c->len++] = 0x20 | rm;
         }
 
         /* Displacement */
-        if (in_byte_range(addr.disp)) {
-            if (addr.disp != 0 || require_offset) {
-                c->val[c->len++] = addr.disp;
-            }
-        } else {
+        if (mod == 0x40) {
+            c->val[c->len++] = addr.disp;
+        } else if (mod == 0x80) {
             memcpy(&c->val[c->len], &addr.disp, 4);
             c->len += 4;
         }
@@ -197,10 +216,13 @@ static struct code mov(
     switch (optype) {
     case OPT_IMM_REG:
         /* Alternative encoding (shorter). */
+        if (is_16_bit(b.reg)) {
+            c.val[c.len++] = PREFIX_OPERAND_SIZE;
+        }
         if (rrex(b.reg)) {
             c.val[c.len++] = REX | W(b.reg) | B(b.reg);
         }
-        c.val[c.len++] = 0xB8 | w(b.reg) << 3 | regi(b.reg);
+        c.val[c.len++] = 0xB0 | w(b.reg) << 3 | regi(b.reg);
         if (a.imm.w == 1) {
             assert(a.imm.type == IMM_INT);
             c.val[c.len++] = a.imm.d.byte;
@@ -235,6 +257,9 @@ static struct code mov(
         break;
     case OPT_REG_REG:
         assert(a.reg.w == b.reg.w);
+        if (is_16_bit(a.reg)) {
+            c.val[c.len++] = PREFIX_OPERAND_SIZE;
+        }
         if (rrex(a.reg) || rrex(b.reg)) {
             c.val[c.len++] = REX | W(a.reg) | R(a.reg) | B(b.reg);
         }
@@ -252,6 +277,9 @@ static struct code mov(
         encode_addr(&c, regi(a.reg), b.mem.addr, 0, 0);
         break;
     case OPT_MEM_REG:
+        if (is_16_bit(b.reg)) {
+            c.val[c.len++] = PREFIX_OPERAND_SIZE;
+        }
         if (rrex(b.reg) || mrex(a.mem.addr)) {
             c.val[c.len++] = REX | W(b.reg) | R(b.reg) | mrex(a.mem.addr);
         }
@@ -311,8 +339,7 @@ static struct code movsx(
         break;
     case OPT_MEM_REG:
         if (rrex(b.reg) || mrex(a.mem.addr)) {
-            c.val[c.len] = REX | W(b.reg) | R(b.reg);
-            c.val[c.len++] |= is_64_bit_reg(a.mem.addr.base);
+            c.val[c.len++] = REX | W(b.reg) | R(b.reg) | mrex(a.mem.addr);
         }
         if (is_32_bit(a.mem) && is_64_bit(b.reg)) {
             c.val[c.len++] = 0x63;
@@ -343,8 +370,7 @@ static struct code movzx(
         c.val[c.len++] = 0xC0 | regi(b.reg) << 3 | regi(a.reg);
     } else if (optype == OPT_MEM_REG) {
         if (mrex(a.mem.addr) || rrex(b.reg)) {
-            c.val[c.len] = REX | W(b.reg) | R(b.reg);
-            c.val[c.len++] |= is_64_bit_reg(a.mem.addr.base);
+            c.val[c.len++] = REX | W(b.reg) | R(b.reg) | mrex(a.mem.addr);
         }
         c.val[c.len++] = 0x0F;
         c.val[c.len++] = 0xB6 | w(a.mem);
@@ -381,7 +407,7 @@ static struct code encode_push(enum instr_optype optype, union operand op)
     case OPT_MEM:
         assert(op.mem.w == 8);
         if (mrex(op.mem.addr)) {
-            c.val[c.len++] = REX  | W(op.mem);
+            c.val[c.len++] = REX | mrex(op.mem.addr);
         }
         c.val[c.len++] = 0xFF;
         encode_addr(&c, 0x6, op.mem.addr, 0, 0);
@@ -427,7 +453,11 @@ static struct code encode_sub(
         } else assert(0);
         break;
     case OPT_REG_REG:
-        if (rrex(a.reg)) {
+        assert(a.reg.w == b.reg.w);
+        if (is_16_bit(a.reg)) {
+            c.val[c.len++] = PREFIX_OPERAND_SIZE;
+        }
+        if (rrex(a.reg) || rrex(b.reg)) {
             c.val[c.len++] = REX | W(a.reg) | R(a.reg) | B(b.reg);
         }
         c.val[c.len++] = 0x28 | w(a.reg);
@@ -449,7 +479,11 @@ static struct code encode_add(
     switch (optype) {
     default: assert(0);
     case OPT_REG_REG:
-        if (rrex(a.reg)) {
+        assert(a.reg.w == b.reg.w);
+        if (is_16_bit(a.reg)) {
+            c.val[c.len++] = PREFIX_OPERAND_SIZE;
+        }
+        if (rrex(a.reg) || rrex(b.reg)) {
             c.val[c.len++] = REX | W(a.reg) | R(a.reg) | B(b.reg);
         }
         c.val[c.len++] = 0x00 | w(a.reg);
@@ -457,9 +491,17 @@ static struct code encode_add(
         break;
     case OPT_IMM_REG:
         assert(a.imm.type == IMM_INT);
+        if (is_16_bit(b.reg))
+            c.val[c.len++] = PREFIX_OPERAND_SIZE;
         if (rrex(b.reg))
             c.val[c.len++] = REX | W(b.reg) | B(b.reg);
-        c.val[c.len++] = 0x80 | is_byte_imm(a.imm) << 1 | w(b.reg);
+        if (is_8_bit(b.reg)) {
+            c.val[c.len++] = 0x80;
+            c.val[c.len++] = 0xC0 | regi(b.reg);
+            c.val[c.len++] = a.imm.d.byte;
+            break;
+        }
+        c.val[c.len++] = 0x81 | is_byte_imm(a.imm) << 1;
         c.val[c.len++] = 0xC0 | regi(b.reg);
         if (is_byte_imm(a.imm)) {
             c.val[c.len++] = a.imm.d.byte;
@@ -472,10 +514,19 @@ static struct code encode_add(
     case OPT_IMM_MEM:
         assert(a.imm.type == IMM_INT);
         assert(!mrex(b.mem.addr));
+        if (is_16_bit(b.mem)) {
+            c.val[c.len++] = PREFIX_OPERAND_SIZE;
+        }
         if (b.mem.w > 4) {
             c.val[c.len++] = REX | W(b.mem);
         }
-        c.val[c.len++] = 0x80 | is_byte_imm(a.imm) << 1 | w(b.mem);
+        if (is_8_bit(b.mem)) {
+            c.val[c.len++] = 0x80;
+            encode_addr(&c, 0, b.mem.addr, 1, 0);
+            c.val[c.len++] = a.imm.d.byte;
+            break;
+        }
+        c.val[c.len++] = 0x81 | is_byte_imm(a.imm) << 1;
         if (is_byte_imm(a.imm)) {
             encode_addr(&c, 0, b.mem.addr, 1, 0);
             c.val[c.len++] = a.imm.d.byte;
@@ -526,6 +577,19 @@ static struct code encode_call(enum instr_optype optype, union operand op)
         }
         elf_add_reloc_text(op.imm.d.addr.sym, reloc, c.len, op.imm.d.addr.disp);
         c.len += 4;
+    } else if (optype == OPT_MEM) {
+        /*
+         * Indirect call through GOT entry. The relaxable relocation
+         * lets the linker turn this into a direct call if the symbol
+         * is defined in the same module.
+         */
+        assert(op.mem.addr.type == ADDR_GLOBAL_OFFSET);
+        assert(op.mem.addr.sym);
+        assert(!op.mem.addr.disp);
+        c.val[c.len++] = 0xFF;
+        c.val[c.len++] = 0x15;
+        elf_add_reloc_text(op.mem.addr.sym, R_X86_64_GOTPCRELX, c.len, 0);
+        c.len += 4;
     } else {
         assert(optype == OPT_REG);
         assert(is_64_bit_reg(op.reg.r));
@@ -546,18 +610,24 @@ static struct code cmp(
 
     switch (optype) {
     case OPT_IMM_REG:
-        if (rrex(b.reg)) {
-            c.val[c.len++] = REX | W(a.imm) | B(b.reg);
-        } else if (is_16_bit(b.reg)) {
-            c.val[c.len++] = PREFIX_OPERAND_SIZE;
-        } else if (is_8_bit(b.reg)) {
-            assert(b.reg.r == AX);
-            assert(is_byte_imm(a.imm));
+        if (is_8_bit(b.reg) && b.reg.r == AX) {
             c.val[c.len++] = 0x3C;
             c.val[c.len++] = a.imm.d.byte;
             break;
         }
-        c.val[c.len++] = 0x80 | w(b.reg) | (is_byte_imm(a.imm) << 1);
+        if (is_16_bit(b.reg)) {
+            c.val[c.len++] = PREFIX_OPERAND_SIZE;
+        }
+        if (rrex(b.reg)) {
+            c.val[c.len++] = REX | W(b.reg) | B(b.reg);
+        }
+        if (is_8_bit(b.reg)) {
+            c.val[c.len++] = 0x80;
+            c.val[c.len++] = 0xF8 | regi(b.reg);
+            c.val[c.len++] = a.imm.d.byte;
+            break;
+        }
+        c.val[c.len++] = 0x81 | (is_byte_imm(a.imm) << 1);
         c.val[c.len++] = 0xF8 | regi(b.reg);
         if (is_byte_imm(a.imm)) {
             /* Sign extend bit is set. */
@@ -577,12 +647,23 @@ static struct code cmp(
         c.val[c.len++] = 0xC0 | regi(a.reg) << 3 | regi(b.reg);
         break;
     case OPT_IMM_MEM:
-        assert(!mrex(b.mem.addr));
-        c.val[c.len++] = 0x80 | is_byte_imm(a.imm) << 1 | w(b.mem);
-        if (is_byte_imm(a.imm)) {
+        if (is_16_bit(b.mem)) {
+            c.val[c.len++] = PREFIX_OPERAND_SIZE;
+        }
+        if (is_64_bit(b.mem) || mrex(b.mem.addr)) {
+            c.val[c.len++] = REX | W(b.mem) | mrex(b.mem.addr);
+        }
+        if (is_8_bit(b.mem)) {
+            /* Opcode 0x82 is not valid in 64 bit mode. */
+            c.val[c.len++] = 0x80;
+            encode_addr(&c, 0x7, b.mem.addr, 1, 0);
+            c.val[c.len++] = a.imm.d.byte;
+        } else if (is_byte_imm(a.imm)) {
+            c.val[c.len++] = 0x83;
             encode_addr(&c, 0x7, b.mem.addr, 1, 0);
             c.val[c.len++] = a.imm.d.byte;
         } else {
+            c.val[c.len++] = 0x81;
             assert(is_32bit_imm(a.imm));
             encode_addr(&c, 0x7, b.mem.addr, 4, 0);
             memcpy(&c.val[c.len], &a.imm.d.dword, 4);
@@ -640,6 +721,17 @@ static struct code jmp(enum instr_optype optype, union operand op)
     struct code c = {{0xE9}, 1};
     const struct address *addr = &op.imm.d.addr;
 
+    if (optype == OPT_REG) {
+        assert(is_64_bit(op.reg));
+        c.len = 0;
+        if (B(op.reg)) {
+            c.val[c.len++] = REX | B(op.reg);
+        }
+        c.val[c.len++] = 0xFF;
+        c.val[c.len++] = 0xE0 | regi(op.reg);
+        return c;
+    }
+
     assert(optype == OPT_IMM);
     assert(addr->sym);
 
@@ -665,7 +757,7 @@ static struct code lea(
     assert(optype == OPT_MEM_REG);
     assert(is_64_bit(b.reg));
 
-    c.val[c.len++] = REX | W(b.reg) | R(b.reg);
+    c.val[c.len++] = REX | W(b.reg) | R(b.reg) | mrex(a.mem.addr);
     c.val[c.len++] = 0x8D;
     encode_addr(&c, regi(b.reg), a.mem.addr, 0, 1);
     return c;
@@ -701,6 +793,39 @@ static struct code setcc(
     return c;
 }
 
+static struct code cmovcc(
+    enum instr_optype optype,
+    enum tttn cond,
+    union operand a,
+    union operand b)
+{
+    struct code c = {{0}};
+    assert(b.reg.w == 4 || b.reg.w == 8);
+
+    switch (optype) {
+    default: assert(0);
+    case OPT_REG_REG:
+        assert(a.reg.w == b.reg.w);
+        if (rrex(a.reg) || rrex(b.reg)) {
+            c.val[c.len++] = REX | W(b.reg) | R(b.reg) | B(a.reg);
+        }
+        c.val[c.len++] = 0x0F;
+        c.val[c.len++] = 0x40 | cond;
+        c.val[c.len++] = 0xC0 | regi(b.reg) << 3 | regi(a.reg);
+        break;
+    case OPT_MEM_REG:
+        if (rrex(b.reg) || mrex(a.mem.addr)) {
+            c.val[c.len++] = REX | W(b.reg) | R(b.reg) | mrex(a.mem.addr);
+        }
+        c.val[c.len++] = 0x0F;
+        c.val[c.len++] = 0x40 | cond;
+        encode_addr(&c, regi(b.reg), a.mem.addr, 0, 0);
+        break;
+    }
+
+    return c;
+}
+
 static struct code encode_test(
     enum instr_optype optype,
     union operand a,
@@ -717,6 +842,70 @@ static struct code encode_test(
     return c;
 }
 
+/*
+ * Bit counting and scanning, on the form 0F xx /r. The mandatory F3
+ * prefix of popcnt, lzcnt and tzcnt is placed before REX.
+ */
+static struct code encode_bitscan(
+    enum instr_optype optype,
+    unsigned char prefix,
+    unsigned char opcode,
+    union operand a,
+    union operand b)
+{
+    struct code c = {{0}};
+    assert(optype == OPT_REG_REG);
+    assert(a.reg.w == b.reg.w);
+    assert(b.reg.w == 4 || b.reg.w == 8);
+
+    if (prefix) {
+        c.val[c.len++] = prefix;
+    }
+    if (rrex(a.reg) || rrex(b.reg)) {
+        c.val[c.len++] = REX | W(b.reg) | R(b.reg) | B(a.reg);
+    }
+    c.val[c.len++] = 0x0F;
+    c.val[c.len++] = opcode;
+    c.val[c.len++] = 0xC0 | regi(b.reg) << 3 | regi(a.reg);
+    return c;
+}
+
+static struct code encode_bswap(enum instr_optype optype, union operand op)
+{
+    struct code c = {{0}};
+    assert(optype == OPT_REG);
+    assert(op.reg.w == 4 || op.reg.w == 8);
+
+    if (rrex(op.reg)) {
+        c.val[c.len++] = REX | W(op.reg) | B(op.reg);
+    }
+    c.val[c.len++] = 0x0F;
+    c.val[c.len++] = 0xC8 | regi(op.reg);
+    return c;
+}
+
+/*
+ * Prefetch memory operand, on the form 0F 18 /n with hint given by
+ * the reg field, or 0F 0D /1 for prefetchw.
+ */
+static struct code encode_prefetch(
+    enum instr_optype optype,
+    unsigned char opcode,
+    int hint,
+    union operand op)
+{
+    struct code c = {{0}};
+    assert(optype == OPT_MEM);
+
+    if (mrex(op.mem.addr)) {
+        c.val[c.len++] = REX | mrex(op.mem.addr);
+    }
+    c.val[c.len++] = 0x0F;
+    c.val[c.len++] = opcode;
+    encode_addr(&c, hint, op.mem.addr, 0, 0);
+    return c;
+}
+
 static struct code encode_not(enum instr_optype optype, union operand op)
 {
     struct code c = {{0}};
@@ -740,8 +929,8 @@ static struct code encode_mul(enum instr_optype optype, union operand op)
         c.val[c.len++] = 0xE0 | regi(op.reg);
     } else {
         assert(optype == OPT_MEM);
-        if (op.mem.w > 4) {
-            c.val[c.len++] = REX | W(op.mem) | is_64_bit_reg(op.mem.addr.base);
+        if (op.mem.w > 4 || mrex(op.mem.addr)) {
+            c.val[c.len++] = REX | W(op.mem) | mrex(op.mem.addr);
         }
         c.val[c.len++] = 0xF6 | w(op.mem);
         encode_addr(&c, 0x4, op.mem.addr, 0, 0);
@@ -750,6 +939,29 @@ static struct code encode_mul(enum instr_optype optype, union operand op)
     return c;
 }
 
+static struct code encode_signed_mul(
+    enum instr_optype optype,
+    union operand op)
+{
+    struct code c = {{0}};
+
+    if (optype == OPT_REG) {
+        if (is_64_bit_reg(op.reg.r) || op.reg.w > 4)
+            c.val[c.len++] = REX | W(op.reg) | B(op.reg);
+        c.val[c.len++] = 0xF6 | w(op.reg);
+        c.val[c.len++] = 0xE8 | regi(op.reg);
+    } else {
+        assert(optype == OPT_MEM);
+        if (op.mem.w > 4 || mrex(op.mem.addr)) {
+            c.val[c.len++] = REX | W(op.mem) | mrex(op.mem.addr);
+        }
+        c.val[c.len++] = 0xF6 | w(op.mem);
+        encode_addr(&c, 0x5, op.mem.addr, 0, 0);
+    }
+
+    return c;
+}
+
 static struct code encode_div(enum instr_optype optype, union operand op)
 {
     struct code c = {{0}};
@@ -762,8 +974,8 @@ static struct code encode_div(enum instr_optype optype, union operand op)
         c.val[c.len++] = 0xF0 | regi(op.reg);
     } else {
         assert(optype == OPT_MEM);
-        if (op.mem.w > 4) {
-            c.val[c.len++] = REX | W(op.mem) | is_64_bit_reg(op.mem.addr.base);
+        if (op.mem.w > 4 || mrex(op.mem.addr)) {
+            c.val[c.len++] = REX | W(op.mem) | mrex(op.mem.addr);
         }
         c.val[c.len++] = 0xF6 | w(op.mem);
         encode_addr(&c, 0x6, op.mem.addr, 0, 0);
@@ -782,7 +994,7 @@ static struct code encode_signed_div(enum instr_optype optype, union operand op)
         c.val[c.len++] = 0xF8 | regi(op.reg);
     } else {
         assert(optype == OPT_MEM);
-        c.val[c.len++] = REX | W(op.mem) | is_64_bit_reg(op.mem.addr.base);
+        c.val[c.len++] = REX | W(op.mem) | mrex(op.mem.addr);
         c.val[c.len++] = 0xF6 | w(op.mem);
         encode_addr(&c, 0x7, op.mem.addr, 0, 0);
     }
@@ -818,8 +1030,8 @@ static struct code encode_bitwise(
         if (a.imm.w == 2) {
             c.val[c.len++] = PREFIX_OPERAND_SIZE;
         }
-        if (is_64_bit_reg(b.reg.r)) {
-            c.val[c.len++] = REX | B(b.reg);
+        if (rrex(b.reg)) {
+            c.val[c.len++] = REX | W(b.reg) | B(b.reg);
         }
         if (b.reg.r == AX && (!is_byte_imm(a.imm) || b.reg.w == 1)) {
             c.val[c.len++] = opcode | 0x04 | w(a.imm);
@@ -889,11 +1101,58 @@ static struct code movaps(
     union operand a,
     union operand b)
 {
-    struct code c = {{PREFIX_SSE, 0x29}, 2};
-    assert(optype == OPT_REG_MEM);
-    assert(a.reg.r >= XMM0 && a.reg.r <= XMM7);
+    struct code c = {{0}};
+
+    switch (optype) {
+    case OPT_MEM_REG:
+        if (rrex(b.reg) || mrex(a.mem.addr)) {
+            c.val[c.len++] = REX | R(b.reg) | mrex(a.mem.addr);
+        }
+        c.val[c.len++] = PREFIX_SSE;
+        c.val[c.len++] = 0x28;
+        encode_addr(&c, regi(b.reg), a.mem.addr, 0, 0);
+        break;
+    case OPT_REG_MEM:
+        if (rrex(a.reg) || mrex(b.mem.addr)) {
+            c.val[c.len++] = REX | R(a.reg) | mrex(b.mem.addr);
+        }
+        c.val[c.len++] = PREFIX_SSE;
+        c.val[c.len++] = 0x29;
+        encode_addr(&c, regi(a.reg), b.mem.addr, 0, 0);
+        break;
+    default: assert(0);
+    }
+
+    return c;
+}
+
+static struct code movups(
+    enum instr_optype optype,
+    union operand a,
+    union operand b)
+{
+    struct code c = {{0}};
+
+    switch (optype) {
+    case OPT_MEM_REG:
+        if (rrex(b.reg) || mrex(a.mem.addr)) {
+            c.val[c.len++] = REX | R(b.reg) | mrex(a.mem.addr);
+        }
+        c.val[c.len++] = PREFIX_SSE;
+        c.val[c.len++] = 0x10;
+        encode_addr(&c, regi(b.reg), a.mem.addr, 0, 0);
+        break;
+    case OPT_REG_MEM:
+        if (rrex(a.reg) || mrex(b.mem.addr)) {
+            c.val[c.len++] = REX | R(a.reg) | mrex(b.mem.addr);
+        }
+        c.val[c.len++] = PREFIX_SSE;
+        c.val[c.len++] = 0x11;
+        encode_addr(&c, regi(a.reg), b.mem.addr, 0, 0);
+        break;
+    default: assert(0);
+    }
 
-    encode_addr(&c, (a.reg.r - XMM0), b.mem.addr, 0, 0);
     return c;
 }
 
@@ -1043,6 +1302,10 @@ static struct code x87_encode_transfer(unsigned int op, union operand m)
 {
     struct code c = {0};
 
+    if (mrex(m.mem.addr)) {
+        c.val[c.len++] = REX | mrex(m.mem.addr);
+    }
+
     switch (m.mem.w) {
     case 4:
         c.val[c.len++] = PREFIX_X87 | 0x01;
@@ -1189,6 +1452,8 @@ INTERNAL struct code encode(struct instruction instr)
         return encode_not(instr.optype, instr.source);
     case INSTR_MUL:
         return encode_mul(instr.optype, instr.source);
+    case INSTR_IMUL:
+        return encode_signed_mul(instr.optype, instr.source);
     case INSTR_MULSD:
         return sse_enc(instr.optype, 0xF2, 0x59, instr.source, instr.dest, 0);
     case INSTR_MULSS:
@@ -1225,6 +1490,8 @@ INTERNAL struct code encode(struct instruction instr)
         return movzx(instr.optype, instr.source, instr.dest);
     case INSTR_MOVAPS:
         return movaps(instr.optype, instr.source, instr.dest);
+    case INSTR_MOVUPS:
+        return movups(instr.optype, instr.source, instr.dest);
     case INSTR_MOVSD:
         return sse_mov(instr.optype, 0xF2, instr.source, instr.dest);
     case INSTR_MOVSS:
@@ -1235,6 +1502,31 @@ INTERNAL struct code encode(struct instruction instr)
         return encode_pop(instr.optype, instr.source);
     case INSTR_PXOR:
         return pxor(instr.optype, instr.source, instr.dest);
+    case INSTR_POPCNT:
+        return encode_bitscan(
+            instr.optype, 0xF3, 0xB8, instr.source, instr.dest);
+    case INSTR_LZCNT:
+        return encode_bitscan(
+            instr.optype, 0xF3, 0xBD, instr.source, instr.dest);
+    case INSTR_TZCNT:
+        return encode_bitscan(
+            instr.optype, 0xF3, 0xBC, instr.source, instr.dest);
+    case INSTR_BSR:
+        return encode_bitscan(instr.optype, 0, 0xBD, instr.source, instr.dest);
+    case INSTR_BSF:
+        return encode_bitscan(instr.optype, 0, 0xBC, instr.source, instr.dest);
+    case INSTR_BSWAP:
+        return encode_bswap(instr.optype, instr.source);
+    case INSTR_PREFETCHNTA:
+        return encode_prefetch(instr.optype, 0x18, 0, instr.source);
+    case INSTR_PREFETCHT0:
+        return encode_prefetch(instr.optype, 0x18, 1, instr.source);
+    case INSTR_PREFETCHT1:
+        return encode_prefetch(instr.optype, 0x18, 2, instr.source);
+    case INSTR_PREFETCHT2:
+        return encode_prefetch(instr.optype, 0x18, 3, instr.source);
+    case INSTR_PREFETCHW:
+        return encode_prefetch(instr.optype, 0x0D, 1, instr.source);
     case INSTR_SUB:
         return encode_sub(instr.optype, instr.source, instr.dest);
     case INSTR_SUBSD:
@@ -1306,6 +1598,26 @@ INTERNAL struct code encode(struct instruction instr)
         return setcc(instr.optype, TEST_NGE, instr.source);
     case INSTR_SETNP:
         return setcc(instr.optype, TEST_NP, instr.source);
+    case INSTR_CMOVE:
+        return cmovcc(instr.optype, TEST_E, instr.source, instr.dest);
+    case INSTR_CMOVNE:
+        return cmovcc(instr.optype, TEST_NE, instr.source, instr.dest);
+    case INSTR_CMOVA:
+        return cmovcc(instr.optype, TEST_A, instr.source, instr.dest);
+    case INSTR_CMOVNA:
+        return cmovcc(instr.optype, TEST_NA, instr.source, instr.dest);
+    case INSTR_CMOVAE:
+        return cmovcc(instr.optype, TEST_AE, instr.source, instr.dest);
+    case INSTR_CMOVNAE:
+        return cmovcc(instr.optype, TEST_NAE, instr.source, instr.dest);
+    case INSTR_CMOVG:
+        return cmovcc(instr.optype, TEST_G, instr.source, instr.dest);
+    case INSTR_CMOVNG:
+        return cmovcc(instr.optype, TEST_NG, instr.source, instr.dest);
+    case INSTR_CMOVGE:
+        return cmovcc(instr.optype, TEST_GE, instr.source, instr.dest);
+    case INSTR_CMOVNGE:
+        return cmovcc(instr.optype, TEST_NGE, instr.source, instr.dest);
     case INSTR_TEST:
         return encode_test(instr.optype, instr.source, instr.dest);
     case INSTR_FLD:
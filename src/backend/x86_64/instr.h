@@ -146,9 +146,11 @@ enum opcode {
     INSTR_MOVZX,
     INSTR_MOVSX,
     INSTR_MOVAPS,
+    INSTR_MOVUPS,       /* Move unaligned packed single-precision. */
     INSTR_MOVSD,        /* Move double. */
     INSTR_MOVSS,        /* Move float. */
     INSTR_MUL,
+    INSTR_IMUL,         /* Signed multiplication. */
     INSTR_MULSD,        /* Multiply scalar double-precision. */
     INSTR_MULSS,        /* Multiply scalar double-precision. */
     INSTR_SETE,         /* Set equal. */
@@ -165,11 +167,32 @@ enum opcode {
     INSTR_SETNP,        /* Set not parity bit. */
     INSTR_UCOMISS,      /* Compare single-precision and set EFLAGS. */
     INSTR_UCOMISD,      /* Compare double-precision and set EFLAGS. */
+    INSTR_CMOVE,        /* Conditional move if equal. */
+    INSTR_CMOVNE,
+    INSTR_CMOVA,
+    INSTR_CMOVNA,       /* Conditional move if not above. */
+    INSTR_CMOVAE,
+    INSTR_CMOVNAE,      /* Conditional move if not above or equal. */
+    INSTR_CMOVG,
+    INSTR_CMOVNG,       /* Conditional move if not greater than. */
+    INSTR_CMOVGE,
+    INSTR_CMOVNGE,      /* Conditional move if not greater or equal. */
     INSTR_CMP,
     INSTR_LEA,
     INSTR_PUSH,
     INSTR_POP,
     INSTR_PXOR,         /* Bitwise xor with xmm register. */
+    INSTR_POPCNT,       /* Population count. */
+    INSTR_LZCNT,        /* Count leading zero bits. */
+    INSTR_TZCNT,        /* Count trailing zero bits. */
+    INSTR_BSR,          /* Bit scan reverse. */
+    INSTR_BSF,          /* Bit scan forward. */
+    INSTR_BSWAP,        /* Reverse byte order. */
+    INSTR_PREFETCHT0,   /* Prefetch into all cache levels. */
+    INSTR_PREFETCHT1,
+    INSTR_PREFETCHT2,
+    INSTR_PREFETCHNTA,  /* Prefetch non-temporal data. */
+    INSTR_PREFETCHW,    /* Prefetch in anticipation of write. */
     INSTR_JMP,
     INSTR_JA,
     INSTR_JNA,          /* Jump if not above. */
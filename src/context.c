@@ -85,7 +85,7 @@ INTERNAL void verbose(const char *format, ...)
 INTERNAL void warning(const char *format, ...)
 {
     va_list args;
-    if (!context.suppress_warning) {
+    if (!context.suppress_warning && !current_file_is_system) {
         va_start(args, format);
         fprintf(
             stderr,
@@ -12,7 +12,12 @@
 # include "backend/compile.c"
 # include "backend/graphviz/dot.c"
 # include "optimizer/transform.c"
+# include "optimizer/algebra.c"
+# include "optimizer/alias.c"
+# include "optimizer/ifconvert.c"
+# include "optimizer/layout.c"
 # include "optimizer/liveness.c"
+# include "optimizer/simplify.c"
 # include "optimizer/optimize.c"
 # include "preprocessor/tokenize.c"
 # include "preprocessor/strtab.c"
@@ -47,6 +52,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 /*
@@ -58,9 +64,16 @@
 # define LACC_STDLIB_PATH "/usr/local/lib/lacc/include"
 #endif
 
+/*
+ * Alignment of functions and loop headers from -O2, or when enabled
+ * with -falign-functions or -falign-loops without a value.
+ */
+#define DEFAULT_CODE_ALIGNMENT 16
+
 static const char *program;
 static FILE *output;
 static int optimization_level;
+static int align_functions = -1, align_loops = -1;
 static int dump_symbols, dump_types;
 
 static void help(const char *arg)
@@ -96,13 +109,95 @@ static void flag(const char *arg)
     }
 }
 
+/*
+ * Fast math enables all floating point optimizations that do not
+ * conform to IEEE semantics.
+ */
+static void set_fast_math(int enable)
+{
+    context.fast_math = enable;
+    context.no_honor_nans = enable;
+    context.associative_math = enable;
+    context.reciprocal_math = enable;
+}
+
 static void option(const char *arg)
 {
     if (!strcmp("-fPIC", arg)) {
         context.pic = 1;
+    } else if (!strcmp("-fstrict-aliasing", arg)) {
+        context.strict_aliasing = 1;
+    } else if (!strcmp("-fno-strict-aliasing", arg)) {
+        context.strict_aliasing = 0;
+    } else if (!strcmp("-fplt", arg)) {
+        context.no_plt = 0;
+    } else if (!strcmp("-fno-plt", arg)) {
+        context.no_plt = 1;
+    } else if (!strcmp("-ffunction-sections", arg)) {
+        context.function_sections = 1;
+    } else if (!strcmp("-fno-function-sections", arg)) {
+        context.function_sections = 0;
+    } else if (!strcmp("-fdata-sections", arg)) {
+        context.data_sections = 1;
+    } else if (!strcmp("-fno-data-sections", arg)) {
+        context.data_sections = 0;
+    } else if (!strcmp("-ffast-math", arg)) {
+        set_fast_math(1);
+    } else if (!strcmp("-fno-fast-math", arg)) {
+        set_fast_math(0);
+    } else if (!strcmp("-fhonor-nans", arg)) {
+        context.no_honor_nans = 0;
+    } else if (!strcmp("-fno-honor-nans", arg)) {
+        context.no_honor_nans = 1;
+    } else if (!strcmp("-fassociative-math", arg)) {
+        context.associative_math = 1;
+    } else if (!strcmp("-fno-associative-math", arg)) {
+        context.associative_math = 0;
+    } else if (!strcmp("-freciprocal-math", arg)) {
+        context.reciprocal_math = 1;
+    } else if (!strcmp("-fno-reciprocal-math", arg)) {
+        context.reciprocal_math = 0;
+    } else if (!strcmp("-falign-functions", arg)) {
+        align_functions = DEFAULT_CODE_ALIGNMENT;
+    } else if (!strcmp("-fno-align-functions", arg)) {
+        align_functions = 1;
+    } else if (!strcmp("-falign-loops", arg)) {
+        align_loops = DEFAULT_CODE_ALIGNMENT;
+    } else if (!strcmp("-fno-align-loops", arg)) {
+        align_loops = 1;
+    } else if (!strcmp("-fpass-stats", arg)) {
+        set_optimization_stats(1);
+    } else if (!strncmp("-fno-", arg, 5)) {
+        if (!disable_optimization_pass(arg + 5)) {
+            fprintf(stderr, "Unrecognized option %s.\n", arg);
+            exit(1);
+        }
     } else assert(0);
 }
 
+/*
+ * Enable or disable instruction set extensions, given as -m<name> or
+ * -mno-<name>.
+ */
+static void set_target_feature(const char *arg)
+{
+    int enable;
+    const char *name;
+
+    enable = strncmp("-mno-", arg, 5) != 0;
+    name = arg + (enable ? 2 : 5);
+    if (!strcmp("popcnt", name)) {
+        context.popcnt = enable;
+    } else if (!strcmp("lzcnt", name)) {
+        context.lzcnt = enable;
+    } else if (!strcmp("bmi", name)) {
+        context.bmi = enable;
+    } else {
+        fprintf(stderr, "Unrecognized option %s.\n", arg);
+        exit(1);
+    }
+}
+
 static void open_output_handle(const char *file)
 {
     output = fopen(file, "w");
@@ -132,6 +227,59 @@ static void set_optimization_level(const char *level)
     optimization_level = level[2] - '0';
 }
 
+/*
+ * Parse alignment given to -falign-functions= or -falign-loops=, which
+ * must be a power of two. Zero means the default, same as giving the
+ * option without a value.
+ */
+static int parse_alignment(const char *arg)
+{
+    char *end;
+    long n;
+
+    n = strtol(arg, &end, 10);
+    if (*end || n < 0 || n > 4096 || (n & (n - 1))) {
+        fprintf(stderr, "Invalid alignment %s.\n", arg);
+        exit(1);
+    }
+
+    return n ? (int) n : DEFAULT_CODE_ALIGNMENT;
+}
+
+static void set_function_alignment(const char *arg)
+{
+    align_functions = parse_alignment(arg);
+}
+
+static void set_loop_alignment(const char *arg)
+{
+    align_loops = parse_alignment(arg);
+}
+
+static void set_visibility(const char *arg)
+{
+    if (!strcmp("default", arg)) {
+        context.visibility = VISIBILITY_DEFAULT;
+    } else if (!strcmp("hidden", arg)) {
+        context.visibility = VISIBILITY_HIDDEN;
+    } else if (!strcmp("internal", arg)) {
+        context.visibility = VISIBILITY_INTERNAL;
+    } else if (!strcmp("protected", arg)) {
+        context.visibility = VISIBILITY_PROTECTED;
+    } else {
+        fprintf(stderr, "Unrecognized visibility %s.\n", arg);
+        exit(1);
+    }
+}
+
+static void set_pass_list(const char *list)
+{
+    if (!set_optimization_passes(list)) {
+        fprintf(stderr, "Unrecognized pass list %s.\n", list);
+        exit(1);
+    }
+}
+
 static void set_dump_state(const char *arg)
 {
     if (!strcmp("--dump-symbols", arg)) {
@@ -174,6 +322,26 @@ static char *parse_program_arguments(int argc, char *argv[])
         {"-v", &flag},
         {"-w", &flag},
         {"-fPIC", &option},
+        {"-fpass-stats", &option},
+        {"-fstrict-aliasing", &option},
+        {"-fplt", &option},
+        {"-ffunction-sections", &option},
+        {"-fdata-sections", &option},
+        {"-ffast-math", &option},
+        {"-fhonor-nans", &option},
+        {"-fassociative-math", &option},
+        {"-freciprocal-math", &option},
+        {"-fno-", &option},
+        {"-fpass-list=", &set_pass_list},
+        {"-falign-functions=", &set_function_alignment},
+        {"-falign-loops=", &set_loop_alignment},
+        {"-falign-functions", &option},
+        {"-falign-loops", &option},
+        {"-fvisibility=", &set_visibility},
+        {"-mpopcnt", &set_target_feature},
+        {"-mlzcnt", &set_target_feature},
+        {"-mbmi", &set_target_feature},
+        {"-mno-", &set_target_feature},
         {"--help", &help},
         {"-o:", &open_output_handle},
         {"-I:", &add_include_search_path},
@@ -191,7 +359,17 @@ static char *parse_program_arguments(int argc, char *argv[])
     output = stdout;
     context.standard = STD_C89;
     context.target = TARGET_IR_DOT;
+    context.visibility = VISIBILITY_DEFAULT;
     c = parse_args(sizeof(optv)/sizeof(optv[0]), optv, argc, argv);
+
+    /*
+     * Align functions and loop headers to 16 bytes by default from -O2,
+     * unless given explicitly.
+     */
+    context.align_functions = (align_functions != -1) ? align_functions
+        : (optimization_level >= 2) ? DEFAULT_CODE_ALIGNMENT : 1;
+    context.align_loops = (align_loops != -1) ? align_loops
+        : (optimization_level >= 2) ? DEFAULT_CODE_ALIGNMENT : 1;
     if (c == argc - 1) {
         input = argv[c];
     } else if (c < argc - 1) {
@@ -211,6 +389,24 @@ static void register_builtin_declarations(void)
     inject_line("void *memcpy(void *dest, const void *src, unsigned long n);");
     inject_line("void __builtin_va_start(void);");
     inject_line("void __builtin_va_arg(void);");
+    inject_line("long __builtin_expect(long, long);");
+    inject_line("void __builtin_prefetch(const void *, ...);");
+    inject_line(
+        "void *__builtin_assume_aligned(const void *, unsigned long, ...);");
+    inject_line("int __builtin_popcount(unsigned int);");
+    inject_line("int __builtin_popcountl(unsigned long);");
+    inject_line("int __builtin_popcountll(unsigned long);");
+    inject_line("int __builtin_clz(unsigned int);");
+    inject_line("int __builtin_clzl(unsigned long);");
+    inject_line("int __builtin_clzll(unsigned long);");
+    inject_line("int __builtin_ctz(unsigned int);");
+    inject_line("int __builtin_ctzl(unsigned long);");
+    inject_line("int __builtin_ctzll(unsigned long);");
+    inject_line("int __builtin_ffs(int);");
+    inject_line("int __builtin_ffsl(long);");
+    inject_line("int __builtin_ffsll(long);");
+    inject_line("unsigned int __builtin_bswap32(unsigned int);");
+    inject_line("unsigned long __builtin_bswap64(unsigned long);");
     inject_line(
         "typedef struct {"
         "   unsigned int gp_offset;"
@@ -226,10 +422,10 @@ static void register_builtin_declarations(void)
  */
 static void add_include_search_paths(void)
 {
-    add_include_search_path("/usr/local/include");
-    add_include_search_path(LACC_STDLIB_PATH);
-    add_include_search_path("/usr/include/x86_64-linux-gnu");
-    add_include_search_path("/usr/include");
+    add_system_search_path("/usr/local/include");
+    add_system_search_path(LACC_STDLIB_PATH);
+    add_system_search_path("/usr/include/x86_64-linux-gnu");
+    add_system_search_path("/usr/include");
 }
 
 int main(int argc, char *argv[])
@@ -0,0 +1,510 @@
+#if !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+#include "algebra.h"
+
+#include <lacc/array.h>
+#include <lacc/type.h>
+
+#include <assert.h>
+
+static int is_integer_immediate(struct var var)
+{
+    return var.kind == IMMEDIATE && !var.symbol && is_integer(var.type);
+}
+
+/* Bits of integer immediate, truncated to the width of its type. */
+static unsigned long immediate_bits(struct var var)
+{
+    int w;
+
+    assert(is_integer_immediate(var));
+    w = size_of(var.type);
+    if (w == 8) {
+        return var.imm.u;
+    }
+
+    return var.imm.u & ((1ul << (w * 8)) - 1);
+}
+
+static int is_immediate_value(struct var var, long value)
+{
+    struct var imm;
+
+    if (!is_integer_immediate(var))
+        return 0;
+
+    imm = var;
+    imm.imm.i = value;
+    return immediate_bits(var) == immediate_bits(imm);
+}
+
+/*
+ * Return k if operand is an integer immediate 2^k, with k > 0, and the
+ * value is positive.
+ */
+static int power_of_two(struct var var)
+{
+    int k;
+    unsigned long bits;
+
+    if (!is_integer_immediate(var))
+        return 0;
+
+    bits = immediate_bits(var);
+    if (bits < 2 || (bits & (bits - 1)))
+        return 0;
+
+    for (k = 0; bits > 1; ++k) {
+        bits >>= 1;
+    }
+
+    if (is_signed(var.type) && k == size_of(var.type) * 8 - 1)
+        return 0;
+
+    return k;
+}
+
+/* Create integer immediate of given type, in canonical representation. */
+static struct var integer_immediate(Type type, long value)
+{
+    union value val = {0};
+    struct var var;
+
+    assert(is_integer(type));
+    var = var_numeric(type, val);
+    if (is_signed(type)) {
+        var.imm.i = value;
+        switch (size_of(type)) {
+        case 1: var.imm.i = (signed char) value; break;
+        case 2: var.imm.i = (short) value; break;
+        case 4: var.imm.i = (int) value; break;
+        }
+    } else {
+        var.imm.i = value;
+        var.imm.u = immediate_bits(var);
+    }
+
+    return var;
+}
+
+static int is_volatile_operand(struct var var)
+{
+    return var.kind != IMMEDIATE && is_volatile(var.type);
+}
+
+/*
+ * Determine if both operands are guaranteed to read the same value.
+ */
+static int is_same_value(struct var a, struct var b)
+{
+    return a.kind == DIRECT
+        && b.kind == DIRECT
+        && a.symbol == b.symbol
+        && a.offset == b.offset
+        && a.field_width == b.field_width
+        && a.field_offset == b.field_offset
+        && type_equal(a.type, b.type)
+        && !is_volatile(a.type);
+}
+
+static int is_commutative(enum optype op)
+{
+    switch (op) {
+    case IR_OP_ADD:
+    case IR_OP_MUL:
+    case IR_OP_AND:
+    case IR_OP_OR:
+    case IR_OP_XOR:
+    case IR_OP_EQ:
+    case IR_OP_NE:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static struct expression binary(enum optype op, struct var l, struct var r)
+{
+    struct expression expr = {0};
+
+    expr.op = op;
+    expr.type = l.type;
+    expr.l = l;
+    expr.r = r;
+    return expr;
+}
+
+/*
+ * Replace expression with a simpler form, returning 1 if anything was
+ * changed. Operands can only be dropped if they are not volatile.
+ */
+static int simplify_operation(struct expression *expr)
+{
+    int k;
+    struct var l, r;
+
+    if (is_comparison(*expr)) {
+        if (!is_integer(expr->l.type))
+            return 0;
+    } else if (!is_integer(expr->type)) {
+        if ((expr->op == IR_OP_ADD || expr->op == IR_OP_SUB)
+            && is_pointer(expr->type)
+            && is_immediate_value(expr->r, 0))
+        {
+            *expr = as_expr(expr->l);
+            return 1;
+        }
+        return 0;
+    }
+
+    l = expr->l;
+    r = expr->r;
+    if (is_commutative(expr->op)
+        && is_integer_immediate(l)
+        && !is_integer_immediate(r)
+        && type_equal(l.type, r.type))
+    {
+        expr->l = r;
+        expr->r = l;
+        return 1;
+    }
+
+    switch (expr->op) {
+    default: break;
+    case IR_OP_ADD:
+        if (is_immediate_value(r, 0)) {
+            *expr = as_expr(l);
+            return 1;
+        }
+        break;
+    case IR_OP_SUB:
+        if (is_immediate_value(r, 0)) {
+            *expr = as_expr(l);
+            return 1;
+        }
+        if (is_same_value(l, r)) {
+            *expr = as_expr(integer_immediate(expr->type, 0));
+            return 1;
+        }
+        break;
+    case IR_OP_MUL:
+        if (is_immediate_value(r, 0) && !is_volatile_operand(l)) {
+            *expr = as_expr(integer_immediate(expr->type, 0));
+            return 1;
+        }
+        if (is_immediate_value(r, 1)) {
+            *expr = as_expr(l);
+            return 1;
+        }
+        if (is_immediate_value(r, -1)) {
+            *expr = binary(IR_OP_SUB, integer_immediate(expr->type, 0), l);
+            return 1;
+        }
+        if ((k = power_of_two(r)) != 0) {
+            *expr = binary(IR_OP_SHL, l, var_int(k));
+            return 1;
+        }
+        break;
+    case IR_OP_DIV:
+        if (is_immediate_value(r, 1)) {
+            *expr = as_expr(l);
+            return 1;
+        }
+        if (is_unsigned(expr->type) && (k = power_of_two(r)) != 0) {
+            *expr = binary(IR_OP_SHR, l, var_int(k));
+            return 1;
+        }
+        break;
+    case IR_OP_MOD:
+        if (is_immediate_value(r, 1) && !is_volatile_operand(l)) {
+            *expr = as_expr(integer_immediate(expr->type, 0));
+            return 1;
+        }
+        if (is_unsigned(expr->type) && (k = power_of_two(r)) != 0) {
+            *expr = binary(IR_OP_AND, l,
+                integer_immediate(expr->type, (long) ((1ul << k) - 1)));
+            return 1;
+        }
+        break;
+    case IR_OP_AND:
+        if (is_immediate_value(r, 0) && !is_volatile_operand(l)) {
+            *expr = as_expr(integer_immediate(expr->type, 0));
+            return 1;
+        }
+        if (is_immediate_value(r, -1) || is_same_value(l, r)) {
+            *expr = as_expr(l);
+            return 1;
+        }
+        break;
+    case IR_OP_OR:
+        if (is_immediate_value(r, -1) && !is_volatile_operand(l)) {
+            *expr = as_expr(integer_immediate(expr->type, -1));
+            return 1;
+        }
+        if (is_immediate_value(r, 0) || is_same_value(l, r)) {
+            *expr = as_expr(l);
+            return 1;
+        }
+        break;
+    case IR_OP_XOR:
+        if (is_immediate_value(r, 0)) {
+            *expr = as_expr(l);
+            return 1;
+        }
+        if (is_same_value(l, r)) {
+            *expr = as_expr(integer_immediate(expr->type, 0));
+            return 1;
+        }
+        break;
+    case IR_OP_SHL:
+    case IR_OP_SHR:
+        if (is_immediate_value(r, 0)) {
+            *expr = as_expr(l);
+            return 1;
+        }
+        break;
+    case IR_OP_GE:
+        if (is_integer_immediate(r)
+            && !is_immediate_value(r, is_signed(r.type)
+                ? (long) (1ul << (size_of(r.type) * 8 - 1))
+                : 0))
+        {
+            expr->op = IR_OP_GT;
+            expr->r = integer_immediate(r.type, (long) (r.imm.u - 1));
+            return 1;
+        }
+        break;
+    }
+
+    return 0;
+}
+
+static void insert_statement(struct block *block, int i, struct statement st)
+{
+    int j;
+
+    array_push_back(&block->code, st);
+    for (j = array_len(&block->code) - 1; j > i; --j) {
+        array_get(&block->code, j) = array_get(&block->code, j - 1);
+    }
+
+    array_get(&block->code, i) = st;
+}
+
+static struct var assign_temporary(
+    struct definition *def,
+    struct block *block,
+    int i,
+    struct expression expr)
+{
+    struct statement st = {0};
+
+    st.st = IR_ASSIGN;
+    st.t = create_var(def, expr.type);
+    st.expr = expr;
+    insert_statement(block, i, st);
+    return st.t;
+}
+
+/*
+ * Expand signed division or modulo by 2^k to shifts. Negative numbers
+ * are biased by 2^k - 1 before shifting, to round towards zero.
+ *
+ *   .t1 = x >> (N - 1)
+ *   .t2 = .t1 & (2^k - 1)
+ *   .t3 = x + .t2
+ *
+ * Quotient is then .t3 >> k, and remainder x - (.t3 & -2^k). Return
+ * number of statements inserted before position i.
+ */
+static int expand_signed_division(
+    struct definition *def,
+    struct block *block,
+    int i,
+    struct expression *expr)
+{
+    int k, n;
+    Type type;
+    struct var x, t;
+
+    type = expr->type;
+    if ((expr->op != IR_OP_DIV && expr->op != IR_OP_MOD)
+        || !is_signed(type)
+        || size_of(type) < 4
+        || is_volatile_operand(expr->l)
+        || is_field(expr->l)
+        || (k = power_of_two(expr->r)) == 0)
+        return 0;
+
+    x = expr->l;
+    n = size_of(type) * 8;
+    t = assign_temporary(def, block, i,
+        binary(IR_OP_SHR, x, var_int(n - 1)));
+    t = assign_temporary(def, block, i + 1,
+        binary(IR_OP_AND, t, integer_immediate(type, (long) ((1ul << k) - 1))));
+    t = assign_temporary(def, block, i + 2,
+        binary(IR_OP_ADD, x, t));
+    if (expr->op == IR_OP_DIV) {
+        *expr = binary(IR_OP_SHR, t, var_int(k));
+        return 3;
+    }
+
+    t = assign_temporary(def, block, i + 3,
+        binary(IR_OP_AND, t, integer_immediate(type, (long) -(1ul << k))));
+    *expr = binary(IR_OP_SUB, x, t);
+    return 4;
+}
+
+/*
+ * Determine if variable can be modified by statements in the range
+ * [from, to) of block. Only temporaries are known to not be written
+ * through pointers or by function calls.
+ */
+static int is_modified(
+    const struct block *block,
+    int from,
+    int to,
+    struct var var)
+{
+    const struct statement *st;
+
+    if (var.kind == IMMEDIATE)
+        return 0;
+
+    if (var.kind != DIRECT)
+        return 1;
+
+    for (; from < to; ++from) {
+        st = &array_get(&block->code, from);
+        if ((st->st == IR_ASSIGN || st->st == IR_VLA_ALLOC)
+            && st->t.kind == DIRECT
+            && st->t.symbol == var.symbol)
+            return 1;
+
+        if (!is_temporary(var.symbol)
+            && ((st->st == IR_ASSIGN && st->t.kind == DEREF)
+                || st->st == IR_VA_START
+                || has_side_effects(st->expr)))
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Return operand of negation or bitwise complement, which is written as
+ * 0 - x for integers. Return 0 if the expression is something else.
+ */
+static int negated_operand(struct expression expr, struct var *var)
+{
+    switch (expr.op) {
+    case IR_OP_NEG:
+    case IR_OP_NOT:
+        *var = expr.l;
+        return 1;
+    case IR_OP_SUB:
+        if (is_immediate_value(expr.l, 0)) {
+            *var = expr.r;
+            return 1;
+        }
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Reduce -(-x) or ~(~x) to x, where the inner operation is assigned to
+ * a temporary earlier in the same block.
+ */
+static int fold_double_negation(
+    const struct block *block,
+    int i,
+    struct expression *expr)
+{
+    int j;
+    struct var t, x;
+    const struct statement *st;
+
+    if (!negated_operand(*expr, &t)
+        || t.kind != DIRECT
+        || t.offset
+        || is_field(t)
+        || !is_temporary(t.symbol))
+        return 0;
+
+    for (j = i - 1; j >= 0; --j) {
+        st = &array_get(&block->code, j);
+        if (st->t.kind == DIRECT && st->t.symbol == t.symbol)
+            break;
+    }
+
+    if (j < 0
+        || st->st != IR_ASSIGN
+        || (st->expr.op == IR_OP_NOT) != (expr->op == IR_OP_NOT)
+        || !negated_operand(st->expr, &x)
+        || !type_equal(st->t.type, expr->type)
+        || !type_equal(st->expr.type, expr->type)
+        || !type_equal(x.type, expr->type)
+        || is_volatile_operand(x)
+        || is_modified(block, j + 1, i, x))
+        return 0;
+
+    *expr = as_expr(x);
+    return 1;
+}
+
+/*
+ * Simplify expression evaluated at position i in block, which is either
+ * a statement or the branch or return expression at the end. Return
+ * number of changes, and number of statements inserted before i.
+ */
+static int simplify(
+    struct definition *def,
+    struct block *block,
+    int i,
+    struct expression *expr,
+    int *inserted)
+{
+    int n = 0;
+
+    if (has_side_effects(*expr))
+        return 0;
+
+    while (simplify_operation(expr)) {
+        n += 1;
+    }
+
+    n += fold_double_negation(block, i, expr);
+    *inserted = expand_signed_division(def, block, i, expr);
+    return n + *inserted;
+}
+
+INTERNAL int simplify_expressions(struct definition *def)
+{
+    int i, j, n, k;
+    struct block *block;
+    struct statement st;
+
+    n = 0;
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        for (j = 0; j < array_len(&block->code); ++j) {
+            st = array_get(&block->code, j);
+            if (st.st == IR_ASSIGN) {
+                k = 0;
+                n += simplify(def, block, j, &st.expr, &k);
+                j += k;
+                array_get(&block->code, j).expr = st.expr;
+            }
+        }
+
+        if (block->jump[1] || block->has_return_value || block->indirect) {
+            k = 0;
+            n += simplify(def, block, j, &block->expr, &k);
+        }
+    }
+
+    return n;
+}
@@ -0,0 +1,27 @@
+#ifndef ALGEBRA_H
+#define ALGEBRA_H
+
+#include <lacc/ir.h>
+
+/*
+ * Algebraic simplification and strength reduction of expressions in a
+ * function definition.
+ *
+ *  - Integer constants are moved to the right hand side of commutative
+ *    operators, and comparisons x >= c are written as x > c - 1.
+ *  - Identities like x + 0, x * 1, x & -1 and x << 0 are reduced to x,
+ *    and x * 0, x & 0 and x ^ x to zero.
+ *  - Multiplication by a power of two becomes left shift. Unsigned
+ *    division and modulo by a power of two becomes right shift and
+ *    bitwise and.
+ *  - Signed division and modulo by a power of two is expanded to a
+ *    sequence of shifts and additions, biasing negative numbers to
+ *    round towards zero.
+ *  - Double negation -(-x) and ~(~x) of a temporary defined in the same
+ *    block is reduced to x.
+ *
+ * Return number of changes made.
+ */
+INTERNAL int simplify_expressions(struct definition *def);
+
+#endif
@@ -0,0 +1,455 @@
+#if !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+#include <lacc/alias.h>
+#include <lacc/array.h>
+#include <lacc/context.h>
+#include <lacc/type.h>
+
+#include <assert.h>
+#include <stdlib.h>
+
+/*
+ * Bitmask of symbols with address taken, or otherwise reachable from
+ * outside of the function.
+ */
+static unsigned long address_taken;
+
+/* Symbols enumerated for dataflow analysis, by index. */
+static const struct symbol *indexed[64];
+
+/*
+ * Information about how a symbol is assigned in the function, used to
+ * find what pointers are derived from. Sorted by symbol address for
+ * lookup, with one entry per symbol.
+ */
+struct pointer_def {
+    const struct symbol *sym;
+    struct expression expr;
+    int writes;
+    unsigned int is_param : 1;
+    unsigned int is_taken : 1;
+};
+
+static array_of(struct pointer_def) pointer_defs;
+
+/*
+ * Origin of pointer value. Parameters are only considered if they are
+ * never modified in the function.
+ */
+struct base {
+    enum {
+        BASE_UNKNOWN,
+        BASE_PARAM,
+        BASE_OBJECT
+    } kind;
+    const struct symbol *sym;
+};
+
+static void mark_var(struct var var)
+{
+    const struct symbol *sym;
+
+    sym = var.symbol;
+    if (!sym || !sym->index)
+        return;
+
+    indexed[sym->index - 1] = sym;
+    if (var.kind == ADDRESS
+        || var.kind == IMMEDIATE
+        || sym->linkage != LINK_NONE)
+    {
+        address_taken |= 1ul << (sym->index - 1);
+    }
+}
+
+static void mark_expression(struct expression expr)
+{
+    switch (expr.op) {
+    default:
+        mark_var(expr.r);
+    case IR_OP_CAST:
+    case IR_OP_NOT:
+    case IR_OP_NEG:
+    case IR_OP_POPCNT:
+    case IR_OP_CLZ:
+    case IR_OP_CTZ:
+    case IR_OP_FFS:
+    case IR_OP_BSWAP:
+    case IR_OP_CALL:
+    case IR_OP_VA_ARG:
+        mark_var(expr.l);
+        break;
+    }
+}
+
+static void add_pointer_def(
+    const struct symbol *sym,
+    struct expression expr,
+    int writes,
+    int is_param,
+    int is_taken)
+{
+    struct pointer_def def = {0};
+
+    def.sym = sym;
+    def.expr = expr;
+    def.writes = writes;
+    def.is_param = is_param;
+    def.is_taken = is_taken;
+    array_push_back(&pointer_defs, def);
+}
+
+static void add_address_taken(struct var var)
+{
+    struct expression expr = {0};
+
+    if (var.kind == ADDRESS && var.symbol->linkage == LINK_NONE) {
+        add_pointer_def(var.symbol, expr, 0, 0, 1);
+    }
+}
+
+static void add_expression_operands(struct expression expr)
+{
+    switch (expr.op) {
+    default:
+        add_address_taken(expr.r);
+    case IR_OP_CAST:
+    case IR_OP_NOT:
+    case IR_OP_NEG:
+    case IR_OP_POPCNT:
+    case IR_OP_CLZ:
+    case IR_OP_CTZ:
+    case IR_OP_FFS:
+    case IR_OP_BSWAP:
+    case IR_OP_CALL:
+    case IR_OP_VA_ARG:
+        add_address_taken(expr.l);
+        break;
+    }
+}
+
+/*
+ * Record assignment to target. Partial writes to fields or members
+ * count as multiple definitions, as the value is not fully known.
+ */
+static void add_assignment(struct var t, struct expression expr, int writes)
+{
+    if (t.kind == DIRECT && t.symbol->linkage == LINK_NONE) {
+        if (t.offset || is_field(t) || !is_pointer(t.type)) {
+            writes = 2;
+        }
+        add_pointer_def(t.symbol, expr, writes, 0, 0);
+    }
+}
+
+static int compare_pointer_def(const void *a, const void *b)
+{
+    const struct pointer_def *l, *r;
+
+    l = (const struct pointer_def *) a;
+    r = (const struct pointer_def *) b;
+    if (l->sym == r->sym)
+        return 0;
+
+    return ((unsigned long) l->sym < (unsigned long) r->sym) ? -1 : 1;
+}
+
+/* Sort and merge entries for the same symbol. */
+static void merge_pointer_defs(void)
+{
+    int i, j;
+    struct pointer_def *a, *b;
+
+    if (!array_len(&pointer_defs))
+        return;
+
+    qsort(pointer_defs.data, array_len(&pointer_defs),
+        sizeof(struct pointer_def), &compare_pointer_def);
+
+    for (i = 1, j = 0; i < array_len(&pointer_defs); ++i) {
+        a = &array_get(&pointer_defs, j);
+        b = &array_get(&pointer_defs, i);
+        if (a->sym == b->sym) {
+            if (b->writes && !a->writes) {
+                a->expr = b->expr;
+            }
+            a->writes += b->writes;
+            a->is_param |= b->is_param;
+            a->is_taken |= b->is_taken;
+        } else {
+            array_get(&pointer_defs, ++j) = *b;
+        }
+    }
+
+    pointer_defs.length = j + 1;
+}
+
+static const struct pointer_def *find_pointer_def(const struct symbol *sym)
+{
+    struct pointer_def key = {0};
+
+    key.sym = sym;
+    return bsearch(&key, pointer_defs.data, array_len(&pointer_defs),
+        sizeof(struct pointer_def), &compare_pointer_def);
+}
+
+/*
+ * Follow single assignments of pointer arithmetic back to the original
+ * pointer, which is either the address of an object, or a parameter.
+ * Pointer operands are converted to integer in arithmetic, so check
+ * the type of the symbol rather than the variable.
+ */
+static struct base resolve_base(struct var var, int depth)
+{
+    struct base base = {0};
+    const struct pointer_def *def;
+
+    if (!var.symbol || depth > 8)
+        return base;
+
+    switch (var.kind) {
+    case ADDRESS:
+    case IMMEDIATE:
+        base.kind = BASE_OBJECT;
+        base.sym = var.symbol;
+        break;
+    case DIRECT:
+        if (!is_pointer(var.symbol->type)
+            || var.offset
+            || var.symbol->linkage != LINK_NONE)
+            break;
+
+        def = find_pointer_def(var.symbol);
+        if (!def || def->is_taken)
+            break;
+
+        if (def->is_param && !def->writes) {
+            base.kind = BASE_PARAM;
+            base.sym = var.symbol;
+        } else if (!def->is_param && def->writes == 1) {
+            switch (def->expr.op) {
+            case IR_OP_CAST:
+            case IR_OP_ADD:
+            case IR_OP_SUB:
+                base = resolve_base(def->expr.l, depth + 1);
+                break;
+            default:
+                break;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    return base;
+}
+
+/* Find base of pointer dereferenced by var. */
+static struct base deref_base(struct var var)
+{
+    struct var ptr = {0};
+    struct base base = {0};
+
+    assert(var.kind == DEREF);
+    if (var.symbol) {
+        ptr.kind = DIRECT;
+        ptr.symbol = var.symbol;
+        ptr.type = var.symbol->type;
+        base = resolve_base(ptr, 0);
+    }
+
+    return base;
+}
+
+static int is_address_taken(const struct symbol *sym)
+{
+    const struct pointer_def *def;
+
+    def = find_pointer_def(sym);
+    return def && def->is_taken;
+}
+
+static int is_restrict_param(struct base base)
+{
+    return base.kind == BASE_PARAM && is_restrict(base.sym->type);
+}
+
+/*
+ * Under strict aliasing rules, an object can only be accessed through
+ * an lvalue of compatible type, disregarding qualifiers and signedness,
+ * or through character type. Aggregates can contain members of any
+ * type, and are conservatively assumed to alias everything.
+ */
+static int is_type_alias(Type a, Type b)
+{
+    if (!context.strict_aliasing)
+        return 1;
+
+    if (is_char(a) || is_char(b) || is_aggregate(a) || is_aggregate(b))
+        return 1;
+
+    return type_of(a) == type_of(b);
+}
+
+/*
+ * Pointers derived from different objects, or from a local object and
+ * a parameter, cannot point to the same memory. A restrict qualified
+ * parameter that is never modified is assumed to be the only way to
+ * access the object it points to.
+ */
+static int is_disjoint_base(struct base a, struct base b)
+{
+    if (a.kind == BASE_UNKNOWN || b.kind == BASE_UNKNOWN)
+        return 0;
+
+    if (a.sym == b.sym)
+        return 0;
+
+    if (a.kind == BASE_OBJECT && b.kind == BASE_OBJECT)
+        return 1;
+
+    if (a.kind == BASE_OBJECT)
+        return a.sym->linkage == LINK_NONE || is_restrict_param(b);
+
+    if (b.kind == BASE_OBJECT)
+        return b.sym->linkage == LINK_NONE || is_restrict_param(a);
+
+    return is_restrict_param(a) || is_restrict_param(b);
+}
+
+static int is_disjoint_range(struct var a, struct var b)
+{
+    return a.offset + size_of(a.type) <= b.offset
+        || b.offset + size_of(b.type) <= a.offset;
+}
+
+INTERNAL void alias_analysis(struct definition *def)
+{
+    int i, j;
+    struct block *block;
+    struct statement *st;
+    struct symbol *sym;
+    struct expression expr = {0};
+
+    address_taken = 0;
+    array_empty(&pointer_defs);
+    for (i = 0; i < array_len(&def->params); ++i) {
+        sym = array_get(&def->params, i);
+        if (is_pointer(sym->type)) {
+            add_pointer_def(sym, expr, 0, 1, 0);
+        }
+    }
+
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        for (j = 0; j < array_len(&block->code); ++j) {
+            st = &array_get(&block->code, j);
+            mark_expression(st->expr);
+            add_expression_operands(st->expr);
+            switch (st->st) {
+            case IR_ASSIGN:
+                mark_var(st->t);
+                add_assignment(st->t, st->expr, 1);
+                break;
+            case IR_CMOV:
+                mark_var(st->t);
+                mark_var(array_get(&def->sources, st->source));
+                add_address_taken(array_get(&def->sources, st->source));
+                add_assignment(st->t, st->expr, 2);
+                break;
+            case IR_VLA_ALLOC:
+                mark_var(st->t);
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (block->jump[1] || block->has_return_value || block->indirect) {
+            mark_expression(block->expr);
+            add_expression_operands(block->expr);
+        }
+    }
+
+    merge_pointer_defs();
+}
+
+INTERNAL unsigned long alias_set(struct var var)
+{
+    int i;
+    unsigned long set;
+    struct base base;
+    const struct symbol *sym;
+
+    assert(var.kind == DEREF);
+    set = 0;
+    base = deref_base(var);
+    for (i = 0; i < 64; ++i) {
+        if (!(address_taken & (1ul << i)))
+            continue;
+
+        sym = indexed[i];
+        assert(sym);
+        if (base.kind == BASE_OBJECT && sym != base.sym)
+            continue;
+
+        if (base.kind == BASE_PARAM && sym->linkage == LINK_NONE)
+            continue;
+
+        if (is_type_alias(sym->type, var.type)) {
+            set |= 1ul << i;
+        }
+    }
+
+    return set;
+}
+
+INTERNAL unsigned long call_alias_set(void)
+{
+    return address_taken;
+}
+
+INTERNAL int may_alias(struct var a, struct var b)
+{
+    struct base x, y;
+
+    assert(a.kind == DIRECT || a.kind == DEREF);
+    assert(b.kind == DIRECT || b.kind == DEREF);
+    if (a.kind == DIRECT && b.kind == DIRECT) {
+        return a.symbol == b.symbol && !is_disjoint_range(a, b);
+    }
+
+    if (!is_type_alias(a.type, b.type))
+        return 0;
+
+    if (a.kind == DEREF && b.kind == DEREF
+        && a.symbol
+        && a.symbol == b.symbol
+        && is_disjoint_range(a, b))
+        return 0;
+
+    if (a.kind == DIRECT) {
+        x.kind = BASE_OBJECT;
+        x.sym = a.symbol;
+        if (a.symbol->linkage == LINK_NONE
+            && !is_address_taken(a.symbol))
+            return 0;
+    } else {
+        x = deref_base(a);
+    }
+
+    if (b.kind == DIRECT) {
+        y.kind = BASE_OBJECT;
+        y.sym = b.symbol;
+        if (b.symbol->linkage == LINK_NONE
+            && !is_address_taken(b.symbol))
+            return 0;
+    } else {
+        y = deref_base(b);
+    }
+
+    return !is_disjoint_base(x, y);
+}
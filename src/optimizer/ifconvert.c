@@ -0,0 +1,397 @@
+#if !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+#include "ifconvert.h"
+#include "simplify.h"
+
+#include <lacc/array.h>
+#include <lacc/context.h>
+#include <lacc/type.h>
+
+#include <assert.h>
+
+static int is_unary(struct expression expr)
+{
+    return expr.op == IR_OP_CAST
+        || expr.op == IR_OP_NOT
+        || expr.op == IR_OP_NEG
+        || expr.op == IR_OP_POPCNT
+        || expr.op == IR_OP_CLZ
+        || expr.op == IR_OP_CTZ
+        || expr.op == IR_OP_FFS
+        || expr.op == IR_OP_BSWAP;
+}
+
+/* Symbols in current function which have their address taken. */
+static array_of(const struct symbol *) escaped_symbols;
+
+static void add_escaped_symbol(struct var var)
+{
+    if (var.kind == ADDRESS && var.symbol->linkage == LINK_NONE) {
+        array_push_back(&escaped_symbols, var.symbol);
+    }
+}
+
+static void add_escaped_operands(struct expression expr)
+{
+    add_escaped_symbol(expr.l);
+    if (!is_unary(expr) && expr.op != IR_OP_CALL && expr.op != IR_OP_VA_ARG) {
+        add_escaped_symbol(expr.r);
+    }
+}
+
+static void find_escaped_symbols(struct definition *def)
+{
+    int i, j;
+    struct block *block;
+
+    array_empty(&escaped_symbols);
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        for (j = 0; j < array_len(&block->code); ++j) {
+            add_escaped_operands(array_get(&block->code, j).expr);
+        }
+
+        if (block->jump[1] || block->has_return_value || block->indirect) {
+            add_escaped_operands(block->expr);
+        }
+    }
+
+    for (i = 0; i < array_len(&def->sources); ++i) {
+        add_escaped_symbol(array_get(&def->sources, i));
+    }
+}
+
+static int is_escaped(const struct symbol *sym)
+{
+    int i;
+
+    for (i = 0; i < array_len(&escaped_symbols); ++i) {
+        if (array_get(&escaped_symbols, i) == sym)
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Conditional moves operate on 32 or 64 bit registers, and we do not
+ * bother with partial writes to bitfields.
+ *
+ * Targets not allocated to a register are written back to memory
+ * unconditionally, which must not be observable. Only local variables
+ * without their address taken are considered.
+ */
+static int is_cmov_target(struct var var)
+{
+    return var.kind == DIRECT
+        && var.symbol->linkage == LINK_NONE
+        && !is_escaped(var.symbol)
+        && !is_field(var)
+        && !is_volatile(var.type)
+        && (is_integer(var.type) || is_pointer(var.type))
+        && (size_of(var.type) == 4 || size_of(var.type) == 8);
+}
+
+/*
+ * Condition must translate to a single flag test. Floating point
+ * equality also depends on the parity flag, and is not supported
+ * unless NaN operands are ignored.
+ */
+static int is_cmov_condition(struct expression expr)
+{
+    if (has_side_effects(expr))
+        return 0;
+
+    if (is_comparison(expr)) {
+        if (is_real(expr.l.type)) {
+            return !is_long_double(expr.l.type)
+                && (context.no_honor_nans
+                    || expr.op == IR_OP_GE
+                    || expr.op == IR_OP_GT);
+        }
+        return 1;
+    }
+
+    return is_integer(expr.type) || is_pointer(expr.type);
+}
+
+/*
+ * Operand which can be read without risk of faulting, or observable
+ * side effects.
+ */
+static int is_safe_operand(struct var var)
+{
+    switch (var.kind) {
+    case DIRECT:
+        return !is_volatile(var.type);
+    case ADDRESS:
+    case IMMEDIATE:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Determine if expression can be evaluated even if the original code
+ * would not have done so.
+ */
+static int is_speculative_safe(struct expression expr)
+{
+    switch (expr.op) {
+    case IR_OP_CALL:
+    case IR_OP_VA_ARG:
+    case IR_OP_DIV:
+    case IR_OP_MOD:
+        return 0;
+    default:
+        return is_safe_operand(expr.l)
+            && (is_unary(expr) || is_safe_operand(expr.r));
+    }
+}
+
+/*
+ * Assignment of a plain variable or integer constant, which can be
+ * done with a conditional move.
+ */
+static int is_move(const struct statement *st)
+{
+    struct var s;
+
+    if (!is_identity(st->expr) || !type_equal(st->t.type, st->expr.type))
+        return 0;
+
+    s = st->expr.l;
+    switch (s.kind) {
+    case DIRECT:
+        return !is_field(s) && !is_volatile(s.type);
+    case IMMEDIATE:
+        return !s.symbol && (is_integer(s.type) || is_pointer(s.type));
+    default:
+        return 0;
+    }
+}
+
+static int reads_symbol(struct var var, const struct symbol *sym)
+{
+    if (var.kind == DEREF) {
+        return var.symbol == sym || !is_temporary(sym);
+    }
+
+    return var.kind == DIRECT && var.symbol == sym;
+}
+
+/*
+ * Determine if evaluating condition can observe assignment to sym.
+ * Dereferencing a pointer might read any variable which has its
+ * address taken, which is never the case for temporaries.
+ */
+static int condition_reads(struct expression expr, const struct symbol *sym)
+{
+    return reads_symbol(expr.l, sym)
+        || (!is_unary(expr) && reads_symbol(expr.r, sym));
+}
+
+/*
+ * Replace condition with its inverse, which is not possible for
+ * floating point comparisons because of unordered operands, unless
+ * NaN operands are ignored.
+ */
+static int invert_condition(struct expression *expr)
+{
+    struct var tmp;
+    union value zero = {0};
+
+    if (is_comparison(*expr)) {
+        if (is_real(expr->l.type) && !context.no_honor_nans)
+            return 0;
+
+        switch (expr->op) {
+        default: assert(0);
+        case IR_OP_EQ:
+            expr->op = IR_OP_NE;
+            break;
+        case IR_OP_NE:
+            expr->op = IR_OP_EQ;
+            break;
+        case IR_OP_GE:
+        case IR_OP_GT:
+            tmp = expr->l;
+            expr->l = expr->r;
+            expr->r = tmp;
+            expr->op = (expr->op == IR_OP_GE) ? IR_OP_GT : IR_OP_GE;
+            break;
+        }
+        return 1;
+    }
+
+    if (is_identity(*expr)) {
+        expr->r = var_numeric(expr->l.type, zero);
+        expr->op = IR_OP_EQ;
+        expr->type = basic_type__int;
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Find the single assignment in a block only reachable through the
+ * branch, continuing unconditionally afterwards.
+ */
+static struct statement *arm_assignment(
+    const struct block *branch,
+    const struct block *arm)
+{
+    struct statement *st;
+
+    if (arm == branch
+        || arm->predecessors != 1
+        || !arm->jump[0]
+        || arm->jump[1]
+        || array_len(&arm->code) != 1)
+        return NULL;
+
+    st = &array_get(&arm->code, 0);
+    if (st->st != IR_ASSIGN || !is_cmov_target(st->t))
+        return NULL;
+
+    return st;
+}
+
+static void clear_arm(struct block *arm)
+{
+    array_empty(&arm->code);
+    arm->jump[0] = NULL;
+    arm->predecessors = 0;
+}
+
+static struct statement cmov(
+    struct definition *def,
+    struct expression cond,
+    const struct statement *st)
+{
+    struct statement cmov = {0};
+
+    cmov.st = IR_CMOV;
+    cmov.t = st->t;
+    cmov.source = array_len(&def->sources);
+    cmov.expr = cond;
+    array_push_back(&def->sources, st->expr.l);
+    return cmov;
+}
+
+/*
+ * Branch where one successor assigns a value before continuing to the
+ * other successor.
+ */
+static int convert_triangle(
+    struct definition *def,
+    struct block *block,
+    struct statement *st[2])
+{
+    int i;
+    struct block *join;
+    struct expression cond;
+
+    for (i = 1; i >= 0; --i) {
+        if (!st[i]
+            || block->jump[i]->jump[0] != block->jump[!i]
+            || !is_move(st[i]))
+            continue;
+
+        cond = block->expr;
+        if (!i && !invert_condition(&cond))
+            continue;
+
+        join = block->jump[!i];
+        array_push_back(&block->code, cmov(def, cond, st[i]));
+        clear_arm(block->jump[i]);
+        block->jump[0] = join;
+        block->jump[1] = NULL;
+        join->predecessors--;
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Branch where both successors assign to the same variable before
+ * joining. One of the assignments is done unconditionally, and must be
+ * done before evaluating the condition.
+ */
+static int convert_diamond(
+    struct definition *def,
+    struct block *block,
+    struct statement *st[2])
+{
+    int i;
+    struct var t;
+    struct block *join;
+    struct expression cond;
+
+    if (!st[0] || !st[1]
+        || block->jump[0]->jump[0] != block->jump[1]->jump[0])
+        return 0;
+
+    t = st[0]->t;
+    if (t.symbol != st[1]->t.symbol
+        || t.offset != st[1]->t.offset
+        || !type_equal(t.type, st[1]->t.type)
+        || condition_reads(block->expr, t.symbol))
+        return 0;
+
+    for (i = 1; i >= 0; --i) {
+        if (!is_move(st[i])
+            || st[i]->expr.l.symbol == t.symbol
+            || !is_speculative_safe(st[!i]->expr))
+            continue;
+
+        cond = block->expr;
+        if (!i && !invert_condition(&cond))
+            continue;
+
+        join = block->jump[0]->jump[0];
+        array_push_back(&block->code, *st[!i]);
+        array_push_back(&block->code, cmov(def, cond, st[i]));
+        clear_arm(block->jump[0]);
+        clear_arm(block->jump[1]);
+        block->jump[0] = join;
+        block->jump[1] = NULL;
+        join->predecessors--;
+        return 1;
+    }
+
+    return 0;
+}
+
+INTERNAL int if_convert(struct definition *def)
+{
+    int i, n;
+    struct block *block;
+    struct statement *st[2];
+
+    count_predecessors(def);
+    find_escaped_symbols(def);
+    for (i = 0, n = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        if (!block->predecessors
+            || !block->jump[1]
+            || block->jump[0] == block->jump[1]
+            || !is_cmov_condition(block->expr))
+            continue;
+
+        st[0] = arm_assignment(block, block->jump[0]);
+        st[1] = arm_assignment(block, block->jump[1]);
+        if (convert_triangle(def, block, st)
+            || convert_diamond(def, block, st))
+        {
+            n += 1;
+        }
+    }
+
+    return n;
+}
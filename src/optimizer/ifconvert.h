@@ -0,0 +1,22 @@
+#ifndef IFCONVERT_H
+#define IFCONVERT_H
+
+#include <lacc/ir.h>
+
+/*
+ * Replace branches around single assignments with conditional moves,
+ * removing the branch entirely.
+ *
+ *   if (c) x = a;              x = b
+ *   else x = b;        =>      if (c) x = a
+ *
+ * Both diamonds, like the one above, and triangles without the else
+ * part are converted. The assignment executed unconditionally must be
+ * safe to evaluate speculatively, meaning no calls, division or memory
+ * access through pointers. Predecessor counts are recomputed first,
+ * as other passes do not keep them up to date. Return number of
+ * branches removed.
+ */
+INTERNAL int if_convert(struct definition *def);
+
+#endif
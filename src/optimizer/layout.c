@@ -0,0 +1,364 @@
+#if !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+#include "layout.h"
+
+#include <lacc/array.h>
+#include <lacc/type.h>
+
+#include <assert.h>
+#include <string.h>
+
+/*
+ * Edge in control flow graph going back to a block currently being
+ * visited in depth first traversal. The target is a loop header.
+ */
+struct back_edge {
+    const struct block *source;
+    const struct block *header;
+};
+
+static array_of(struct back_edge) back_edges;
+
+/*
+ * Reachable blocks in depth first order, blocks visited by graph
+ * search, and final placement order.
+ */
+static array_of(struct block *) dfs_order, visited, order;
+
+/*
+ * Blocks waiting to be placed. Alternative branch targets are pushed
+ * on a stack, while cold blocks are deferred until everything else is
+ * placed.
+ */
+static array_of(struct block *) worklist, coldlist;
+
+/*
+ * Visit all reachable blocks, recording back edges. Blocks on the
+ * stack of the traversal are marked gray.
+ */
+static void find_back_edges(struct block *block)
+{
+    int i;
+    struct block *next;
+    struct back_edge edge;
+
+    block->color = GRAY;
+    array_push_back(&dfs_order, block);
+    for (i = 1; i >= 0; --i) {
+        next = block->jump[i];
+        if (!next)
+            continue;
+
+        if (next->color == GRAY) {
+            edge.source = block;
+            edge.header = next;
+            array_push_back(&back_edges, edge);
+        } else if (next->color == WHITE) {
+            find_back_edges(next);
+        }
+    }
+
+    for (i = 0; i < array_len(&block->targets); ++i) {
+        next = array_get(&block->targets, i);
+        if (next->color == GRAY) {
+            edge.source = block;
+            edge.header = next;
+            array_push_back(&back_edges, edge);
+        } else if (next->color == WHITE) {
+            find_back_edges(next);
+        }
+    }
+
+    block->color = BLACK;
+}
+
+static int is_back_edge(const struct block *source, const struct block *next)
+{
+    int i;
+    struct back_edge edge;
+
+    for (i = 0; i < array_len(&back_edges); ++i) {
+        edge = array_get(&back_edges, i);
+        if (edge.source == source && edge.header == next) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int is_loop_header(const struct block *block)
+{
+    int i;
+
+    for (i = 0; i < array_len(&back_edges); ++i) {
+        if (array_get(&back_edges, i).header == block) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int search_loop_body(struct block *block, const struct block *header)
+{
+    int i;
+    struct block *next;
+
+    if (block == header || block->color == GRAY)
+        return 0;
+
+    block->color = GRAY;
+    array_push_back(&visited, block);
+    for (i = 0; i < 2 && block->jump[i]; ++i) {
+        if (block->jump[i] == header) {
+            if (is_back_edge(block, header))
+                return 1;
+        } else if (search_loop_body(block->jump[i], header)) {
+            return 1;
+        }
+    }
+
+    for (i = 0; i < array_len(&block->targets); ++i) {
+        next = array_get(&block->targets, i);
+        if (next == header) {
+            if (is_back_edge(block, header))
+                return 1;
+        } else if (search_loop_body(next, header)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Determine if block is part of the loop with the given header, by
+ * finding a path to a back edge not going through the header itself.
+ */
+static int is_in_loop(struct block *block, const struct block *header)
+{
+    int i, found;
+
+    array_empty(&visited);
+    found = search_loop_body(block, header);
+    for (i = 0; i < array_len(&visited); ++i) {
+        array_get(&visited, i)->color = BLACK;
+    }
+
+    return found;
+}
+
+/*
+ * Functions known to not return, which are typically only called on
+ * error conditions, or functions declared with cold attribute.
+ */
+static int is_error_call(struct expression expr)
+{
+    const char *name;
+
+    if (expr.op != IR_OP_CALL || expr.l.kind != ADDRESS)
+        return 0;
+
+    if (expr.l.symbol->cold)
+        return 1;
+
+    if (expr.l.symbol->linkage != LINK_EXTERN)
+        return 0;
+
+    name = sym_name(expr.l.symbol);
+    return !strcmp(name, "abort")
+        || !strcmp(name, "exit")
+        || !strcmp(name, "_Exit")
+        || !strcmp(name, "_exit")
+        || !strcmp(name, "__assert_fail")
+        || !strcmp(name, "longjmp");
+}
+
+/*
+ * Blocks returning from the function, or calling functions handling
+ * error conditions, are not expected to execute often.
+ */
+static int is_cold(const struct block *block)
+{
+    int i;
+
+    if (!block->jump[0] && !block->indirect)
+        return 1;
+
+    for (i = 0; i < array_len(&block->code); ++i) {
+        if (is_error_call(array_get(&block->code, i).expr)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int is_null_pointer(struct var var)
+{
+    return var.kind == IMMEDIATE
+        && !var.symbol
+        && is_integer(var.type)
+        && var.imm.u == 0;
+}
+
+/*
+ * Predict outcome of comparing a pointer against null. Return index of
+ * the branch taken when pointer is not null, or -1 if not applicable.
+ */
+static int predict_null_check(struct expression expr)
+{
+    if (is_identity(expr) && is_pointer(expr.type))
+        return 1;
+
+    if (expr.op != IR_OP_EQ && expr.op != IR_OP_NE)
+        return -1;
+
+    if ((is_pointer(expr.l.type) && is_null_pointer(expr.r))
+        || (is_pointer(expr.r.type) && is_null_pointer(expr.l)))
+        return expr.op == IR_OP_NE;
+
+    return -1;
+}
+
+/*
+ * Return index of the successor most likely to follow a conditional
+ * branch, or -1 if no heuristic applies.
+ */
+static int predict_branch(struct block *block)
+{
+    int i, in[2];
+
+    for (i = 0; i < 2; ++i) {
+        if (is_back_edge(block, block->jump[i])) {
+            return i;
+        }
+    }
+
+    if (is_loop_header(block)) {
+        in[0] = is_in_loop(block->jump[0], block);
+        in[1] = is_in_loop(block->jump[1], block);
+        if (in[0] != in[1]) {
+            return in[1];
+        }
+    }
+
+    in[0] = is_cold(block->jump[0]);
+    in[1] = is_cold(block->jump[1]);
+    if (in[0] != in[1]) {
+        return in[0];
+    }
+
+    return predict_null_check(block->expr);
+}
+
+static void place_blocks(struct block *block, int predict)
+{
+    int i;
+    struct block *first, *second;
+
+    while (block && block->color == WHITE) {
+        block->color = BLACK;
+        array_push_back(&order, block);
+        if (block->indirect) {
+            for (i = array_len(&block->targets) - 1; i >= 0; --i) {
+                array_push_back(&worklist, array_get(&block->targets, i));
+            }
+            break;
+        }
+
+        if (!block->jump[1]) {
+            block = block->jump[0];
+            continue;
+        }
+
+        i = (block->likely == LIKELY_FALSE) ? 0 : 1;
+        first = block->jump[i];
+        second = block->jump[!i];
+        if (block->expect != LIKELY_NONE
+            || (predict && is_cold(second) && !is_cold(first)))
+        {
+            array_push_back(&coldlist, second);
+            block = first;
+        } else {
+            array_push_back(&worklist, second);
+            block = (first->color == WHITE) ? first : second;
+        }
+    }
+}
+
+INTERNAL void layout_blocks(struct definition *def, int predict)
+{
+    int i, j;
+    struct block *block;
+
+    array_empty(&back_edges);
+    array_empty(&dfs_order);
+    array_empty(&order);
+    array_empty(&worklist);
+    array_empty(&coldlist);
+    find_back_edges(def->body);
+
+    for (i = 0; i < array_len(&dfs_order); ++i) {
+        block = array_get(&dfs_order, i);
+        if (block->jump[1] && block->expect != LIKELY_NONE) {
+            block->likely = block->expect;
+        } else if (block->jump[1] && predict) {
+            switch (predict_branch(block)) {
+            case 0:
+                block->likely = LIKELY_FALSE;
+                break;
+            case 1:
+                block->likely = LIKELY_TRUE;
+                break;
+            default:
+                block->likely = LIKELY_NONE;
+                break;
+            }
+        }
+    }
+
+    for (i = 0; i < array_len(&dfs_order); ++i) {
+        array_get(&dfs_order, i)->color = WHITE;
+    }
+
+    i = 0;
+    place_blocks(def->body, predict);
+    while (array_len(&worklist) || i < array_len(&coldlist)) {
+        if (array_len(&worklist)) {
+            block = array_pop_back(&worklist);
+        } else {
+            block = array_get(&coldlist, i++);
+        }
+        place_blocks(block, predict);
+    }
+
+    assert(array_len(&order) == array_len(&dfs_order));
+    for (i = 0, j = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        if (block->color == WHITE) {
+            array_get(&def->nodes, j++) = block;
+        }
+    }
+
+    assert(j + array_len(&order) == array_len(&def->nodes));
+    for (i = array_len(&def->nodes) - 1; i >= 0; --i) {
+        array_get(&def->nodes, i) = (i < array_len(&order))
+            ? array_get(&order, i)
+            : array_get(&def->nodes, i - array_len(&order));
+    }
+
+    for (i = 0; i < array_len(&order); ++i) {
+        array_get(&order, i)->color = WHITE;
+    }
+
+    array_clear(&back_edges);
+    array_clear(&dfs_order);
+    array_clear(&visited);
+    array_clear(&order);
+    array_clear(&worklist);
+    array_clear(&coldlist);
+}
@@ -0,0 +1,28 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <lacc/ir.h>
+
+/*
+ * Decide order of basic blocks in generated code, reordering the list
+ * of nodes in the definition. Blocks reachable from the entry point
+ * are placed first, starting with the function body.
+ *
+ * Without prediction, blocks are placed in depth first order, visiting
+ * the true branch first. With prediction enabled, static heuristics
+ * choose which successor to fall through to, and blocks unlikely to
+ * execute are moved to the end of the function:
+ *
+ *  - Loop back edges are taken, and loop exits are not.
+ *  - Branches leading directly to return, or to error handling calls
+ *    like abort and exit, are not taken.
+ *  - Pointers compared to null are unlikely to be null.
+ *
+ * Branches on a value from __builtin_expect follow the expected
+ * outcome, with the other successor moved to the end, also when
+ * prediction is not enabled. Calls to functions with cold attribute
+ * are treated as error handling.
+ */
+INTERNAL void layout_blocks(struct definition *def, int predict);
+
+#endif
@@ -4,6 +4,7 @@
 #endif
 #include "liveness.h"
 #include "optimize.h"
+#include <lacc/alias.h>
 
 #include <assert.h>
 
@@ -33,13 +34,20 @@ static unsigned long set_def_bit(struct var var)
  * Set bit for symbol possibly read through operation. This set must be
  * part of in-liveness.
  *
- * Pointers can point to anything, so assume everything is touched.
+ * Pointers can point to any symbol with address taken, or with static
+ * storage duration.
  */
 static unsigned long set_use_bit(struct var var)
 {
+    unsigned long r;
+
     switch (var.kind) {
     case DEREF:
-        return 0xFFFFFFFFFFFFFFFFul;
+        r = alias_set(var);
+        if (var.symbol && var.symbol->index) {
+            r |= 1ul << (var.symbol->index - 1);
+        }
+        return r;
     case DIRECT:
     case ADDRESS:
         if (is_object(var.symbol->type)) {
@@ -60,6 +68,11 @@ static unsigned long set_use_bit(struct var var)
     return 0;
 }
 
+/*
+ * Function calls can read anything reachable through pointers passed
+ * as arguments, or stored in memory. Reading variable arguments goes
+ * through memory referenced by va_list.
+ */
 static unsigned long use(const struct expression *expr)
 {
     unsigned long r = 0ul;
@@ -70,9 +83,16 @@ static unsigned long use(const struct expression *expr)
     case IR_OP_CAST:
     case IR_OP_NOT:
     case IR_OP_NEG:
+    case IR_OP_POPCNT:
+    case IR_OP_CLZ:
+    case IR_OP_CTZ:
+    case IR_OP_FFS:
+    case IR_OP_BSWAP:
+        r |= set_use_bit(expr->l);
+        break;
     case IR_OP_CALL:
     case IR_OP_VA_ARG:
-        r |= set_use_bit(expr->l);
+        r |= set_use_bit(expr->l) | call_alias_set();
         break;
     }
 
@@ -90,6 +110,8 @@ static unsigned long uses(const struct statement *s)
             t.kind = DIRECT;
             r |= set_use_bit(t);
         }
+    } else if (s->st == IR_CMOV) {
+        r |= set_use_bit(s->t) | set_use_bit(cmov_source(s));
     }
 
     return r;
@@ -116,13 +138,19 @@ INTERNAL int live_variable_analysis(struct block *block)
         }
     } else {
         block->out = 0l;
+        for (i = 0; i < array_len(&block->targets); ++i) {
+            block->out |= array_get(&block->targets, i)->in;
+        }
     }
 
-    /* Go through all statements. Extra edge for branch and return. */
+    /*
+     * Go through all statements. Extra edge for branch, return and
+     * computed goto.
+     */
     if (array_len(&block->code)) {
         prev = &array_back(&block->code);
         prev->out = block->out;
-        if (block->jump[1] || block->has_return_value) {
+        if (block->jump[1] || block->has_return_value || block->indirect) {
             prev->out |= use(&block->expr);
         }
 
@@ -135,7 +163,7 @@ INTERNAL int live_variable_analysis(struct block *block)
         block->in = (prev->out & ~def(prev)) | uses(prev);
     } else {
         block->in = block->out;
-        if (block->jump[1] || block->has_return_value) {
+        if (block->jump[1] || block->has_return_value || block->indirect) {
             block->in |= use(&block->expr);
         }
     }
@@ -17,4 +17,12 @@ INTERNAL int is_live_after(
 	const struct symbol *sym,
 	const struct statement *st);
 
+/*
+ * Determine whether a variable may be read after evaluating the branch
+ * or return expression of a block.
+ */
+INTERNAL int is_live_out(
+	const struct symbol *sym,
+	const struct block *block);
+
 #endif
@@ -3,12 +3,21 @@
 # define EXTERNAL extern
 #endif
 #include "optimize.h"
+#include "algebra.h"
+#include "ifconvert.h"
+#include "layout.h"
 #include "liveness.h"
+#include "simplify.h"
 #include "transform.h"
 
+#include <lacc/alias.h>
 #include <lacc/array.h>
 #include <lacc/context.h>
+
 #include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
 
 static int optimization_level;
 
@@ -22,6 +31,9 @@ static array_of(struct block *) blocklist;
  */
 static array_of(struct symbol *) symbols;
 
+/* Definition currently being optimized. */
+static struct definition *current_definition;
+
 /*
  * Serialize basic blocks by recursively visiting each node and
  * appending to list. Assign number to each symbol in use. Return
@@ -29,6 +41,8 @@ static array_of(struct symbol *) symbols;
  */
 static int serialize_basic_blocks(struct block *block)
 {
+    int i;
+
     if (block->color == BLACK)
         return 0;
 
@@ -41,6 +55,10 @@ static int serialize_basic_blocks(struct block *block)
         }
     }
 
+    for (i = 0; i < array_len(&block->targets); ++i) {
+        serialize_basic_blocks(array_get(&block->targets, i));
+    }
+
     return 1;
 }
 
@@ -112,6 +130,11 @@ static int enumerate_used_symbols(struct block *block)
         case IR_OP_CAST:
         case IR_OP_NOT:
         case IR_OP_NEG:
+        case IR_OP_POPCNT:
+        case IR_OP_CLZ:
+        case IR_OP_CTZ:
+        case IR_OP_FFS:
+        case IR_OP_BSWAP:
         case IR_OP_CALL:
         case IR_OP_VA_ARG:
             n += count_symbol((struct symbol *) s->expr.l.symbol);
@@ -120,16 +143,24 @@ static int enumerate_used_symbols(struct block *block)
 
         if (s->st == IR_ASSIGN) {
             n += count_symbol((struct symbol *) s->t.symbol);
+        } else if (s->st == IR_CMOV) {
+            n += count_symbol((struct symbol *) s->t.symbol);
+            n += count_symbol((struct symbol *) cmov_source(s).symbol);
         }
     }
 
-    if (block->has_return_value || block->jump[1]) {
+    if (block->has_return_value || block->jump[1] || block->indirect) {
         switch (block->expr.op) {
         default:
             n += count_symbol((struct symbol *) block->expr.r.symbol);
         case IR_OP_CAST:
         case IR_OP_NOT:
         case IR_OP_NEG:
+        case IR_OP_POPCNT:
+        case IR_OP_CLZ:
+        case IR_OP_CTZ:
+        case IR_OP_FFS:
+        case IR_OP_BSWAP:
         case IR_OP_CALL:
         case IR_OP_VA_ARG:
             n += count_symbol((struct symbol *) block->expr.l.symbol);
@@ -226,7 +257,7 @@ int print_liveness(struct block *block)
         print_liveness_statement(st->out);
     }
 
-    if (block->jump[1] || block->has_return_value) {
+    if (block->jump[1] || block->has_return_value || block->indirect) {
         print_liveness_statement(block->out);
     }
 
@@ -234,6 +265,13 @@ int print_liveness(struct block *block)
 }
 #endif
 
+INTERNAL struct var cmov_source(const struct statement *st)
+{
+    assert(current_definition);
+    assert(st->st == IR_CMOV);
+    return array_get(&current_definition->sources, st->source);
+}
+
 INTERNAL int is_live_after(const struct symbol *sym, const struct statement *st)
 {
     if (optimization_level && is_object(sym->type)) {
@@ -244,18 +282,28 @@ INTERNAL int is_live_after(const struct symbol *sym, const struct statement *st)
     return 1;
 }
 
-INTERNAL void push_optimization(int level)
+INTERNAL int is_live_out(const struct symbol *sym, const struct block *block)
 {
-    optimization_level = level;
+    if (optimization_level && is_object(sym->type)) {
+        assert(sym->index);
+        return (block->out & (1ul << (sym->index - 1))) != 0;
+    }
+
+    return 1;
 }
 
-INTERNAL void optimize(struct definition *def)
+/*
+ * Run local transformation on each block, recomputing liveness until
+ * no more changes are made. Dataflow is only tracked for functions
+ * with less than 64 symbols, otherwise nothing is done.
+ */
+static int run_dataflow_pass(
+    struct definition *def,
+    int (*transform)(struct block *))
 {
-    int syms, n;
-
-    if (!optimization_level || !is_function(def->symbol->type))
-        return;
+    int syms, n, changes;
 
+    changes = 0;
     array_empty(&blocklist);
     array_empty(&symbols);
     serialize_basic_blocks(def->body);
@@ -263,24 +311,315 @@ INTERNAL void optimize(struct definition *def)
     syms = traverse(&enumerate_used_symbols);
 
     if (syms < 64) {
+        alias_analysis(def);
         initialize_dataflow();
         do {
-            n = 0;
             execute_iterative_dataflow(&live_variable_analysis);
-
             /*traverse(&print_liveness);*/
-            n += traverse(&dead_store_elimination);
-            n += traverse(&merge_chained_assignment);
-            /*if (n) printf("Did %d changes!\n", n);*/
+            n = traverse(transform);
+            changes += n;
         } while (n);
+
+        traverse(&skip_empty_blocks);
     }
 
     reset_symbol_indexes();
     traverse(&color_white);
+    return changes;
+}
+
+static int eliminate_dead_stores(struct definition *def)
+{
+    return run_dataflow_pass(def, &dead_store_elimination);
+}
+
+static int merge_assignments(struct definition *def)
+{
+    return run_dataflow_pass(def, &merge_chained_assignment);
+}
+
+/*
+ * Threading retargets edges in the control flow graph, which requires
+ * predecessor counts to be recomputed afterwards.
+ */
+static int thread_branches(struct definition *def)
+{
+    int n;
+
+    n = run_dataflow_pass(def, &thread_boolean_branch);
+    if (n) {
+        count_predecessors(def);
+    }
+
+    return n;
+}
+
+/*
+ * Set if simplify-cfg is part of the pipeline being run, and not
+ * disabled on the command line.
+ */
+static int has_simplify_cfg;
+
+/*
+ * Conversion to conditional moves can make new diamonds appear after
+ * simplifying the control flow graph, which is done until no more
+ * changes can be made. Simplification is skipped if the pass is not
+ * enabled.
+ */
+static int convert_branches(struct definition *def)
+{
+    int n, changes;
+
+    changes = 0;
+    while ((n = if_convert(def)) != 0) {
+        changes += n;
+        if (has_simplify_cfg) {
+            simplify_cfg(def);
+        }
+    }
+
+    return changes;
+}
+
+static int predict_layout(struct definition *def)
+{
+    layout_blocks(def, 1);
+    return 0;
+}
+
+/*
+ * Optimization pass registered with name, which can be referenced on
+ * the command line. Passes are part of the default pipeline for every
+ * optimization level greater than or equal to the level specified.
+ */
+struct pass {
+    const char *name;
+    int (*run)(struct definition *def);
+    int level;
+    int disabled;
+
+    /* Statistics accumulated over the translation unit. */
+    int runs;
+    int changes;
+    clock_t time;
+    long before;
+    long after;
+};
+
+static struct pass passes[] = {
+    {"simplify-cfg", &simplify_cfg, 1},
+    {"algebra", &simplify_expressions, 1},
+    {"dse", &eliminate_dead_stores, 1},
+    {"merge-assign", &merge_assignments, 1},
+    {"thread-branch", &thread_branches, 1},
+    {"if-convert", &convert_branches, 1},
+    {"tail-merge", &merge_tails, 2},
+    {"layout", &predict_layout, 1}
+};
+
+#define PASS_COUNT (sizeof(passes) / sizeof(passes[0]))
+
+/*
+ * Default order of passes, filtered by optimization level. Block layout
+ * is always done last, after all other passes have been iterated.
+ */
+static const char *default_pipeline[] = {
+    "simplify-cfg",
+    "algebra",
+    "dse",
+    "merge-assign",
+    "thread-branch",
+    "simplify-cfg",
+    "if-convert",
+    "tail-merge",
+    "layout"
+};
+
+/*
+ * Maximum number of times the pipeline is run on each function, for
+ * each optimization level. Iteration stops early if no pass makes any
+ * changes.
+ */
+static const int pipeline_rounds[] = {0, 1, 4, 8};
+
+/* Passes to run, either from the command line or default pipeline. */
+static array_of(struct pass *) pipeline;
+
+static int has_pass_list, print_pass_stats;
+
+static struct pass *find_pass(const char *name, size_t len)
+{
+    int i;
+
+    for (i = 0; i < PASS_COUNT; ++i) {
+        if (strlen(passes[i].name) == len
+            && !strncmp(passes[i].name, name, len))
+        {
+            return &passes[i];
+        }
+    }
+
+    return NULL;
+}
+
+static long count_statements(struct definition *def)
+{
+    int i;
+    long n;
+
+    for (i = 0, n = 0; i < array_len(&def->nodes); ++i) {
+        n += array_len(&array_get(&def->nodes, i)->code);
+    }
+
+    return n;
+}
+
+static int run_pass(struct pass *pass, struct definition *def)
+{
+    int n;
+    clock_t start;
+
+    pass->runs += 1;
+    pass->before += count_statements(def);
+    start = clock();
+    n = pass->run(def);
+    pass->time += clock() - start;
+    pass->after += count_statements(def);
+    pass->changes += n;
+    return n;
+}
+
+static void output_pass_stats(void)
+{
+    int i;
+    struct pass *pass;
+
+    fprintf(stderr, "%-16s %6s %8s %10s %10s %10s\n",
+        "pass", "runs", "changes", "time (ms)", "before", "after");
+    for (i = 0; i < PASS_COUNT; ++i) {
+        pass = &passes[i];
+        if (pass->runs) {
+            fprintf(stderr, "%-16s %6d %8d %10.3f %10ld %10ld\n",
+                pass->name, pass->runs, pass->changes,
+                (double) pass->time * 1000 / CLOCKS_PER_SEC,
+                pass->before, pass->after);
+        }
+    }
+}
+
+INTERNAL int disable_optimization_pass(const char *name)
+{
+    struct pass *pass;
+
+    pass = find_pass(name, strlen(name));
+    if (pass) {
+        pass->disabled = 1;
+        return 1;
+    }
+
+    return 0;
+}
+
+INTERNAL int set_optimization_passes(const char *list)
+{
+    const char *end;
+    struct pass *pass;
+
+    has_pass_list = 1;
+    array_empty(&pipeline);
+    while (*list) {
+        end = strchr(list, ',');
+        if (!end) {
+            end = list + strlen(list);
+        }
+
+        pass = find_pass(list, end - list);
+        if (!pass) {
+            return 0;
+        }
+
+        array_push_back(&pipeline, pass);
+        list = *end ? end + 1 : end;
+    }
+
+    return 1;
+}
+
+INTERNAL void set_optimization_stats(int enable)
+{
+    print_pass_stats = enable;
+}
+
+INTERNAL void push_optimization(int level)
+{
+    int i;
+    struct pass *pass;
+
+    assert(level >= 0 && level <= 3);
+    optimization_level = level;
+    if (!has_pass_list) {
+        array_empty(&pipeline);
+        for (i = 0; i < sizeof(default_pipeline) / sizeof(char *); ++i) {
+            pass = find_pass(default_pipeline[i], strlen(default_pipeline[i]));
+            assert(pass);
+            if (pass->level <= level) {
+                array_push_back(&pipeline, pass);
+            }
+        }
+    }
+}
+
+INTERNAL void optimize(struct definition *def)
+{
+    int i, n, rounds;
+    struct pass *pass, *layout;
+
+    if (!is_function(def->symbol->type))
+        return;
+
+    current_definition = def;
+    layout = NULL;
+    if (optimization_level) {
+        has_simplify_cfg = 0;
+        for (i = 0; i < array_len(&pipeline); ++i) {
+            pass = array_get(&pipeline, i);
+            if (pass->run == &simplify_cfg && !pass->disabled) {
+                has_simplify_cfg = 1;
+                break;
+            }
+        }
+
+        rounds = pipeline_rounds[optimization_level];
+        do {
+            for (i = 0, n = 0; i < array_len(&pipeline); ++i) {
+                pass = array_get(&pipeline, i);
+                if (pass->disabled) {
+                    continue;
+                } else if (pass->run == &predict_layout) {
+                    layout = pass;
+                } else {
+                    n += run_pass(pass, def);
+                }
+            }
+        } while (n && --rounds);
+    }
+
+    if (layout) {
+        run_pass(layout, def);
+    } else {
+        layout_blocks(def, 0);
+    }
+
+    current_definition = NULL;
 }
 
 INTERNAL void pop_optimization(void)
 {
+    if (print_pass_stats) {
+        output_pass_stats();
+    }
+
     array_clear(&blocklist);
     array_clear(&symbols);
+    array_clear(&pipeline);
 }
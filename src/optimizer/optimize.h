@@ -5,16 +5,48 @@
 
 #include <lacc/ir.h>
 
-/* Set to non-zero to enable optimization. */
+/*
+ * Disable optimization pass by name, for example "if-convert". Return
+ * 0 if there is no pass with the given name.
+ */
+INTERNAL int disable_optimization_pass(const char *name);
+
+/*
+ * Replace the default pipeline with a comma separated list of passes,
+ * run in the order given. Return 0 if any pass name is not recognized.
+ */
+INTERNAL int set_optimization_passes(const char *list);
+
+/*
+ * Print number of runs, changes made, time spent and IR statement
+ * counts before and after each pass to stderr when optimization is
+ * done.
+ */
+INTERNAL void set_optimization_stats(int enable);
+
+/*
+ * Set optimization level from 0 to 3, choosing the pipeline of passes
+ * to run. Level 0 disables optimization. Higher levels include more
+ * passes, and iterate the pipeline more times per function.
+ */
 INTERNAL void push_optimization(int level);
 
 /*
  * Do data flow analysis and perform optimizations on the intermediate
  * representation. Leaves the definition in a semantically equivalent,
  * and hopefully more consise, state.
+ *
+ * Always decide placement of basic blocks, which is the order they are
+ * emitted by the backend.
  */
 INTERNAL void optimize(struct definition *def);
 
+/*
+ * Source operand of conditional move statement, in the definition
+ * currently being optimized.
+ */
+INTERNAL struct var cmov_source(const struct statement *st);
+
 /* Disable previously set optimization, cleaning up resources. */
 INTERNAL void pop_optimization(void);
 
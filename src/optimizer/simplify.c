@@ -0,0 +1,549 @@
+#if !AMALGAMATION
+# define INTERNAL
+# define EXTERNAL extern
+#endif
+#include "simplify.h"
+
+#include <lacc/array.h>
+#include <lacc/type.h>
+
+#include <assert.h>
+
+/*
+ * Blocks reachable from function entry, in depth first order.
+ */
+static array_of(struct block *) reachable;
+
+static void visit_reachable(struct block *block)
+{
+    int i;
+
+    if (block->color == BLACK)
+        return;
+
+    block->color = BLACK;
+    array_push_back(&reachable, block);
+    if (block->jump[0]) {
+        visit_reachable(block->jump[0]);
+        if (block->jump[1]) {
+            visit_reachable(block->jump[1]);
+        }
+    }
+
+    for (i = 0; i < array_len(&block->targets); ++i) {
+        visit_reachable(array_get(&block->targets, i));
+    }
+}
+
+/*
+ * Collect reachable blocks, and count number of incoming edges to each
+ * of them. The entry block has an implicit extra predecessor, as do
+ * blocks with label address taken. These are always kept, and never
+ * merged with other blocks.
+ */
+static void compute_reachable(struct definition *def)
+{
+    int i;
+    struct block *block;
+
+    array_empty(&reachable);
+    visit_reachable(def->body);
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        if (block->label->referenced) {
+            visit_reachable(block);
+        }
+    }
+
+    for (i = 0; i < array_len(&reachable); ++i) {
+        block = array_get(&reachable, i);
+        block->predecessors = block->label->referenced;
+    }
+
+    def->body->predecessors = 1;
+    for (i = 0; i < array_len(&reachable); ++i) {
+        block = array_get(&reachable, i);
+        if (block->jump[0]) {
+            block->jump[0]->predecessors++;
+            if (block->jump[1]) {
+                block->jump[1]->predecessors++;
+            }
+        }
+    }
+}
+
+static void color_reachable_white(void)
+{
+    int i;
+
+    for (i = 0; i < array_len(&reachable); ++i) {
+        array_get(&reachable, i)->color = WHITE;
+    }
+}
+
+INTERNAL void count_predecessors(struct definition *def)
+{
+    int i;
+
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        array_get(&def->nodes, i)->predecessors = 0;
+    }
+
+    compute_reachable(def);
+    color_reachable_white();
+}
+
+static int is_same_operand(struct var a, struct var b)
+{
+    if (a.kind != b.kind
+        || a.symbol != b.symbol
+        || a.offset != b.offset
+        || a.field_width != b.field_width
+        || a.field_offset != b.field_offset
+        || !type_equal(a.type, b.type)
+        || is_volatile(a.type))
+        return 0;
+
+    if (a.kind == IMMEDIATE) {
+        return !is_long_double(a.type) && a.imm.u == b.imm.u;
+    }
+
+    return 1;
+}
+
+/*
+ * Determine outcome of branch condition b, given outcome of a. Return
+ * 1 if b is the same as a, 0 if b is the inverse of a, and -1 if it
+ * cannot be determined.
+ */
+static int condition_relation(struct expression a, struct expression b)
+{
+    if (has_side_effects(a) || has_side_effects(b))
+        return -1;
+
+    if (is_comparison(a) && is_comparison(b)) {
+        if (!is_integer(a.l.type) && !is_pointer(a.l.type))
+            return a.op == b.op
+                && is_same_operand(a.l, b.l)
+                && is_same_operand(a.r, b.r) ? 1 : -1;
+
+        if (is_same_operand(a.l, b.l) && is_same_operand(a.r, b.r)) {
+            if (a.op == b.op)
+                return 1;
+            if ((a.op == IR_OP_EQ && b.op == IR_OP_NE)
+                || (a.op == IR_OP_NE && b.op == IR_OP_EQ))
+                return 0;
+        } else if (is_same_operand(a.l, b.r) && is_same_operand(a.r, b.l)) {
+            if ((a.op == IR_OP_GE && b.op == IR_OP_GT)
+                || (a.op == IR_OP_GT && b.op == IR_OP_GE))
+                return 0;
+            if (a.op == b.op && (a.op == IR_OP_EQ || a.op == IR_OP_NE))
+                return 1;
+        }
+
+        return -1;
+    }
+
+    if (a.op == IR_OP_CAST
+        && b.op == IR_OP_CAST
+        && type_equal(a.type, b.type)
+        && is_same_operand(a.l, b.l))
+        return 1;
+
+    return -1;
+}
+
+/*
+ * Return index of branch taken if condition is an immediate integer or
+ * pointer value, otherwise -1.
+ */
+static int immediate_outcome(struct expression expr)
+{
+    if (is_immediate(expr) && !expr.l.symbol
+        && (is_integer(expr.type) || is_pointer(expr.type)))
+    {
+        return expr.l.imm.u != 0;
+    }
+
+    return -1;
+}
+
+static int fold_branch(struct block *block)
+{
+    int taken;
+
+    if (!block->jump[1])
+        return 0;
+
+    taken = immediate_outcome(block->expr);
+    if (taken >= 0) {
+        block->jump[!taken]->predecessors--;
+        block->jump[0] = block->jump[taken];
+        block->jump[1] = NULL;
+        return 1;
+    }
+
+    if (block->jump[0] == block->jump[1] && !has_side_effects(block->expr)) {
+        block->jump[1]->predecessors--;
+        block->jump[1] = NULL;
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Forward edge to a block without code, which branches on a condition
+ * already known when following the edge.
+ */
+static int thread_jump(struct block *block, int i)
+{
+    int taken;
+    struct block *next;
+
+    next = block->jump[i];
+    if (array_len(&next->code) || !next->jump[1] || next == block)
+        return 0;
+
+    taken = immediate_outcome(next->expr);
+    if (taken < 0 && block->jump[1]) {
+        taken = condition_relation(block->expr, next->expr);
+        if (taken >= 0) {
+            taken = taken ? i : !i;
+        }
+    }
+
+    if (taken < 0 || next->jump[taken] == next)
+        return 0;
+
+    next->predecessors--;
+    block->jump[i] = next->jump[taken];
+    block->jump[i]->predecessors++;
+    return 1;
+}
+
+static void merge_successor(struct block *block)
+{
+    int i;
+    struct block *next;
+
+    next = block->jump[0];
+    for (i = 0; i < array_len(&next->code); ++i) {
+        array_push_back(&block->code, array_get(&next->code, i));
+    }
+
+    block->expr = next->expr;
+    block->expect = next->expect;
+    block->has_return_value = next->has_return_value;
+    block->jump[0] = next->jump[0];
+    block->jump[1] = next->jump[1];
+    block->indirect = next->indirect;
+    for (i = 0; i < array_len(&next->targets); ++i) {
+        array_push_back(&block->targets, array_get(&next->targets, i));
+    }
+
+    array_empty(&next->code);
+    array_empty(&next->targets);
+    next->jump[0] = next->jump[1] = NULL;
+    next->has_return_value = 0;
+    next->indirect = 0;
+}
+
+static int simplify_block(struct block *block)
+{
+    int n = 0;
+    struct block *next;
+
+    n += fold_branch(block);
+    if (block->jump[0]) {
+        n += thread_jump(block, 0);
+        if (block->jump[1]) {
+            n += thread_jump(block, 1);
+            n += fold_branch(block);
+        }
+    }
+
+    while (block->jump[0] && !block->jump[1]) {
+        next = block->jump[0];
+        if (next == block || next->predecessors != 1)
+            break;
+
+        merge_successor(block);
+        n += 1;
+    }
+
+    return n;
+}
+
+/*
+ * Clear contents of blocks which can no longer be reached, making sure
+ * nothing is left referencing symbols or other blocks.
+ */
+static void clear_unreachable(struct definition *def)
+{
+    int i;
+    struct block *block;
+
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        block = array_get(&def->nodes, i);
+        if (block->color == WHITE) {
+            array_empty(&block->code);
+            array_empty(&block->targets);
+            block->jump[0] = block->jump[1] = NULL;
+            block->has_return_value = 0;
+            block->indirect = 0;
+        }
+    }
+}
+
+/*
+ * Limit number of iterations, as threading jumps through a cycle of
+ * empty blocks could otherwise go on forever.
+ */
+#define MAX_SIMPLIFY_ITERATIONS 16
+
+INTERNAL int simplify_cfg(struct definition *def)
+{
+    int i, n, changes, iterations;
+    struct block *block;
+
+    changes = 0;
+    iterations = 0;
+    do {
+        n = 0;
+        compute_reachable(def);
+        color_reachable_white();
+        for (i = 0; i < array_len(&reachable); ++i) {
+            block = array_get(&reachable, i);
+            n += simplify_block(block);
+        }
+
+        changes += n;
+    } while (n && ++iterations < MAX_SIMPLIFY_ITERATIONS);
+
+    compute_reachable(def);
+    clear_unreachable(def);
+    color_reachable_white();
+    array_clear(&reachable);
+    return changes;
+}
+
+static int is_same_expression(struct expression a, struct expression b)
+{
+    return a.op == b.op
+        && type_equal(a.type, b.type)
+        && is_same_operand(a.l, b.l)
+        && (a.op < IR_OP_ADD || is_same_operand(a.r, b.r));
+}
+
+static int is_same_statement(
+    const struct definition *def,
+    struct statement a,
+    struct statement b)
+{
+    if (a.st != b.st || !is_same_expression(a.expr, b.expr))
+        return 0;
+
+    switch (a.st) {
+    case IR_CMOV:
+        if (!is_same_operand(
+                array_get(&def->sources, a.source),
+                array_get(&def->sources, b.source)))
+            return 0;
+        /* Fallthrough. */
+    case IR_ASSIGN:
+    case IR_VLA_ALLOC:
+    case IR_PREFETCH:
+        return is_same_operand(a.t, b.t);
+    default:
+        return 1;
+    }
+}
+
+/*
+ * Determine if two blocks have the same code and successors, meaning
+ * one can replace the other.
+ */
+static int is_same_block(
+    const struct definition *def,
+    const struct block *a,
+    const struct block *b)
+{
+    int i;
+
+    if (a->jump[0] != b->jump[0]
+        || a->jump[1] != b->jump[1]
+        || a->has_return_value != b->has_return_value
+        || a->indirect != b->indirect
+        || array_len(&a->code) != array_len(&b->code))
+        return 0;
+
+    if ((a->jump[1] || a->has_return_value || a->indirect)
+        && !is_same_expression(a->expr, b->expr))
+        return 0;
+
+    for (i = 0; i < array_len(&a->code); ++i) {
+        if (!is_same_statement(
+                def,
+                array_get(&a->code, i),
+                array_get(&b->code, i)))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Find a block placed before position i in depth first order, which is
+ * identical to the block at that position.
+ */
+static struct block *find_identical_block(struct definition *def, int i)
+{
+    int j;
+    struct block *block, *other;
+
+    block = array_get(&reachable, i);
+    for (j = 0; j < i; ++j) {
+        other = array_get(&reachable, j);
+        if (other != def->body
+            && other->predecessors
+            && is_same_block(def, block, other))
+            return other;
+    }
+
+    return NULL;
+}
+
+/*
+ * Redirect all edges to blocks identical to an earlier block, leaving
+ * the duplicates unreachable.
+ */
+static int merge_identical_blocks(struct definition *def)
+{
+    int i, j, k, n;
+    struct block *block, *other, *pred;
+
+    n = 0;
+    for (i = 1; i < array_len(&reachable); ++i) {
+        block = array_get(&reachable, i);
+        if (block == def->body || !block->predecessors)
+            continue;
+
+        other = find_identical_block(def, i);
+        if (!other)
+            continue;
+
+        for (j = 0; j < array_len(&reachable); ++j) {
+            pred = array_get(&reachable, j);
+            for (k = 0; k < 2; ++k) {
+                if (pred->jump[k] == block) {
+                    pred->jump[k] = other;
+                    other->predecessors++;
+                }
+            }
+        }
+
+        block->predecessors = 0;
+        n += 1;
+    }
+
+    return n;
+}
+
+/*
+ * Statements which can be moved to a successor block. Parameters must
+ * stay in the same block as the call they belong to.
+ */
+static int is_sinkable(struct statement st)
+{
+    return (st.st == IR_ASSIGN || st.st == IR_EXPR)
+        && st.expr.op != IR_OP_CALL;
+}
+
+static void prepend_statement(struct block *block, struct statement st)
+{
+    int i;
+
+    array_push_back(&block->code, st);
+    for (i = array_len(&block->code) - 1; i > 0; --i) {
+        array_get(&block->code, i) = array_get(&block->code, i - 1);
+    }
+
+    array_get(&block->code, 0) = st;
+}
+
+/*
+ * Move the same trailing statement of all predecessors into the start
+ * of block, when every predecessor jumps there unconditionally.
+ */
+static int sink_common_tail(struct definition *def, struct block *block)
+{
+    int i, n, count;
+    struct block *pred, *first;
+    struct statement st;
+
+    if (block == def->body || block->predecessors < 2)
+        return 0;
+
+    n = 0;
+    while (1) {
+        count = 0;
+        first = NULL;
+        for (i = 0; i < array_len(&reachable); ++i) {
+            pred = array_get(&reachable, i);
+            if (pred->jump[0] != block && pred->jump[1] != block)
+                continue;
+
+            if (pred->jump[1] || pred == block || !array_len(&pred->code))
+                return n;
+
+            st = array_back(&pred->code);
+            if (!first) {
+                if (!is_sinkable(st))
+                    return n;
+                first = pred;
+            } else if (!is_same_statement(def, st, array_back(&first->code))) {
+                return n;
+            }
+
+            count++;
+        }
+
+        if (count != block->predecessors)
+            return n;
+
+        st = array_back(&first->code);
+        for (i = 0; i < array_len(&reachable); ++i) {
+            pred = array_get(&reachable, i);
+            if (pred->jump[0] == block) {
+                (void) array_pop_back(&pred->code);
+            }
+        }
+
+        prepend_statement(block, st);
+        n += 1;
+    }
+}
+
+INTERNAL int merge_tails(struct definition *def)
+{
+    int i, changes;
+
+    compute_reachable(def);
+    changes = merge_identical_blocks(def);
+    if (changes) {
+        color_reachable_white();
+        compute_reachable(def);
+    }
+
+    for (i = 0; i < array_len(&reachable); ++i) {
+        changes += sink_common_tail(def, array_get(&reachable, i));
+    }
+
+    color_reachable_white();
+    compute_reachable(def);
+    clear_unreachable(def);
+    color_reachable_white();
+    array_clear(&reachable);
+    return changes;
+}
@@ -0,0 +1,39 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <lacc/ir.h>
+
+/*
+ * Simplify control flow graph of a function definition.
+ *
+ *  - Branches on immediate values, or to the same block on both edges,
+ *    become unconditional jumps.
+ *  - Jumps to an empty block re-testing a condition with known outcome
+ *    are threaded directly to the destination.
+ *  - A block with a single successor is merged with that successor if
+ *    it is the only predecessor.
+ *
+ * Blocks which are no longer reachable from the entry point are
+ * cleared. Return number of changes made to the graph.
+ */
+INTERNAL int simplify_cfg(struct definition *def);
+
+/*
+ * Count number of incoming edges to each block reachable from function
+ * entry. Unreachable blocks get no predecessors.
+ */
+INTERNAL void count_predecessors(struct definition *def);
+
+/*
+ * Merge identical code at the end of different paths.
+ *
+ *  - Blocks with the same code and successors are replaced by a single
+ *    copy.
+ *  - Identical trailing statements of all predecessors jumping
+ *    unconditionally to the same block are moved into that block.
+ *
+ * Return number of changes made.
+ */
+INTERNAL int merge_tails(struct definition *def);
+
+#endif
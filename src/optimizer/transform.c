@@ -48,7 +48,7 @@ static int can_merge(
 
 INTERNAL int merge_chained_assignment(struct block *block)
 {
-    int i = 1;
+    int i = 1, c = 0;
     struct statement s1, s2;
 
     if (array_len(&block->code) > 1) {
@@ -57,9 +57,11 @@ INTERNAL int merge_chained_assignment(struct block *block)
             s2 = array_get(&block->code, i);
             if (can_merge(block, s1, s2)) {
                 s1.t = s2.t;
+                s1.out = s2.out;
                 array_get(&block->code, i - 1) = s1;
                 array_erase(&block->code, i);
                 s1 = array_get(&block->code, i - 1);
+                c += 1;
             } else {
                 s1 = array_get(&block->code, i);
                 i += 1;
@@ -67,7 +69,7 @@ INTERNAL int merge_chained_assignment(struct block *block)
         }
     }
 
-    return 0;
+    return c;
 }
 
 INTERNAL int dead_store_elimination(struct block *block)
@@ -82,15 +84,104 @@ INTERNAL int dead_store_elimination(struct block *block)
             && !is_live_after(st->t.symbol, st)
             && st->t.symbol->linkage == LINK_NONE)
         {
-            c += 1;
             if (has_side_effects(st->expr)) {
+                /*
+                 * Aggregate return values can be written to memory
+                 * provided by caller, which must still be valid.
+                 */
+                if (!is_scalar(st->t.type))
+                    continue;
+                c += 1;
                 st->st = IR_EXPR;
             } else {
+                c += 1;
                 array_erase(&block->code, i);
                 i -= 1;
             }
+        } else if (st->st == IR_CMOV
+            && !is_live_after(st->t.symbol, st)
+            && st->t.symbol->linkage == LINK_NONE)
+        {
+            c += 1;
+            array_erase(&block->code, i);
+            i -= 1;
         }
     }
 
     return c;
 }
+
+static int is_branch_operand(struct var var, const struct symbol *sym)
+{
+    return var.kind == DIRECT
+        && var.symbol == sym
+        && !var.offset
+        && !is_field(var);
+}
+
+/*
+ * Determine which branch is taken in block, given that sym holds the
+ * immediate value imm. Return -1 if the outcome is not known.
+ */
+static int branch_outcome(
+    const struct block *block,
+    const struct symbol *sym,
+    struct var imm)
+{
+    struct var other;
+    struct expression expr;
+
+    expr = block->expr;
+    if (is_identity(expr) && is_branch_operand(expr.l, sym)) {
+        return imm.imm.u != 0;
+    }
+
+    if (expr.op == IR_OP_EQ || expr.op == IR_OP_NE) {
+        if (is_branch_operand(expr.l, sym)) {
+            other = expr.r;
+        } else if (is_branch_operand(expr.r, sym)) {
+            other = expr.l;
+        } else {
+            return -1;
+        }
+
+        if (other.kind == IMMEDIATE
+            && !other.symbol
+            && type_equal(other.type, imm.type))
+        {
+            return (other.imm.u == imm.imm.u) == (expr.op == IR_OP_EQ);
+        }
+    }
+
+    return -1;
+}
+
+INTERNAL int thread_boolean_branch(struct block *block)
+{
+    int taken;
+    struct block *next;
+    struct statement *st;
+
+    if (array_len(&block->code) != 1 || !block->jump[0] || block->jump[1])
+        return 0;
+
+    st = &array_get(&block->code, 0);
+    next = block->jump[0];
+    if (array_len(&next->code)
+        || !next->jump[1]
+        || st->st != IR_ASSIGN
+        || !is_branch_operand(st->t, st->t.symbol)
+        || st->t.symbol->linkage != LINK_NONE
+        || !is_integer(st->t.type)
+        || !is_immediate(st->expr)
+        || !type_equal(st->t.type, st->expr.type))
+        return 0;
+
+    taken = branch_outcome(next, st->t.symbol, st->expr.l);
+    if (taken < 0 || is_live_out(st->t.symbol, next))
+        return 0;
+
+    block->jump[0] = next->jump[taken];
+    array_erase(&block->code, 0);
+    return 1;
+}
@@ -24,4 +24,19 @@ INTERNAL int merge_chained_assignment(struct block *block);
  */
 INTERNAL int dead_store_elimination(struct block *block);
 
+/*
+ * Thread jumps through branches that only test a value assigned in the
+ * preceding block. This is the pattern left by short circuit logical
+ * expressions used as branch conditions:
+ *
+ *   t: .t1 = 1          f: .t1 = 0
+ *      jmp r               jmp r
+ *
+ *   r: if .t1 goto x else y
+ *
+ * If .t1 is not live after r, t can jump directly to x, and f to y,
+ * removing the assignments. Predecessor counts are not updated.
+ */
+INTERNAL int thread_boolean_branch(struct block *block);
+
 #endif
@@ -14,6 +14,7 @@
 #include <lacc/token.h>
 
 #include <assert.h>
+#include <string.h>
 
 static const Type *get_typedef(String str)
 {
@@ -83,7 +84,7 @@ static struct block *parameter_list(
     while (peek().token != ')') {
         name.len = 0;
         length = 0;
-        base = declaration_specifiers(NULL, NULL);
+        base = declaration_specifiers(NULL, NULL, NULL);
         block = parameter_declarator(def, block, base, &base, &name, &length);
         if (is_void(base)) {
             if (nmembers(*func)) {
@@ -296,9 +297,9 @@ static struct block *array_declarator(
     if (static_length) {
         *static_length = length;
         *type = type_create_pointer(base);
-        if (cvrs.is_const) type_set_const(*type);
-        if (cvrs.is_volatile) type_set_volatile(*type);
-        if (cvrs.is_restrict) type_set_restrict(*type);
+        if (cvrs.is_const) *type = type_set_const(*type);
+        if (cvrs.is_volatile) *type = type_set_volatile(*type);
+        if (cvrs.is_restrict) *type = type_set_restrict(*type);
     } else if (is_incomplete) {
         *type = type_create_incomplete(base);
     } else if (sym) {
@@ -430,6 +431,152 @@ INTERNAL struct block *declarator(
     return parameter_declarator(def, block, base, type, name, NULL);
 }
 
+/*
+ * Attribute names can be given with or without surrounding double
+ * underscores, for example both visibility and __visibility__.
+ */
+static int is_attribute(String name, const char *str)
+{
+    size_t len;
+    const char *raw;
+
+    raw = str_raw(name);
+    len = strlen(str);
+    if (name.len == len + 4 && !strncmp(raw, "__", 2)) {
+        raw += 2;
+        if (strncmp(raw + len, "__", 2))
+            return 0;
+    } else if (name.len != len) {
+        return 0;
+    }
+
+    return !strncmp(raw, str, len);
+}
+
+/*
+ * Attributes that only give hints for optimization or diagnostics, and
+ * can be ignored without warning. These are common in system headers.
+ */
+static int is_hint_attribute(String name)
+{
+    static const char *const hints[] = {
+        "noinline", "noreturn", "const", "pure", "format", "format_arg",
+        "nonnull", "nothrow", "leaf", "malloc", "warn_unused_result",
+        "unused", "used", "deprecated", "sentinel", "returns_twice"
+    };
+    size_t i;
+
+    for (i = 0; i < sizeof(hints) / sizeof(hints[0]); ++i) {
+        if (is_attribute(name, hints[i]))
+            return 1;
+    }
+
+    return 0;
+}
+
+static enum visibility visibility_attribute(void)
+{
+    String str;
+    enum visibility visibility;
+
+    consume('(');
+    str = consume(STRING).d.string;
+    if (!strcmp(str_raw(str), "default")) {
+        visibility = VISIBILITY_DEFAULT;
+    } else if (!strcmp(str_raw(str), "hidden")) {
+        visibility = VISIBILITY_HIDDEN;
+    } else if (!strcmp(str_raw(str), "internal")) {
+        visibility = VISIBILITY_INTERNAL;
+    } else if (!strcmp(str_raw(str), "protected")) {
+        visibility = VISIBILITY_PROTECTED;
+    } else {
+        error("Invalid visibility '%s'.", str_raw(str));
+        exit(1);
+    }
+
+    consume(')');
+    return visibility;
+}
+
+/* Skip balanced parentheses of unsupported attribute arguments. */
+static void skip_attribute_arguments(void)
+{
+    int depth;
+
+    consume('(');
+    for (depth = 1; depth; next()) {
+        switch (peek().token) {
+        case '(':
+            depth++;
+            break;
+        case ')':
+            depth--;
+            break;
+        case END:
+            error("Unexpected end of input in attribute.");
+            exit(1);
+        default:
+            break;
+        }
+    }
+}
+
+/*
+ * Parse __attribute__((a, b(...), ...)), storing recognized attributes
+ * in attr. Unsupported attributes are ignored with a warning. If attr
+ * is NULL, the attributes do not apply to any declared symbol.
+ */
+static void attribute_specifier(struct attributes *attr)
+{
+    struct token t;
+
+    consume(ATTRIBUTE);
+    consume('(');
+    consume('(');
+    while (peek().token != ')') {
+        t = next();
+        if (t.token != IDENTIFIER && !t.is_expandable) {
+            error("Unexpected '%s' in attribute list.", str_raw(t.d.string));
+            exit(1);
+        }
+
+        if (is_attribute(t.d.string, "visibility")) {
+            if (attr) {
+                attr->visibility = visibility_attribute();
+            } else {
+                (void) visibility_attribute();
+            }
+        } else if (is_attribute(t.d.string, "hot")) {
+            if (attr) {
+                attr->hot = 1;
+                attr->cold = 0;
+            }
+        } else if (is_attribute(t.d.string, "cold")) {
+            if (attr) {
+                attr->cold = 1;
+                attr->hot = 0;
+            }
+        } else if (is_hint_attribute(t.d.string)) {
+            if (peek().token == '(') {
+                skip_attribute_arguments();
+            }
+        } else {
+            warning("Ignoring unsupported attribute '%s'.",
+                str_raw(t.d.string));
+            if (peek().token == '(') {
+                skip_attribute_arguments();
+            }
+        }
+
+        if (peek().token != ',')
+            break;
+        consume(',');
+    }
+
+    consume(')');
+    consume(')');
+}
+
 static void member_declaration_list(Type type)
 {
     String name;
@@ -437,10 +584,13 @@ static void member_declaration_list(Type type)
     Type decl_base, decl_type;
 
     do {
-        decl_base = declaration_specifiers(NULL, NULL);
+        decl_base = declaration_specifiers(NULL, NULL, NULL);
         do {
             name.len = 0;
             declarator(NULL, NULL, decl_base, &decl_type, &name);
+            while (peek().token == ATTRIBUTE) {
+                attribute_specifier(NULL);
+            }
             if (is_struct_or_union(type) && peek().token == ':') {
                 if (!is_integer(decl_type)) {
                     error("Unsupported type '%t' for bit-field.", decl_type);
@@ -486,6 +636,10 @@ static Type struct_or_union_declaration(void)
     enum type kind;
 
     kind = (next().token == STRUCT) ? T_STRUCT : T_UNION;
+    while (peek().token == ATTRIBUTE) {
+        attribute_specifier(NULL);
+    }
+
     if (peek().token == IDENTIFIER) {
         name = consume(IDENTIFIER).d.string;
         sym = sym_lookup(&ns_tag, name);
@@ -605,8 +759,13 @@ static void enum_declaration(void)
  *
  * Use a compact bit representation to hold state about declaration 
  * specifiers. Initialize storage class to sentinel value.
+ *
+ * Attributes are collected in attr, or ignored if attr is NULL.
  */
-INTERNAL Type declaration_specifiers(int *storage_class, int *is_inline)
+INTERNAL Type declaration_specifiers(
+    int *storage_class,
+    int *is_inline,
+    struct attributes *attr)
 {
     Type type = {-1}, other;
     const Type *tagged;
@@ -620,6 +779,10 @@ INTERNAL Type declaration_specifiers(int *storage_class, int *is_inline)
         *is_inline = 0;
     }
 
+    if (attr) {
+        memset(attr, 0, sizeof(*attr));
+    }
+
     while (1) {
         switch ((tok = peek()).token) {
         case VOID:
@@ -718,6 +881,9 @@ INTERNAL Type declaration_specifiers(int *storage_class, int *is_inline)
                 *is_inline = 1;
             }
             break;
+        case ATTRIBUTE:
+            attribute_specifier(attr);
+            break;
         case AUTO:
         case REGISTER:
         case STATIC:
@@ -834,6 +1000,28 @@ static struct block *declare_vla(
     return block;
 }
 
+static void apply_attributes(struct symbol *sym, struct attributes attr)
+{
+    if (attr.visibility != VISIBILITY_UNSPECIFIED) {
+        if (sym->linkage != LINK_EXTERN) {
+            warning("Ignoring visibility of '%s' without external linkage.",
+                str_raw(sym->name));
+        } else {
+            sym->visibility = attr.visibility;
+        }
+    }
+
+    if (attr.hot || attr.cold) {
+        if (!is_function(sym->type)) {
+            warning("Ignoring %s attribute on '%s', which is not a function.",
+                attr.hot ? "hot" : "cold", str_raw(sym->name));
+        } else {
+            sym->hot = attr.hot;
+            sym->cold = attr.cold;
+        }
+    }
+}
+
 /*
  * Parse declaration, possibly with initializer. New symbols are added
  * to the symbol table.
@@ -846,7 +1034,8 @@ INTERNAL struct block *init_declarator(
     struct block *parent,
     Type base,
     enum symtype symtype,
-    enum linkage linkage)
+    enum linkage linkage,
+    struct attributes attr)
 {
     Type type;
     String name = {0};
@@ -859,6 +1048,10 @@ INTERNAL struct block *init_declarator(
         parent = declarator(def, parent, base, &type, &name);
     }
 
+    while (peek().token == ATTRIBUTE) {
+        attribute_specifier(&attr);
+    }
+
     if (!name.len) {
         return parent;
     }
@@ -885,6 +1078,7 @@ INTERNAL struct block *init_declarator(
     }
 
     sym = sym_add(&ns_ident, name, type, symtype, linkage);
+    apply_attributes(sym, attr);
     switch (current_scope_depth(&ns_ident)) {
     case 0: break;
     case 1: /* Parameters from old-style function definitions. */
@@ -949,7 +1143,8 @@ INTERNAL struct block *init_declarator(
             if (context.standard >= STD_C99) {
                 define_builtin__func__(sym->name);
             }
-            parent = block(def, parent);
+            parent = function_body(def, parent);
+            annotate_expected_branches();
             pop_scope(&ns_label);
             pop_scope(&ns_ident);
             return parent;
@@ -1011,6 +1206,7 @@ INTERNAL struct block *declaration(
     enum symtype symtype;
     enum linkage linkage;
     struct definition *decl;
+    struct attributes attr;
     int storage_class, is_inline;
 
     if (peek().token == STATIC_ASSERT) {
@@ -1019,7 +1215,7 @@ INTERNAL struct block *declaration(
         return parent;
     }
 
-    base = declaration_specifiers(&storage_class, &is_inline);
+    base = declaration_specifiers(&storage_class, &is_inline, &attr);
     switch (storage_class) {
     case EXTERN:
         symtype = SYM_DECLARATION;
@@ -1047,14 +1243,15 @@ INTERNAL struct block *declaration(
     while (1) {
         if (linkage == LINK_INTERN || linkage == LINK_EXTERN) {
             decl = cfg_init();
-            init_declarator(decl, decl->body, base, symtype, linkage);
+            init_declarator(decl, decl->body, base, symtype, linkage, attr);
             if (!decl->symbol) {
                 cfg_discard(decl);
             } else if (is_function(decl->symbol->type)) {
                 return parent;
             }
         } else {
-            parent = init_declarator(def, parent, base, symtype, linkage);
+            parent = init_declarator(
+                def, parent, base, symtype, linkage, attr);
         }
 
         if (peek().token == ',') {
@@ -20,7 +20,20 @@ INTERNAL struct block *declarator(
     Type *type,
     String *name);
 
-INTERNAL Type declaration_specifiers(int *storage_class, int *is_inline);
+/*
+ * Attributes given with __attribute__((...)) in declaration specifiers
+ * or after a declarator, applied to the symbol declared.
+ */
+struct attributes {
+    enum visibility visibility;
+    unsigned int hot : 1;
+    unsigned int cold : 1;
+};
+
+INTERNAL Type declaration_specifiers(
+    int *storage_class,
+    int *is_inline,
+    struct attributes *attr);
 
 #define FIRST_type_qualifier \
     CONST: case VOLATILE
@@ -227,6 +227,19 @@ static struct expression create_expr(enum optype op, struct var l, ...)
     case IR_OP_NEG:
         expr.type = l.type;
         break;
+    case IR_OP_POPCNT:
+    case IR_OP_CLZ:
+    case IR_OP_CTZ:
+    case IR_OP_FFS:
+        assert(is_integer(l.type));
+        assert(size_of(l.type) == 4 || size_of(l.type) == 8);
+        expr.type = basic_type__int;
+        break;
+    case IR_OP_BSWAP:
+        assert(is_unsigned(l.type));
+        assert(size_of(l.type) == 4 || size_of(l.type) == 8);
+        expr.type = l.type;
+        break;
     case IR_OP_ADD:
     case IR_OP_SUB:
     case IR_OP_MUL:
@@ -276,12 +289,16 @@ static void emit_ir(struct block *block, enum sttype st, ...)
         switch (st) {
         case IR_ASSIGN:
         case IR_VLA_ALLOC:
+        case IR_PREFETCH:
             stmt.t = va_arg(args, struct var);
         case IR_EXPR:
         case IR_PARAM:
         case IR_VA_START:
             stmt.expr = va_arg(args, struct expression);
             break;
+        case IR_CMOV:
+            assert(0);
+            break;
         }
 
         array_push_back(&block->code, stmt);
@@ -484,6 +501,101 @@ static struct var eval_cast(
         eval_expr(def, block, IR_OP_CAST, var, type));
 }
 
+/*
+ * With -fassociative-math, fold constant operand of floating point
+ * addition or multiplication into the operation computing l, if it is
+ * a temporary just assigned from (x op c). The assignment is removed,
+ * leaving x op (c op r).
+ */
+static void reassociate(
+    struct block *block,
+    enum optype op,
+    struct var *l,
+    struct var *r)
+{
+    struct var tmp;
+    struct statement *st;
+
+    assert(op == IR_OP_ADD || op == IR_OP_MUL);
+    if (!context.associative_math || !block || !is_real(l->type))
+        return;
+
+    if (l->kind == IMMEDIATE && r->kind != IMMEDIATE) {
+        tmp = *l;
+        *l = *r;
+        *r = tmp;
+    }
+
+    if (r->kind != IMMEDIATE
+        || l->kind != DIRECT
+        || l->offset
+        || !is_temporary(l->symbol)
+        || !array_len(&block->code))
+        return;
+
+    st = &array_back(&block->code);
+    if (st->st != IR_ASSIGN
+        || st->t.kind != DIRECT
+        || st->t.symbol != l->symbol
+        || st->expr.op != op
+        || st->expr.r.kind != IMMEDIATE
+        || !type_equal(st->expr.type, l->type))
+        return;
+
+    *l = st->expr.l;
+    *r = (op == IR_OP_ADD)
+        ? eval_arithmetic_immediate(l->type, st->expr.r, +, *r)
+        : eval_arithmetic_immediate(l->type, st->expr.r, *, *r);
+    (void) array_pop_back(&block->code);
+}
+
+/*
+ * Determine if division by floating point constant can be replaced by
+ * multiplication with its reciprocal. This is exact for powers of two
+ * with reciprocal also in normal range, otherwise requires
+ * -freciprocal-math.
+ */
+static int has_reciprocal(struct var r)
+{
+    unsigned long bits, exp;
+
+    assert(r.kind == IMMEDIATE);
+    assert(is_real(r.type));
+    if (is_zero_value(r.imm, r.type))
+        return 0;
+
+    if (context.reciprocal_math)
+        return 1;
+
+    if (is_float(r.type)) {
+        bits = r.imm.u & 0xFFFFFFFFu;
+        exp = (bits >> 23) & 0xFF;
+        return !(bits & 0x7FFFFF) && exp >= 1 && exp <= 253;
+    }
+
+    if (is_double(r.type)) {
+        bits = r.imm.u;
+        exp = (bits >> 52) & 0x7FF;
+        return !(bits & 0xFFFFFFFFFFFFFul) && exp >= 1 && exp <= 2045;
+    }
+
+    return 0;
+}
+
+static struct var imm_reciprocal(struct var r)
+{
+    return is_float(r.type) ? imm_float(1.0f / r.imm.f)
+        : is_double(r.type) ? imm_double(1.0 / r.imm.d)
+        : imm_long_double(1.0L / r.imm.ld);
+}
+
+static struct var imm_negate(struct var r)
+{
+    return is_float(r.type) ? imm_float(-r.imm.f)
+        : is_double(r.type) ? imm_double(-r.imm.d)
+        : imm_long_double(-r.imm.ld);
+}
+
 static struct expression mul(
     struct definition *def,
     struct block *block,
@@ -500,6 +612,7 @@ static struct expression mul(
         l = eval_arithmetic_immediate(type, l, *, r);
         expr = cast(l, type);
     } else {
+        reassociate(block, IR_OP_MUL, &l, &r);
         expr = create_expr(IR_OP_MUL, l, r);
     }
 
@@ -521,6 +634,8 @@ static struct expression ediv(
     if (l.kind == IMMEDIATE && r.kind == IMMEDIATE) {
         l = eval_arithmetic_immediate(type, l, /, r);
         expr = cast(l, type);
+    } else if (is_real(type) && r.kind == IMMEDIATE && has_reciprocal(r)) {
+        expr = mul(def, block, l, imm_reciprocal(r));
     } else {
         expr = create_expr(IR_OP_DIV, l, r);
     }
@@ -584,6 +699,7 @@ static struct expression add(
             l = eval_arithmetic_immediate(type, l, +, r);
             expr = cast(l, type);
         } else {
+            reassociate(block, IR_OP_ADD, &l, &r);
             expr = create_expr(IR_OP_ADD, l, r);
         }
     } else if (is_pointer(l.type) && is_integer(r.type)) {
@@ -655,6 +771,11 @@ static struct expression sub(
         if (l.kind == IMMEDIATE && r.kind == IMMEDIATE) {
             l = eval_arithmetic_immediate(type, l, -, r);
             expr = cast(l, type);
+        } else if (is_real(type)
+            && r.kind == IMMEDIATE
+            && context.associative_math)
+        {
+            expr = add(def, block, l, imm_negate(r));
         } else {
             expr = create_expr(IR_OP_SUB, l, r);
         }
@@ -1055,6 +1176,56 @@ static struct expression neg(
     return expr;
 }
 
+/*
+ * Evaluate builtin bit operation on 32 or 64 bit integer. Results for
+ * clz and ctz are undefined for zero input, fold to the bit width in
+ * that case.
+ */
+static struct expression bit_operation(enum optype op, struct var var)
+{
+    int n, w;
+    unsigned long u, r;
+
+    w = size_of(var.type) * 8;
+    if (var.kind != IMMEDIATE || var.symbol) {
+        return create_expr(op, var);
+    }
+
+    u = var.imm.u;
+    if (w == 32) {
+        u &= 0xFFFFFFFFul;
+    }
+
+    switch (op) {
+    default: assert(0);
+    case IR_OP_POPCNT:
+        for (n = 0; u; u &= u - 1)
+            n++;
+        break;
+    case IR_OP_CLZ:
+        for (n = w; u; u >>= 1)
+            n--;
+        break;
+    case IR_OP_CTZ:
+    case IR_OP_FFS:
+        if (!u) {
+            n = (op == IR_OP_CTZ) ? w : 0;
+        } else {
+            for (n = 0; !(u & 1); u >>= 1)
+                n++;
+            n += (op == IR_OP_FFS);
+        }
+        break;
+    case IR_OP_BSWAP:
+        for (r = 0, n = 0; n < w; n += 8) {
+            r = (r << 8) | ((u >> n) & 0xFF);
+        }
+        return as_expr(imm_unsigned(var.type, r));
+    }
+
+    return as_expr(var_int(n));
+}
+
 static struct expression call(struct var var)
 {
     if (!is_pointer(var.type) || !is_function(type_next(var.type))) {
@@ -1149,6 +1320,11 @@ INTERNAL struct expression eval_expr(
         break;
     case IR_OP_NOT:
     case IR_OP_NEG:
+    case IR_OP_POPCNT:
+    case IR_OP_CLZ:
+    case IR_OP_CTZ:
+    case IR_OP_FFS:
+    case IR_OP_BSWAP:
     case IR_OP_CALL:
         break;
     default:
@@ -1165,6 +1341,11 @@ INTERNAL struct expression eval_expr(
     case IR_OP_VA_ARG: return eval_va_arg(l, type);
     case IR_OP_NOT:    return not(def, block, l);
     case IR_OP_NEG:    return neg(def, block, l);
+    case IR_OP_POPCNT:
+    case IR_OP_CLZ:
+    case IR_OP_CTZ:
+    case IR_OP_FFS:
+    case IR_OP_BSWAP:  return bit_operation(optype, l);
     case IR_OP_MOD:    return mod(def, block, l, r);
     case IR_OP_MUL:    return mul(def, block, l, r);
     case IR_OP_DIV:    return ediv(def, block, l, r);
@@ -1498,6 +1679,18 @@ static struct var eval_assign_pointer(
 
     if (is_identity(expr)) {
         expr.l.type = target.type;
+        /*
+         * Const pointers are only assigned when initialized, and keep
+         * alignment assumed for the initial value.
+         */
+        if (target.kind == DIRECT
+            && expr.l.kind == DIRECT
+            && target.symbol->linkage == LINK_NONE
+            && is_const(target.symbol->type))
+        {
+            ((struct symbol *) target.symbol)->assume_aligned =
+                expr.l.symbol->assume_aligned;
+        }
     }
 
     expr.type = target.type;
@@ -1631,6 +1824,27 @@ INTERNAL struct expression eval_return(
     return block->expr;
 }
 
+INTERNAL struct expression eval_computed_goto(
+    struct definition *def,
+    struct block *block)
+{
+    struct var val;
+
+    if (is_identity(block->expr)) {
+        val = rvalue(def, block, block->expr.l);
+        block->expr = as_expr(val);
+    }
+
+    if (!is_pointer(block->expr.type)) {
+        error("Computed goto requires pointer operand, was %t.",
+            block->expr.type);
+        exit(1);
+    }
+
+    block->indirect = 1;
+    return block->expr;
+}
+
 INTERNAL Type eval_conditional(
     struct definition *def,
     struct block *left,
@@ -1885,3 +2099,65 @@ INTERNAL void eval__builtin_va_start(
 {
     emit_ir(block, IR_VA_START, arg);
 }
+
+INTERNAL void eval__builtin_prefetch(
+    struct definition *def,
+    struct block *block,
+    struct var addr,
+    int rw,
+    int locality)
+{
+    addr = rvalue(def, block, addr);
+    if (!is_pointer(addr.type)) {
+        error("Expected pointer argument to __builtin_prefetch.");
+        exit(1);
+    }
+
+    emit_ir(block, IR_PREFETCH, var_int(rw << 2 | locality), as_expr(addr));
+}
+
+INTERNAL struct var eval__builtin_assume_aligned(
+    struct definition *def,
+    struct block *block,
+    struct var ptr,
+    long align,
+    long offset)
+{
+    int n;
+    struct var res;
+    Type type;
+
+    ptr = rvalue(def, block, ptr);
+    if (!is_pointer(ptr.type)) {
+        error("Expected pointer argument to __builtin_assume_aligned.");
+        exit(1);
+    }
+
+    if (align <= 0 || (align & (align - 1))) {
+        error("Alignment must be a positive power of two.");
+        exit(1);
+    }
+
+    type = type_create_pointer(basic_type__void);
+    if (!def) {
+        return eval(def, block, cast(ptr, type));
+    }
+
+    /*
+     * Pointer minus offset is aligned, meaning the pointer itself is
+     * only aligned to the lowest bit set in offset.
+     */
+    offset &= align - 1;
+    if (offset) {
+        align = offset & -offset;
+    }
+
+    for (n = 0; (1l << n) < align && n < 15; ++n)
+        ;
+
+    res = create_var(def, type);
+    eval_assign(def, block, res, cast(ptr, type));
+    ((struct symbol *) res.symbol)->assume_aligned = n;
+    res.lvalue = 0;
+    return res;
+}
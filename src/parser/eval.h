@@ -89,6 +89,14 @@ INTERNAL struct expression eval_return(
     struct definition *def,
     struct block *block);
 
+/*
+ * Evaluate goto *(expr), jumping to the address given by a pointer,
+ * typically taken from a label with &&label.
+ */
+INTERNAL struct expression eval_computed_goto(
+    struct definition *def,
+    struct block *block);
+
 /*
  * Evaluate (expr) as a separate statement.
  *
@@ -137,6 +145,29 @@ INTERNAL void eval__builtin_va_start(
     struct block *block,
     struct expression arg);
 
+/*
+ * Evaluate prefetch builtin function, with rw and locality given as
+ * integer constants.
+ */
+INTERNAL void eval__builtin_prefetch(
+    struct definition *def,
+    struct block *block,
+    struct var addr,
+    int rw,
+    int locality);
+
+/*
+ * Evaluate assume_aligned builtin function, returning a void pointer
+ * which is assumed to have the given alignment after subtracting
+ * offset.
+ */
+INTERNAL struct var eval__builtin_assume_aligned(
+    struct definition *def,
+    struct block *block,
+    struct var ptr,
+    long align,
+    long offset);
+
 /*
  * Return 1 iff expression evaluates to an immediate non-zero value.
  * Type must be scalar.
@@ -149,8 +180,6 @@ INTERNAL int is_immediate_true(struct expression expr);
  */
 INTERNAL int is_immediate_false(struct expression expr);
 
-/* Create temporary variable. */
-INTERNAL struct var create_var(struct definition *def, Type type);
 
 /* Create an immediate unsigned integer of the given type. */
 INTERNAL struct var imm_unsigned(Type type, unsigned long val);
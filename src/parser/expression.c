@@ -7,12 +7,14 @@
 #include "expression.h"
 #include "initializer.h"
 #include "parse.h"
+#include "statement.h"
 #include "symtab.h"
 #include "typetree.h"
 #include <lacc/context.h>
 #include <lacc/token.h>
 
 #include <assert.h>
+#include <limits.h>
 
 static struct block *cast_expression(
     struct definition *def,
@@ -82,7 +84,7 @@ static struct block *parse__builtin_va_arg(
     block = assignment_expression(def, block);
     value = eval(def, block, block->expr);
     consume(',');
-    type = declaration_specifiers(NULL, NULL);
+    type = declaration_specifiers(NULL, NULL, NULL);
     if (peek().token != ')') {
         block = declarator(def, block, type, &type, NULL);
     }
@@ -92,6 +94,272 @@ static struct block *parse__builtin_va_arg(
     return block;
 }
 
+/*
+ * Parse optional integer constant argument to builtin function, which
+ * must be in the range [0, max].
+ */
+static long builtin_constant_argument(const char *name, long max, long n)
+{
+    struct var c;
+
+    if (peek().token == ',') {
+        consume(',');
+        c = constant_expression();
+        if (!is_integer(c.type) || c.imm.i < 0 || c.imm.i > max) {
+            error("Invalid argument to %s.", name);
+            exit(1);
+        }
+        n = c.imm.i;
+    }
+
+    return n;
+}
+
+/*
+ * Parse call to builtin symbol __builtin_prefetch(addr, rw, locality),
+ * where rw and locality are optional constants defaulting to read and
+ * high temporal locality.
+ */
+static struct block *parse__builtin_prefetch(
+    struct definition *def,
+    struct block *block)
+{
+    int rw, locality;
+    struct var addr;
+
+    consume('(');
+    block = assignment_expression(def, block);
+    addr = eval(def, block, block->expr);
+    rw = builtin_constant_argument("__builtin_prefetch", 1, 0);
+    locality = builtin_constant_argument("__builtin_prefetch", 3, 3);
+    consume(')');
+    eval__builtin_prefetch(def, block, addr, rw, locality);
+    block->expr = as_expr(var_void());
+    return block;
+}
+
+/*
+ * Parse call to builtin symbol __builtin_assume_aligned(ptr, align,
+ * offset), where offset is optional.
+ */
+static struct block *parse__builtin_assume_aligned(
+    struct definition *def,
+    struct block *block)
+{
+    long align, offset;
+    struct var ptr, c;
+
+    consume('(');
+    block = assignment_expression(def, block);
+    ptr = eval(def, block, block->expr);
+    consume(',');
+    c = constant_expression();
+    if (!is_integer(c.type)) {
+        error("Expected integer constant alignment.");
+        exit(1);
+    }
+
+    align = c.imm.i;
+    offset = builtin_constant_argument("__builtin_assume_aligned",
+        LONG_MAX, 0);
+    consume(')');
+    ptr = eval__builtin_assume_aligned(def, block, ptr, align, offset);
+    block->expr = as_expr(ptr);
+    return block;
+}
+
+/*
+ * Values computed by __builtin_expect in the current function, with
+ * the block where it was evaluated.
+ */
+struct expected_value {
+    struct block *block;
+    const struct symbol *sym;
+    long value;
+};
+
+static array_of(struct expected_value) expected_values;
+
+/*
+ * Parse call to builtin symbol __builtin_expect(x, c), evaluating to
+ * x converted to long. The value is expected to be equal to constant c,
+ * which is recorded to annotate a branch on the result.
+ */
+static struct block *parse__builtin_expect(
+    struct definition *def,
+    struct block *block)
+{
+    struct var value, c;
+    struct expected_value ev;
+
+    consume('(');
+    block = assignment_expression(def, block);
+    consume(',');
+    value = eval(def, block, block->expr);
+    if (!is_scalar(value.type)) {
+        error("Expected scalar argument to __builtin_expect.");
+        exit(1);
+    }
+
+    c = constant_expression();
+    if (!is_integer(c.type)) {
+        error("Expected integer constant as __builtin_expect value.");
+        exit(1);
+    }
+
+    consume(')');
+    value = eval(def, block,
+        eval_expr(def, block, IR_OP_CAST, value, basic_type__long));
+    if (def && value.kind == DIRECT) {
+        ev.block = block;
+        ev.sym = value.symbol;
+        ev.value = is_signed(c.type) ? c.imm.i : (long) c.imm.u;
+        array_push_back(&expected_values, ev);
+    }
+
+    block->expr = as_expr(value);
+    return block;
+}
+
+static int is_expected_value(struct var var, const struct symbol *sym)
+{
+    return var.kind == DIRECT && var.symbol == sym && !var.offset;
+}
+
+static int is_constant_value(struct var var)
+{
+    return var.kind == IMMEDIATE && !var.symbol && is_integer(var.type);
+}
+
+/*
+ * Predict outcome of branch on value from __builtin_expect, either
+ * directly or compared for equality with a constant.
+ */
+static enum prediction predict_expected_value(
+    struct expression expr,
+    struct expected_value ev)
+{
+    int taken;
+    struct var c;
+
+    if (is_identity(expr) && is_expected_value(expr.l, ev.sym)) {
+        taken = ev.value != 0;
+    } else if (expr.op == IR_OP_EQ || expr.op == IR_OP_NE) {
+        if (is_expected_value(expr.l, ev.sym) && is_constant_value(expr.r)) {
+            c = expr.r;
+        } else if (is_expected_value(expr.r, ev.sym)
+            && is_constant_value(expr.l))
+        {
+            c = expr.l;
+        } else {
+            return LIKELY_NONE;
+        }
+        taken = (c.imm.i == ev.value) == (expr.op == IR_OP_EQ);
+    } else {
+        return LIKELY_NONE;
+    }
+
+    return taken ? LIKELY_TRUE : LIKELY_FALSE;
+}
+
+INTERNAL void annotate_expected_branches(void)
+{
+    int i;
+    struct block *block;
+    struct expected_value ev;
+
+    for (i = 0; i < array_len(&expected_values); ++i) {
+        ev = array_get(&expected_values, i);
+        block = ev.block;
+        if (block->jump[1]) {
+            block->expect = predict_expected_value(block->expr, ev);
+        }
+    }
+
+    array_clear(&expected_values);
+}
+
+/*
+ * Builtin bit operations, taking a single integer argument of either
+ * 32 or 64 bit width.
+ */
+static const struct builtin_bit_operation {
+    const char *name;
+    enum optype op;
+    int wide;
+} builtin_bit_operations[] = {
+    {"__builtin_popcount", IR_OP_POPCNT, 0},
+    {"__builtin_popcountl", IR_OP_POPCNT, 1},
+    {"__builtin_popcountll", IR_OP_POPCNT, 1},
+    {"__builtin_clz", IR_OP_CLZ, 0},
+    {"__builtin_clzl", IR_OP_CLZ, 1},
+    {"__builtin_clzll", IR_OP_CLZ, 1},
+    {"__builtin_ctz", IR_OP_CTZ, 0},
+    {"__builtin_ctzl", IR_OP_CTZ, 1},
+    {"__builtin_ctzll", IR_OP_CTZ, 1},
+    {"__builtin_ffs", IR_OP_FFS, 0},
+    {"__builtin_ffsl", IR_OP_FFS, 1},
+    {"__builtin_ffsll", IR_OP_FFS, 1},
+    {"__builtin_bswap32", IR_OP_BSWAP, 0},
+    {"__builtin_bswap64", IR_OP_BSWAP, 1}
+};
+
+static const struct builtin_bit_operation *find_bit_operation(String name)
+{
+    int i;
+    const char *str;
+
+    str = str_raw(name);
+    if (strncmp("__builtin_", str, 10)) {
+        return NULL;
+    }
+
+    for (i = 0; i < sizeof(builtin_bit_operations)
+            / sizeof(builtin_bit_operations[0]); ++i)
+    {
+        if (!strcmp(builtin_bit_operations[i].name, str)) {
+            return &builtin_bit_operations[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Parse call to builtin bit operation like __builtin_popcount(x). The
+ * argument is converted to parameter type of the builtin, which is
+ * signed only for ffs.
+ */
+static struct block *parse__builtin_bit_operation(
+    struct definition *def,
+    struct block *block,
+    const struct builtin_bit_operation *bop)
+{
+    Type type;
+    struct var value;
+
+    if (bop->op == IR_OP_FFS) {
+        type = bop->wide ? basic_type__long : basic_type__int;
+    } else {
+        type = bop->wide
+            ? basic_type__unsigned_long
+            : basic_type__unsigned_int;
+    }
+
+    consume('(');
+    block = assignment_expression(def, block);
+    consume(')');
+    value = eval(def, block, block->expr);
+    if (!is_integer(value.type)) {
+        error("Expected integer argument to %s.", bop->name);
+        exit(1);
+    }
+
+    value = eval(def, block, eval_expr(def, block, IR_OP_CAST, value, type));
+    block->expr = eval_expr(def, block, bop->op, value);
+    return block;
+}
+
 /*
  * Special handling for builtin pseudo functions. These are expected to
  * behave as macros, thus should be no problem parsing as function call
@@ -107,6 +375,7 @@ static struct block *primary_expression(
     struct block *block)
 {
     const struct symbol *sym;
+    const struct builtin_bit_operation *bop;
     struct token tok;
 
     switch ((tok = next()).token) {
@@ -116,6 +385,15 @@ static struct block *primary_expression(
             block = parse__builtin_va_start(def, block);
         } else if (!strcmp("__builtin_va_arg", str_raw(sym->name))) {
             block = parse__builtin_va_arg(def, block);
+        } else if (!strcmp("__builtin_expect", str_raw(sym->name))) {
+            block = parse__builtin_expect(def, block);
+        } else if (!strcmp("__builtin_prefetch", str_raw(sym->name))) {
+            block = parse__builtin_prefetch(def, block);
+        } else if (!strcmp("__builtin_assume_aligned", str_raw(sym->name)))
+        {
+            block = parse__builtin_assume_aligned(def, block);
+        } else if ((bop = find_bit_operation(sym->name)) != NULL) {
+            block = parse__builtin_bit_operation(def, block, bop);
         } else {
             block->expr = as_expr(var_direct(sym));
         }
@@ -390,6 +668,7 @@ static struct block *unary_expression(
     struct block *block)
 {
     struct var value;
+    struct token tok;
     struct block *head, *tail;
     const struct symbol *sym;
     Type type;
@@ -407,6 +686,11 @@ static struct block *unary_expression(
         value = eval(def, block, block->expr);
         block->expr = as_expr(eval_deref(def, block, value));
         break;
+    case LOGICAL_AND:
+        consume(LOGICAL_AND);
+        tok = consume(IDENTIFIER);
+        block->expr = as_expr(label_address(tok.d.string));
+        break;
     case '!':
         consume('!');
         block = cast_expression(def, block);
@@ -463,7 +747,7 @@ static struct block *unary_expression(
                     goto exprsize;;
             case FIRST(type_name):
                 consume('(');
-                type = declaration_specifiers(NULL, NULL);
+                type = declaration_specifiers(NULL, NULL, NULL);
                 if (peek().token != ')') {
                     block = declarator(def, block, type, &type, NULL);
                 }
@@ -491,7 +775,7 @@ exprsize:   head = cfg_block_init(def);
     case ALIGNOF:
         next();
         consume('(');
-        type = declaration_specifiers(NULL, NULL);
+        type = declaration_specifiers(NULL, NULL, NULL);
         if (peek().token != ')') {
             block = declarator(def, block, type, &type, NULL);
         }
@@ -575,7 +859,7 @@ static struct block *cast_expression(
                 break;
         case FIRST(type_name):
             next();
-            type = declaration_specifiers(NULL, NULL);
+            type = declaration_specifiers(NULL, NULL, NULL);
             if (peek().token != ')') {
                 block = declarator(def, block, type, &type, NULL);
             }
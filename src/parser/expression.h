@@ -11,6 +11,12 @@ INTERNAL struct block *assignment_expression(
 	struct definition *def,
 	struct block *block);
 
+/*
+ * Set expected outcome of branches on values from __builtin_expect,
+ * once the function body is complete.
+ */
+INTERNAL void annotate_expected_branches(void);
+
 /*
  * Free memory used to hold function arguments.
  *
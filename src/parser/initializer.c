@@ -451,8 +451,16 @@ static struct block *initialize_object(
 
 static const struct var var__immediate_zero = {IMMEDIATE, {T_INT}};
 
+static void zero_initialize_bytes(
+    struct definition *def,
+    struct block *values,
+    struct var target,
+    size_t bytes);
+
 /*
  * Set var = 0, using simple assignment on members for composite types.
+ * Structs and unions are cleared in chunks of up to eight bytes,
+ * regardless of member layout.
  *
  * This rule does not consume any input, but generates a series of
  * assignments on the given variable. Point is to be able to zero
@@ -474,9 +482,8 @@ static void zero_initialize(
     case T_STRUCT:
     case T_UNION:
         assert(size);
-        target.type = (size % 8)
-            ? type_create_array(basic_type__char, size)
-            : type_create_array(basic_type__long, size / 8);
+        zero_initialize_bytes(def, values, target, size);
+        break;
     case T_ARRAY:
         var = target;
         target.type = type_next(target.type);
@@ -59,6 +59,12 @@ static array_of(struct block *) expressions;
  */
 static array_of(struct block *) blocks;
 
+/*
+ * Labels with address taken can be referenced from static data, which
+ * is compiled after the function. Keep them until end of input.
+ */
+static array_of(struct symbol *) address_labels;
+
 static void recycle_block(struct block *block)
 {
     struct expression expr = {0};
@@ -68,7 +74,12 @@ static void recycle_block(struct block *block)
     block->expr = expr;
     block->has_return_value = 0;
     block->jump[0] = block->jump[1] = NULL;
+    block->predecessors = 0;
+    block->indirect = 0;
+    array_empty(&block->targets);
     block->color = WHITE;
+    block->likely = LIKELY_NONE;
+    block->expect = LIKELY_NONE;
     array_push_back(&blocks, block);
 }
 
@@ -85,7 +96,11 @@ static void cfg_empty(struct definition *def)
     }
     for (i = 0; i < array_len(&def->labels); ++i) {
         sym = array_get(&def->labels, i);
-        sym_discard(sym);
+        if (sym->referenced) {
+            array_push_back(&address_labels, sym);
+        } else {
+            sym_discard(sym);
+        }
     }
     for (i = 0; i < array_len(&def->nodes); ++i) {
         recycle_block(array_get(&def->nodes, i));
@@ -95,6 +110,7 @@ static void cfg_empty(struct definition *def)
     array_empty(&def->locals);
     array_empty(&def->labels);
     array_empty(&def->nodes);
+    array_empty(&def->sources);
 }
 
 static void cfg_clear(struct definition *def)
@@ -110,7 +126,11 @@ static void cfg_clear(struct definition *def)
     }
     for (i = 0; i < array_len(&def->labels); ++i) {
         sym = array_get(&def->labels, i);
-        sym_discard(sym);
+        if (sym->referenced) {
+            array_push_back(&address_labels, sym);
+        } else {
+            sym_discard(sym);
+        }
     }
     for (i = 0; i < array_len(&def->nodes); ++i) {
         recycle_block(array_get(&def->nodes, i));
@@ -120,6 +140,7 @@ static void cfg_clear(struct definition *def)
     array_clear(&def->locals);
     array_clear(&def->labels);
     array_clear(&def->nodes);
+    array_clear(&def->sources);
     free(def);
 }
 
@@ -132,22 +153,28 @@ static void deallocate_cfg(void)
     for (i = 0; i < array_len(&expressions); ++i) {
         block = array_get(&expressions, i);
         array_clear(&block->code);
+        array_clear(&block->targets);
         free(block);
     }
     for (i = 0; i < array_len(&blocks); ++i) {
         block = array_get(&blocks, i);
         array_clear(&block->code);
+        array_clear(&block->targets);
         free(block);
     }
     for (i = 0; i < array_len(&prototypes); ++i) {
         def = array_get(&prototypes, i);
         cfg_clear(def);
     }
+    for (i = 0; i < array_len(&address_labels); ++i) {
+        sym_discard(array_get(&address_labels, i));
+    }
 
     deque_destroy(&definitions);
     array_clear(&prototypes);
     array_clear(&expressions);
     array_clear(&blocks);
+    array_clear(&address_labels);
 }
 
 INTERNAL struct block *cfg_block_init(struct definition *def)
@@ -47,6 +47,13 @@ struct switch_context {
     array_of(struct switch_case) cases;
 };
 
+/*
+ * Function currently being parsed, owning the blocks of all labels.
+ * Label addresses can also be taken in initializers of static
+ * variables, which are evaluated with a separate definition.
+ */
+static struct definition *function_definition;
+
 /*
  * Keep track of nested switch statements and their case labels. This
  * reference always points to the current context, and backtracking is
@@ -219,7 +226,8 @@ static struct block *for_statement(
         *top = cfg_block_init(def),
         *body = cfg_block_init(def),
         *increment = cfg_block_init(def),
-        *next = cfg_block_init(def);
+        *next = cfg_block_init(def),
+        *tail;
 
     struct block
         *old_break_target,
@@ -235,6 +243,8 @@ static struct block *for_statement(
         sym = sym_lookup(&ns_ident, tok.d.string);
         if (!sym || sym->symtype != SYM_TYPEDEF) {
             parent = expression(def, parent);
+            parent->expr =
+                eval_expression_statement(def, parent, parent->expr);
             consume(';');
             break;
         }
@@ -245,6 +255,7 @@ static struct block *for_statement(
         break;
     default:
         parent = expression(def, parent);
+        parent->expr = eval_expression_statement(def, parent, parent->expr);
     case ';':
         consume(';');
         break;
@@ -277,7 +288,9 @@ static struct block *for_statement(
 
     consume(';');
     if (peek().token != ')') {
-        expression(def, increment)->jump[0] = top;
+        tail = expression(def, increment);
+        tail->expr = eval_expression_statement(def, tail, tail->expr);
+        tail->jump[0] = top;
         consume(')');
         set_continue_target(old_continue_target, increment);
         body = statement(def, body);
@@ -328,6 +341,12 @@ static struct block *switch_statement(
         exit(1);
     }
     consume(')');
+
+    /*
+     * Evaluate controlling expression once, before comparing against
+     * each case label.
+     */
+    value = eval(def, parent, parent->expr);
     last = statement(def, body);
     last->jump[0] = next;
 
@@ -339,7 +358,6 @@ static struct block *switch_statement(
             prev_cond = cond;
             sc = array_get(&switch_context->cases, i);
             cond = cfg_block_init(def);
-            value = eval(def, parent, parent->expr);
             cond->expr = eval_expr(def, cond, IR_OP_EQ, sc.value, value);
             cond->jump[1] = sc.label;
             prev_cond->jump[0] = cond;
@@ -381,17 +399,23 @@ INTERNAL struct block *statement(struct definition *def, struct block *parent)
         break;
     case GOTO:
         consume(GOTO);
-        tok = consume(IDENTIFIER);
-        sym = sym_add(
-            &ns_label,
-            tok.d.string,
-            basic_type__void,
-            SYM_TENTATIVE,
-            LINK_INTERN);
-        if (!sym->value.label) {
-            sym->value.label = cfg_block_init(def);
+        if (peek().token == '*') {
+            consume('*');
+            parent = expression(def, parent);
+            parent->expr = eval_computed_goto(def, parent);
+        } else {
+            tok = consume(IDENTIFIER);
+            sym = sym_add(
+                &ns_label,
+                tok.d.string,
+                basic_type__void,
+                SYM_TENTATIVE,
+                LINK_INTERN);
+            if (!sym->value.label) {
+                sym->value.label = cfg_block_init(def);
+            }
+            parent->jump[0] = sym->value.label;
         }
-        parent->jump[0] = sym->value.label;
         parent = cfg_block_init(def); /* Orphan, unless labeled. */
         consume(';');
         break;
@@ -508,3 +532,63 @@ INTERNAL struct block *block(struct definition *def, struct block *parent)
     pop_scope(&ns_ident);
     return parent;
 }
+
+INTERNAL struct block *function_body(
+    struct definition *def,
+    struct block *parent)
+{
+    int i, j;
+    struct block *node, *target;
+
+    function_definition = def;
+    parent = block(def, parent);
+    function_definition = NULL;
+
+    /*
+     * Computed goto can jump to any label with address taken in the
+     * function, which are all known at this point.
+     */
+    for (i = 0; i < array_len(&def->nodes); ++i) {
+        node = array_get(&def->nodes, i);
+        if (!node->indirect)
+            continue;
+
+        for (j = 0; j < array_len(&def->nodes); ++j) {
+            target = array_get(&def->nodes, j);
+            if (target->label->referenced) {
+                array_push_back(&node->targets, target);
+            }
+        }
+    }
+
+    return parent;
+}
+
+INTERNAL struct var label_address(String name)
+{
+    struct var var = {0};
+    struct symbol *sym;
+    struct block *target;
+
+    if (!function_definition) {
+        error("Cannot take address of label outside of function.");
+        exit(1);
+    }
+
+    sym = sym_add(
+        &ns_label,
+        name,
+        basic_type__void,
+        SYM_TENTATIVE,
+        LINK_INTERN);
+    if (!sym->value.label) {
+        sym->value.label = cfg_block_init(function_definition);
+    }
+
+    target = sym->value.label;
+    ((struct symbol *) target->label)->referenced = 1;
+    var.kind = ADDRESS;
+    var.type = type_create_pointer(basic_type__void);
+    var.symbol = target->label;
+    return var;
+}
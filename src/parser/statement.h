@@ -7,4 +7,15 @@ INTERNAL struct block *statement(struct definition *def, struct block *parent);
 
 INTERNAL struct block *block(struct definition *def, struct block *parent);
 
+/*
+ * Parse function body, adding every label with address taken as target
+ * of each computed goto.
+ */
+INTERNAL struct block *function_body(
+    struct definition *def,
+    struct block *parent);
+
+/* Address of label in current function, from '&&label'. */
+INTERNAL struct var label_address(String name);
+
 #endif
@@ -572,6 +572,30 @@ INTERNAL int is_temporary(const struct symbol *sym)
     return strcmp(PREFIX_TEMPORARY, raw) == 0;
 }
 
+INTERNAL enum visibility sym_visibility(const struct symbol *sym)
+{
+    assert(sym->linkage == LINK_EXTERN);
+    if (sym->visibility != VISIBILITY_UNSPECIFIED) {
+        return sym->visibility;
+    }
+
+    switch (sym->symtype) {
+    case SYM_DEFINITION:
+    case SYM_TENTATIVE:
+        return context.visibility;
+    default:
+        return VISIBILITY_DEFAULT;
+    }
+}
+
+INTERNAL const char *sym_text_section(const struct symbol *sym)
+{
+    assert(is_function(sym->type));
+    return sym->cold ? ".text.unlikely"
+        : sym->hot ? ".text.hot"
+        : ".text";
+}
+
 INTERNAL const struct symbol *yield_declaration(struct namespace *ns)
 {
     const struct symbol *sym;
@@ -762,7 +762,15 @@ INTERNAL void preprocess_directive(TokenArray *array)
         }
     } else if (in_active_block()) {
         if (!tok_cmp(*line, ident__define)) {
-            define(preprocess_define(line + 1, &line));
+            /*
+             * System headers written for compilers other than GCC, like
+             * glibc sys/cdefs.h, define __attribute__(xyz) to nothing.
+             * Attributes are handled by the parser, so ignore these
+             * definitions instead of erasing them from user code.
+             */
+            if (line[1].token != ATTRIBUTE || !current_file_is_system) {
+                define(preprocess_define(line + 1, &line));
+            }
         } else if (!tok_cmp(*line, ident__undef)) {
             line++;
             if (!line->is_expandable) {
@@ -43,6 +43,14 @@ struct source {
 
     /* Current line. */
     int line;
+
+    /* Found in a system include directory, or included from one. */
+    int is_system;
+};
+
+struct search_path {
+    const char *path;
+    int is_system;
 };
 
 /* Temporary buffer used to construct search paths. */
@@ -53,7 +61,7 @@ static char *rline;
 static size_t rlen;
 
 /* List of directories to search on resolving include directives. */
-static array_of(const char *) search_path_list;
+static array_of(struct search_path) search_path_list;
 
 /*
  * Keep stack of file descriptors as resolved by includes. Push and pop
@@ -64,6 +72,7 @@ static array_of(struct source) source_stack;
 /* Expose for diagnostics. */
 INTERNAL String current_file_path;
 INTERNAL int current_file_line;
+INTERNAL int current_file_is_system;
 
 static struct source *current_file(void)
 {
@@ -78,6 +87,7 @@ static void push_file(struct source source)
 
     current_file_line = 0;
     current_file_path = source.path;
+    current_file_is_system = source.is_system;
     source.buffer = malloc(FILE_BUFFER_SIZE);
     source.size = FILE_BUFFER_SIZE;
     array_push_back(&source_stack, source);
@@ -159,6 +169,7 @@ INTERNAL void include_file(const char *name)
     if (source.file) {
         source.path = str_register(path, strlen(path));
         source.dirlen = path_dirlen(path);
+        source.is_system = file->is_system;
         push_file(source);
     } else {
         include_system_file(name);
@@ -168,12 +179,14 @@ INTERNAL void include_file(const char *name)
 INTERNAL void include_system_file(const char *name)
 {
     struct source source = {0};
+    struct search_path dir;
     const char *path;
     size_t dirlen;
     int i;
 
     for (i = 0; i < array_len(&search_path_list); ++i) {
-        path = array_get(&search_path_list, i);
+        dir = array_get(&search_path_list, i);
+        path = dir.path;
         dirlen = strlen(path);
         while (path[dirlen - 1] == '/') {
             dirlen--;
@@ -184,6 +197,7 @@ INTERNAL void include_system_file(const char *name)
         if (source.file) {
             source.path = str_register(path, strlen(path));
             source.dirlen = path_dirlen(path);
+            source.is_system = dir.is_system;
             break;
         }
     }
@@ -198,7 +212,19 @@ INTERNAL void include_system_file(const char *name)
 
 INTERNAL void add_include_search_path(const char *path)
 {
-    array_push_back(&search_path_list, path);
+    struct search_path dir = {0};
+
+    dir.path = path;
+    array_push_back(&search_path_list, dir);
+}
+
+INTERNAL void add_system_search_path(const char *path)
+{
+    struct search_path dir = {0};
+
+    dir.path = path;
+    dir.is_system = 1;
+    array_push_back(&search_path_list, dir);
 }
 
 INTERNAL void set_input_file(const char *path)
@@ -551,6 +577,7 @@ INTERNAL char *getprepline(void)
         if (stale) {
             current_file_path = source->path;
             current_file_line = source->line;
+            current_file_is_system = source->is_system;
             stale = 0;
         }
         line = initial_preprocess_line(source);
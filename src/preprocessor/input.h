@@ -18,6 +18,12 @@ INTERNAL void clear_input_buffers(void);
  */
 INTERNAL void add_include_search_path(const char *);
 
+/*
+ * Append default directory to search when resolving includes. Headers
+ * found here are system headers, where warnings are not reported.
+ */
+INTERNAL void add_system_search_path(const char *);
+
 /* Push new include file. */
 INTERNAL void include_file(const char *);
 INTERNAL void include_system_file(const char *);
@@ -33,4 +39,7 @@ INTERNAL char *getprepline(void);
 EXTERNAL String current_file_path;
 EXTERNAL int current_file_line;
 
+/* Whether the file that was last read is a system header. */
+EXTERNAL int current_file_is_system;
+
 #endif
@@ -830,6 +830,21 @@ INTERNAL void register_builtin_definitions(enum cstd version)
     register_macro("__CHAR_BIT__", "8");
     register_macro("__SIZEOF_LONG__", "8");
     register_macro("__SIZEOF_POINTER__", "8");
+    if (context.fast_math) {
+        register_macro("__FAST_MATH__", "1");
+    }
+
+    if (context.popcnt) {
+        register_macro("__POPCNT__", "1");
+    }
+
+    if (context.lzcnt) {
+        register_macro("__LZCNT__", "1");
+    }
+
+    if (context.bmi) {
+        register_macro("__BMI__", "1");
+    }
 
 #ifdef __linux__
     register_macro("__linux__", XSTR(__linux__));
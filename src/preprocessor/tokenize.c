@@ -48,7 +48,7 @@ INTERNAL const struct token basic_token[] = {
             TOK(COMMA, ","),            TOK(MINUS, "-"),
             TOK(DOT, "."),              TOK(SLASH, "/"),
 /* 0x30 */  TOK(RESTRICT, "restrict"),  TOK(ALIGNOF, "_Alignof"),
-            TOK(BOOL, "_Bool"),         {0},
+            TOK(BOOL, "_Bool"),         IDN(ATTRIBUTE, "__attribute__"),
             {0},                        {0},
             {0},                        {0},
 /* 0x38 */  IDN(STATIC_ASSERT, ""),     {0},
@@ -533,6 +533,7 @@ static struct token strtoident(const char *in, const char **endptr)
     case '_':
         if (S4('B', 'o', 'o', 'l')) MATCH(BOOL);
         if (S7('A', 'l', 'i', 'g', 'n', 'o', 'f')) MATCH(ALIGNOF);
+        if (!strncmp(in, "_attribute__", 12) && E(12)) MATCH(ATTRIBUTE);
         if (!strncmp(in, "Static_assert", 12)) {
             ident = basic_token[STATIC_ASSERT];
             ident.d.string = str_init("_Static_assert");
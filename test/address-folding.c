@@ -0,0 +1,105 @@
+int printf(const char *, ...);
+
+struct point {
+	int x, y;
+	long z;
+};
+
+int global[16];
+static short table[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+static int get(int *a, int i) {
+	return a[i];
+}
+
+static long getl(long *a, long i) {
+	return a[i + 2] + a[i - 1];
+}
+
+static void put(int *a, int i, int v) {
+	a[i] = v;
+	a[i + 1] = v * 2;
+}
+
+static int field(struct point *p, int i) {
+	return p[i].y + (int) p[i + 1].z;
+}
+
+static int *address(int *a, int i) {
+	return &a[i];
+}
+
+static char byte(const char *s, long i) {
+	return s[i];
+}
+
+static double real(double *d, int i) {
+	return d[i] * 2.0 + d[i - 1];
+}
+
+static int local(int i) {
+	int k, l[8];
+
+	for (k = 0; k < 8; ++k)
+		l[k] = k * 3;
+
+	return l[i] + l[7 - i];
+}
+
+static int statics(int i) {
+	global[i] = i;
+	global[i + 1] = table[i];
+	return global[i] + global[i + 1] + table[i + 1];
+}
+
+static int matrix(int m[][4], int i, int j) {
+	m[i][j] += 1;
+	return m[i][j] + m[j][i];
+}
+
+static int sum(int *a, int n) {
+	int i, s = 0;
+
+	for (i = 0; i < n; ++i) {
+		if (a[i] > 2)
+			s += a[i];
+		else
+			s -= a[i];
+	}
+
+	return s;
+}
+
+static int many(int *a, int *b, int *c, int i, int j, int k) {
+	return a[i] + b[j] * c[k] - a[j] + b[k] * c[i] + a[k] - b[i] + c[j];
+}
+
+static unsigned long unsigned_index(unsigned long *a, unsigned char i) {
+	return a[i] + a[(unsigned char) (i + 1)];
+}
+
+int main(void) {
+	int a[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+	long l[6] = {10, 20, 30, 40, 50, 60};
+	struct point p[3] = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+	double d[4] = {0.5, 1.5, 2.5, 3.5};
+	int m[4][4] = {{0}};
+	unsigned long u[4] = {100, 200, 300, 400};
+
+	put(a, 3, 42);
+	printf("%d %d %d\n", get(a, 3), get(a, 4), get(a, 9));
+	printf("%ld\n", getl(l, 2));
+	printf("%d\n", field(p, 1));
+	printf("%d\n", *address(a, 5) + (int) (address(a, 7) - a));
+	printf("%c\n", byte("folding", 3));
+	printf("%f\n", real(d, 2));
+	printf("%d %d\n", local(2), local(6));
+	printf("%d\n", statics(3));
+	printf("%d\n", global[4]);
+	printf("%d\n", matrix(m, 1, 2));
+	printf("%d\n", matrix(m, 2, 1));
+	printf("%d\n", sum(a, 10));
+	printf("%d\n", many(a, a + 1, a + 2, 1, 2, 3));
+	printf("%lu\n", unsigned_index(u, 2));
+	return 0;
+}
@@ -0,0 +1,59 @@
+int printf(const char *, ...);
+
+static int *saved;
+
+static void keep(int *p) {
+	saved = p;
+}
+
+static int peek(void) {
+	return *saved;
+}
+
+static int escape(void) {
+	int x;
+
+	keep(&x);
+	x = 42;
+	return peek();
+}
+
+static int through_pointer(int n) {
+	int a = 1, b = 2, *p;
+
+	p = n ? &a : &b;
+	a = 3;
+	b = 4;
+	return *p + a;
+}
+
+static int overwrite(int *p) {
+	int t = 1, u;
+
+	u = *p;
+	t = *p + u;
+	*p = t;
+	return t;
+}
+
+static int array(int i) {
+	int a[4], k;
+
+	for (k = 0; k < 4; ++k)
+		a[k] = k * k;
+
+	k = a[i];
+	a[i] = 7;
+	return k + a[i];
+}
+
+int main(void) {
+	int v = 5;
+
+	printf("%d\n", escape());
+	printf("%d %d\n", through_pointer(0), through_pointer(1));
+	printf("%d\n", overwrite(&v));
+	printf("%d\n", v);
+	printf("%d\n", array(2));
+	return 0;
+}
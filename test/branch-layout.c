@@ -0,0 +1,53 @@
+int printf(const char *, ...);
+void exit(int);
+
+struct node {
+	int value;
+	struct node *next;
+};
+
+static int sum(struct node *list) {
+	int s = 0;
+	if (!list)
+		return -1;
+	while (list) {
+		s += list->value;
+		list = list->next;
+	}
+	return s;
+}
+
+static int find(const int *a, int n, int x) {
+	int i;
+	for (i = 0; i < n; ++i) {
+		if (a[i] == x)
+			return i;
+		if (a[i] < 0)
+			break;
+	}
+	return -1;
+}
+
+static int check(int x) {
+	if (x > 100) {
+		printf("too large\n");
+		exit(1);
+	}
+	do {
+		x = x * 2 + 1;
+	} while (x < 50);
+	return x;
+}
+
+int main(void) {
+	int a[] = {3, 1, 4, 1, 5, -9, 2, 6};
+	struct node n[3];
+
+	n[0].value = 1, n[0].next = &n[1];
+	n[1].value = 2, n[1].next = &n[2];
+	n[2].value = 3, n[2].next = 0;
+
+	printf("%d %d\n", sum(n), sum(0));
+	printf("%d %d %d\n", find(a, 8, 5), find(a, 8, 6), find(a, 8, 7));
+	return printf("%d %d\n", check(0), check(20));
+}
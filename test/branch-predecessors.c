@@ -0,0 +1,26 @@
+int printf(const char *, ...);
+
+static short select(short a, short b, short c) {
+	short x = a, y = b, t = 0;
+	x = ((x || b) ? (5 != -3) : (-1 || x)) && -1;
+	return x + y * 3 + c - t;
+}
+
+static int chain(int a, int b) {
+	int r = 0;
+	if (a && b)
+		r = 1;
+	else if (a || b)
+		r = 2;
+	return r + (a ? b : -b);
+}
+
+int main(void) {
+	int i, j;
+	for (i = -2; i < 3; ++i) {
+		for (j = -1; j < 2; ++j) {
+			printf("%d %d %d\n", select(i, j, 1), select(j, i, 0), chain(i, j));
+		}
+	}
+	return 0;
+}
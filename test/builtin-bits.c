@@ -0,0 +1,38 @@
+int printf(const char *, ...);
+
+static unsigned u32[] = {1, 0x80000000u, 0xF0F0F0F0u, 0x12345678u, 0xFFFFFFFFu};
+
+static unsigned long u64[] = {1, 0x8000000000000000ul, 0x00FF00FF00FF00FFul,
+	0x0123456789ABCDEFul, 0xFFFFFFFFFFFFFFFFul};
+
+static int count(const unsigned long *p, int n) {
+	int c = 0;
+	while (n--) {
+		c += __builtin_popcountll(*p++);
+	}
+
+	return c;
+}
+
+int main(void) {
+	int i;
+	long z = 0;
+
+	for (i = 0; i < 5; ++i) {
+		printf("%d %d %d %d %x\n",
+			__builtin_popcount(u32[i]), __builtin_clz(u32[i]),
+			__builtin_ctz(u32[i]), __builtin_ffs(u32[i]),
+			__builtin_bswap32(u32[i]));
+		printf("%d %d %d %d %lx\n",
+			__builtin_popcountl(u64[i]), __builtin_clzl(u64[i]),
+			__builtin_ctzll(u64[i]), __builtin_ffsl(u64[i]),
+			__builtin_bswap64(u64[i]));
+	}
+
+	printf("%d %d %d\n", count(u64, 5), __builtin_ffs(i - 5),
+		__builtin_ffsll(z));
+	printf("%d %d %d %d %x %lx\n", __builtin_popcount(0xFFu),
+		__builtin_clz(1), __builtin_ctzl(8), __builtin_ffs(0),
+		__builtin_bswap32(0x11223344u), __builtin_bswap64(0x1122ul));
+	return 0;
+}
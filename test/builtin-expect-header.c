@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __attribute__
+# define ATTRIBUTE_MACRO 1
+#else
+# define ATTRIBUTE_MACRO 0
+#endif
+
+static int failures;
+
+static void fail(const char *msg) __attribute__((__cold__, noinline));
+
+static void fail(const char *msg) {
+	failures++;
+	printf("fail: %s\n", msg);
+}
+
+__attribute__((hot)) static long sum(const int *p, int n) {
+	long s = 0;
+	int i;
+
+	for (i = 0; __builtin_expect(i < n, 1); ++i) {
+		if (__builtin_expect(p[i] < 0, 0)) {
+			fail("negative");
+			continue;
+		}
+		s += p[i];
+	}
+
+	return s;
+}
+
+__attribute__((__noinline__, cold)) static void check(long n) {
+	if (n != 7) {
+		abort();
+	}
+}
+
+int main(void) {
+	int a[] = {1, 2, -3, 4};
+
+	check(sum(a, 4));
+	printf("%d %d\n", failures, ATTRIBUTE_MACRO);
+	return failures != 1 || ATTRIBUTE_MACRO;
+}
@@ -0,0 +1,49 @@
+int printf(const char *, ...);
+
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+
+static int failures;
+
+static void fail(const char *msg) __attribute__((cold, noinline));
+
+static void fail(const char *msg) {
+	failures++;
+	printf("fail: %s\n", msg);
+}
+
+__attribute__((hot)) static long sum(const int *p, int n) {
+	long s = 0;
+	int i;
+
+	for (i = 0; likely(i < n); ++i) {
+		if (unlikely(p[i] < 0)) {
+			fail("negative");
+			continue;
+		}
+		s += p[i];
+	}
+
+	return s;
+}
+
+static int check(long n) {
+	if (!__builtin_expect(n, 7)) {
+		return -1;
+	}
+
+	if (__builtin_expect(n, 7) == 7) {
+		return 1;
+	}
+
+	return __builtin_expect(n > 10, 0) ? 2 : 0;
+}
+
+int main(void) {
+	int a[] = {1, 2, -3, 4};
+	long x = __builtin_expect(42, 1);
+
+	printf("%ld %ld\n", sum(a, 4), x);
+	printf("%d %d %d %d\n", check(0), check(7), check(3), check(12));
+	return failures != 1;
+}
@@ -0,0 +1,53 @@
+int printf(const char *, ...);
+
+struct vec {
+	double x, y, z, w;
+};
+
+static struct vec table[6] = {{1, 2, 3, 4}, {5, 6, 7, 8}};
+
+static long sum(const long *p, int n) {
+	long s = 0;
+	int i;
+
+	for (i = 0; i < n; ++i) {
+		__builtin_prefetch(p + i + 8);
+		__builtin_prefetch(&p[i + 16], 0, 1);
+		s += p[i];
+	}
+
+	__builtin_prefetch(p, 1);
+	__builtin_prefetch(p, 0, 0);
+	__builtin_prefetch(table, 1, 2);
+	return s;
+}
+
+static void copy(struct vec *dst, const void *src, int i) {
+	struct vec *const v = __builtin_assume_aligned(src, 16);
+	const struct vec *u = __builtin_assume_aligned(src, 16, 0);
+
+	dst[0] = *(struct vec *) __builtin_assume_aligned(dst + 1, 32, 32);
+	dst[i] = *v;
+	dst[i + 1] = u[1];
+	table[5] = *v;
+	*(struct vec *) __builtin_assume_aligned(dst + 2, 16) = u[1];
+}
+
+int main(void) {
+	long a[32];
+	struct vec v[3];
+	int i;
+
+	for (i = 0; i < 32; ++i) {
+		a[i] = i * i;
+	}
+
+	v[1] = table[1];
+	copy(table + 2, table, 1);
+	printf("%ld\n", sum(a, 32));
+	for (i = 0; i < 6; ++i) {
+		printf("%f %f %f %f\n", table[i].x, table[i].y, table[i].z, table[i].w);
+	}
+
+	return v[1].w != 8;
+}
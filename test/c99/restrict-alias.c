@@ -0,0 +1,63 @@
+int printf(const char *, ...);
+
+struct pair {
+	int a, b;
+};
+
+static void scale(float *restrict dst, const float *restrict src, int n) {
+	int i;
+
+	for (i = 0; i < n; ++i)
+		dst[i] = src[i] * 2.0f + src[n - i - 1];
+}
+
+static int overlap(int *a, int *b) {
+	*a = 1;
+	*b = 2;
+	return *a;
+}
+
+static int fields(struct pair *p) {
+	p->a = 3;
+	p->b = 4;
+	return p->a + p->b;
+}
+
+static int bytes(char *c, int *p) {
+	*p = 0;
+	*c = 1;
+	return *p;
+}
+
+static int local(int *p) {
+	int arr[4], k;
+
+	arr[1] = 2;
+	k = 5;
+	*p = 3;
+	return arr[1] + k;
+}
+
+static long mixed(long *l, double *d) {
+	*l = 7;
+	*d = 0.5;
+	return *l;
+}
+
+int main(void) {
+	float x[4] = {1, 2, 3, 4}, y[4];
+	struct pair p;
+	int n = 0;
+	long l;
+	double d;
+
+	scale(y, x, 4);
+	printf("%f %f %f %f\n", y[0], y[1], y[2], y[3]);
+	printf("%d\n", overlap(&n, &n));
+	printf("%d\n", fields(&p));
+	printf("%d\n", bytes((char *) &n, &n));
+	printf("%d ", local(&n));
+	printf("%d\n", n);
+	printf("%ld\n", mixed(&l, &d));
+	return 0;
+}
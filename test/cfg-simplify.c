@@ -0,0 +1,58 @@
+int printf(const char *, ...);
+
+static int retest(int a, int b) {
+	int n = 0;
+	if (a < b) {
+		if (a < b)
+			n += 1;
+		if (b > a)
+			n += 2;
+		if (a >= b)
+			n += 4;
+	}
+	while (a != b && a != b) {
+		a++;
+		n += 8;
+	}
+	return n;
+}
+
+static int chain(int x) {
+	goto a;
+c:	x = x * 3;
+	goto d;
+b:	x = x + 1;
+	goto c;
+a:	x = x - 2;
+	goto b;
+d:	return x;
+	x = 5;
+	return x;
+}
+
+static int constant(int x) {
+	if (1) {
+		x += 1;
+	} else {
+		x += 2;
+	}
+	while (0) {
+		x += 4;
+	}
+	do {
+		x += 8;
+	} while (0);
+	return x;
+}
+
+int main(void) {
+	int i, sum = 0;
+
+	for (i = 0; i < 5; ++i) {
+		sum += retest(i, 3);
+		sum += chain(i);
+		sum += constant(i);
+	}
+
+	return printf("%d\n", sum);
+}
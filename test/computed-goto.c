@@ -0,0 +1,105 @@
+int printf(const char *, ...);
+
+enum op { PUSH, ADD, MUL, DUP, OVER, JNZ, DEC, SWAP, HALT };
+
+static long run(const int *code) {
+	static void *dispatch[] = {
+		&&op_push, &&op_add, &&op_mul, &&op_dup, &&op_over,
+		&&op_jnz, &&op_dec, &&op_swap, &&op_halt
+	};
+
+	long stack[16], t;
+	int sp = 0, pc = 0;
+
+	goto *dispatch[code[pc]];
+
+op_push:
+	stack[sp++] = code[pc + 1];
+	pc += 2;
+	goto *dispatch[code[pc]];
+op_add:
+	sp--;
+	stack[sp - 1] += stack[sp];
+	pc++;
+	goto *dispatch[code[pc]];
+op_mul:
+	sp--;
+	stack[sp - 1] *= stack[sp];
+	pc++;
+	goto *dispatch[code[pc]];
+op_dup:
+	stack[sp] = stack[sp - 1];
+	sp++;
+	pc++;
+	goto *dispatch[code[pc]];
+op_over:
+	stack[sp] = stack[sp - 2];
+	sp++;
+	pc++;
+	goto *dispatch[code[pc]];
+op_jnz:
+	pc = stack[--sp] ? code[pc + 1] : pc + 2;
+	goto *dispatch[code[pc]];
+op_dec:
+	stack[sp - 1]--;
+	pc++;
+	goto *dispatch[code[pc]];
+op_swap:
+	t = stack[sp - 1];
+	stack[sp - 1] = stack[sp - 2];
+	stack[sp - 2] = t;
+	pc++;
+	goto *dispatch[code[pc]];
+op_halt:
+	return stack[sp - 1];
+}
+
+static int pick(int n) {
+	void *table[3];
+	void *p;
+	int r = 0;
+
+	table[0] = &&zero;
+	table[1] = &&one;
+	table[2] = &&two;
+	p = table[n % 3];
+	if (p == &&two) {
+		r = 100;
+	}
+
+	goto *p;
+zero:
+	r += 1;
+one:
+	r += 10;
+	return r;
+two:
+	return r + n;
+}
+
+static int count(int n) {
+	void *next = &&loop;
+	int s = 0;
+
+loop:
+	s += n;
+	if (--n == 0) {
+		next = &&done;
+	}
+	goto *next;
+done:
+	return s;
+}
+
+int main(void) {
+	int code[] = {
+		PUSH, 5, PUSH, 1,
+		OVER, MUL, SWAP, DEC, SWAP, OVER, JNZ, 4, HALT
+	};
+	int simple[] = {PUSH, 6, DUP, PUSH, 7, MUL, ADD, HALT};
+
+	printf("%ld %ld\n", run(simple), run(code));
+	printf("%d %d %d %d\n", pick(0), pick(1), pick(2), pick(5));
+	printf("%d\n", count(10));
+	return 0;
+}
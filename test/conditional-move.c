@@ -0,0 +1,98 @@
+int printf(const char *, ...);
+
+static int max(int a, int b) {
+	return a > b ? a : b;
+}
+
+static unsigned long umin(unsigned long a, unsigned long b) {
+	unsigned long r;
+	if (a < b)
+		r = a;
+	else
+		r = b;
+	return r;
+}
+
+static long labs_(long x) {
+	return x < 0 ? -x : x;
+}
+
+static int clamp(int x, int lo, int hi) {
+	if (x < lo)
+		x = lo;
+	if (x > hi)
+		x = hi;
+	return x;
+}
+
+static const char *pick(const char *s, const char *t, int c) {
+	return c ? s : t;
+}
+
+static int nonzero(char *p) {
+	int n = 7;
+	if (!p)
+		n = 0;
+	return n;
+}
+
+static int fmax_(double a, double b) {
+	int r = 0;
+	if (a > b)
+		r = 1;
+	if (a >= b)
+		r += 2;
+	return r;
+}
+
+static int peek(int *p) {
+	return p ? *p : -1;
+}
+
+static long arr[8];
+
+static long scaled(unsigned c, unsigned char d) {
+	signed char x = 64;
+	arr[d & 7] = c - (x ? d : (unsigned long) -8);
+	return arr[d & 7];
+}
+
+static int flag(char c, short s, int a, int b) {
+	int r = a;
+	if (c)
+		r = b;
+	if (s)
+		r += a;
+	return r;
+}
+
+static int counter;
+
+static int escape(int c, int a) {
+	int x = 1, *p = &x;
+	if (c)
+		counter = a;
+	if (c > 1)
+		x = a;
+	return *p + counter;
+}
+
+int main(void) {
+	int k = 42;
+	unsigned u = 3;
+	printf("%d %d %d\n", max(1, 2), max(-3, -5), max(7, 7));
+	printf("%lu %lu\n", umin(5, 3), umin(-1ul, 9));
+	printf("%ld %ld\n", labs_(-12), labs_(34));
+	printf("%d %d %d\n", clamp(-4, 0, 10), clamp(5, 0, 10), clamp(11, 0, 10));
+	printf("%s %s\n", pick("yes", "no", 1), pick("yes", "no", 0));
+	printf("%d %d\n", nonzero(0), nonzero("a"));
+	printf("%d %d %d\n", fmax_(2.0, 1.0), fmax_(1.0, 1.0), fmax_(0.0, 1.0));
+	printf("%d %d\n", peek(&k), peek(0));
+	printf("%ld %ld\n", scaled(100, 3), scaled(1, 250));
+	printf("%d %d %d\n", flag(0, 0, 1, 2), flag(1, 0, 1, 2), flag(0, 2, 1, 2));
+	k = escape(0, 5);
+	k += escape(1, 6) * 10;
+	k += escape(2, 7) * 100;
+	printf("%d\n", k);
+	return u > 2 ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+int printf(const char *, ...);
+
+static int sdiv(int x) {
+	return x / 3 + x / 7 + x / -10 + x / 1000003;
+}
+
+static int smod(int x) {
+	return x % 3 + x % -7 + x % 10 + x % 641;
+}
+
+static unsigned udiv(unsigned x) {
+	return x / 3 + x / 7 + x / 10 + x / 0x80000001u;
+}
+
+static unsigned umod(unsigned x) {
+	return x % 7 + x % 10 + x % 1000003;
+}
+
+static long sldiv(long x) {
+	return x / 3 + x / 7 + x / -5 + x / 0x123456789L;
+}
+
+static long slmod(long x) {
+	return x % 10 + x % -3 + x % 1000003;
+}
+
+static unsigned long uldiv(unsigned long x) {
+	return x / 7 + x / 10 + x / 0x8000000000000001ul;
+}
+
+static unsigned long ulmod(unsigned long x) {
+	return x % 3 + x % 7 + x % 12345678901ul;
+}
+
+static long values[] = {
+	0, 1, -1, 2, 6, 7, 9, 10, 11, 99, -100, 641, 1000003, -1000003,
+	2147483647L, -2147483647L - 1, 4294967295L, 123456789012345L,
+	-123456789012345L, 9223372036854775807L, -9223372036854775807L - 1
+};
+
+int main(void) {
+	int i;
+	long v;
+
+	for (i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+		v = values[i];
+		printf("%d %d ", sdiv((int) v), smod((int) v));
+		printf("%u %u ", udiv((unsigned) v), umod((unsigned) v));
+		printf("%ld %ld ", sldiv(v), slmod(v));
+		printf("%lu %lu\n", uldiv(v), ulmod(v));
+	}
+
+	return 0;
+}
@@ -0,0 +1,49 @@
+int printf(const char *, ...);
+
+static double to_double(unsigned u) {
+	return u;
+}
+
+static float to_float(unsigned long u) {
+	return u;
+}
+
+static unsigned long from_double(double d) {
+	return d;
+}
+
+static unsigned from_float(const float *p) {
+	return *p;
+}
+
+static double sum(const unsigned *p, int n) {
+	double s = 0;
+	while (n--) {
+		s += *p++;
+	}
+
+	return s;
+}
+
+int main(void) {
+	unsigned a[] = {0, 1, 0x7FFFFFFFu, 0x80000000u, 0xFFFFFFFFu};
+	unsigned long b[] = {0, 0x7FFFFFFFFFFFFFFFul, 0x8000000000000401ul,
+		0xFFFFFFFFFFFFFFFFul};
+	float f[] = {0.0f, 2147483648.0f, 4294967040.0f};
+	int i;
+
+	for (i = 0; i < 5; ++i) {
+		printf("%f ", to_double(a[i]));
+	}
+
+	printf("%f\n", sum(a, 5));
+	for (i = 0; i < 4; ++i) {
+		printf("%f %lu\n", to_float(b[i]), from_double((double) b[i]));
+	}
+
+	for (i = 0; i < 3; ++i) {
+		printf("%u\n", from_float(f + i));
+	}
+
+	return 0;
+}
@@ -0,0 +1,106 @@
+#include <stdarg.h>
+
+int printf(const char *, ...);
+
+struct s3 { char c[3]; };
+struct s12 { int a; short b; char c[6]; };
+struct s24 { long a, b, c; };
+struct s44 { int a[11]; };
+struct s128 { long a[16]; };
+struct s136 { char c[136]; };
+
+static struct s24 global;
+
+static long sum(const char *p, int n) {
+	long s = 0;
+	while (n--) {
+		s = s * 3 + *p++;
+	}
+
+	return s;
+}
+
+static struct s44 make(int n) {
+	struct s44 s;
+	int i;
+
+	for (i = 0; i < 11; ++i) {
+		s.a[i] = n + i;
+	}
+
+	return s;
+}
+
+static long args(struct s3 a, struct s44 b, struct s128 c, struct s136 d) {
+	return sum(a.c, 3) + b.a[10] + c.a[15] + sum(d.c, 136);
+}
+
+static long variadic(int n, ...) {
+	long s = 0;
+	struct s44 b;
+	va_list ap;
+
+	va_start(ap, n);
+	while (n--) {
+		b = va_arg(ap, struct s44);
+		s += b.a[0] + b.a[10];
+	}
+
+	va_end(ap);
+	return s;
+}
+
+static long copy(void) {
+	struct s24 a = {1, 2, 3}, b;
+	struct s12 c = {0}, d;
+	struct s3 e, f = {{7, 8, 9}};
+
+	b = a;
+	a.b = 10;
+	global = b;
+	c.c[5] = 4;
+	d = c;
+	e = f;
+	return a.b + b.b + global.c + d.c[5] + sum(e.c, 3);
+}
+
+static long clear(int n) {
+	int i;
+	long s = 0;
+	char buf[100] = {0};
+	double f[5] = {0, -0.0, 0};
+	struct s12 z[3] = {{1}, {0, 2}};
+
+	buf[n] = 1;
+	for (i = 0; i < 100; ++i) {
+		s = s * 3 + buf[i];
+	}
+
+	printf("%f %f %d %d\n", 1 / f[0], 1 / f[1], z[1].b, z[2].c[5]);
+	return s + z[0].a;
+}
+
+int main(void) {
+	int i;
+	struct s3 a = {{1, 2, 3}};
+	struct s44 b = make(5);
+	struct s128 c;
+	struct s136 d;
+	struct s12 z[3] = {{1}};
+
+	for (i = 0; i < 16; ++i) {
+		c.a[i] = i * i;
+	}
+
+	for (i = 0; i < 136; ++i) {
+		d.c[i] = (char) i;
+	}
+
+	printf("%ld\n", copy());
+	printf("%ld\n", args(a, b, c, d));
+	printf("%ld\n", variadic(2, make(1), make(2)));
+	b = make(3);
+	printf("%d %d %d\n", b.a[10], z[1].a, z[2].c[5]);
+	printf("%ld\n", clear(97));
+	return 0;
+}
@@ -0,0 +1,44 @@
+int printf(const char *, ...);
+
+static double scale(double x) {
+	return x / 4.0 / 0.5;
+}
+
+static float offset(float x) {
+	return x + 1.5f + 2.0f - 0.5f;
+}
+
+static double product(double x, int n) {
+	return 3.0 * (x * 2.0) * n;
+}
+
+static int compare(double a, double b) {
+	int n = 0;
+	if (a == b) n += 1;
+	if (a != b) n += 2;
+	if (a < b) n += 4;
+	if (a >= b) n += 8;
+	return n + (a == b) * 16 + (a != b) * 32;
+}
+
+static double select(double a, double b) {
+	double c = 0.0;
+	if (a != b) {
+		c = a;
+	}
+
+	return c;
+}
+
+static int truth(double x) {
+	return x ? 1 : 2;
+}
+
+int main(void) {
+	printf("%f %f %f\n", scale(10.0), offset(2.0f), product(1.5, 3));
+	printf("%d %d %d\n", compare(1.0, 2.0), compare(2.0, 2.0), compare(3.0, 2.0));
+	printf("%f %f\n", select(1.0, 2.0), select(2.0, 2.0));
+	printf("%d %d\n", truth(0.0), truth(0.25));
+	printf("%f\n", 7.0 / 3.0);
+	return 0;
+}
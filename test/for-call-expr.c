@@ -0,0 +1,40 @@
+int printf(const char *, ...);
+
+static int calls;
+
+static int step(int n) {
+	calls += n;
+	return calls;
+}
+
+static int skip(const char *s) {
+	int depth, i = 0;
+
+	for (depth = 1; depth; step(1), i++) {
+		if (s[i] == '(') {
+			depth++;
+		} else if (s[i] == ')') {
+			depth--;
+		}
+	}
+
+	return i;
+}
+
+int main(void) {
+	int i;
+
+	for (step(10); calls < 15; step(2)) {
+		if (calls == 12)
+			continue;
+	}
+
+	printf("%d\n", calls);
+	for (i = 0; i < 3 && step(1); i++ && step(100))
+		;
+
+	printf("%d %d\n", calls, i);
+	i = skip("a(b)c)d");
+	printf("%d %d\n", i, calls);
+	return 0;
+}
@@ -0,0 +1,41 @@
+int printf(const char *, ...);
+
+static int count(int *n) {
+	return (*n)++;
+}
+
+static int test(int a, int b, int c) {
+	int n = 0;
+
+	if (a && b)
+		n += 1;
+	if (a || b)
+		n += 2;
+	if (!(a && b) || c)
+		n += 4;
+	if (a && (b || c) && !(a && c))
+		n += 8;
+	while (a > 0 && (b || c)) {
+		a--;
+		n += 16;
+	}
+	if ((a && b) == 0)
+		n += 32;
+	return n ? n : 64;
+}
+
+int main(void) {
+	int i, j, k, n = 0, r = 0;
+
+	for (i = 0; i < 3; ++i)
+		for (j = 0; j < 2; ++j)
+			for (k = 0; k < 2; ++k)
+				r += printf("%d %d %d: %d\n", i, j, k, test(i, j, k));
+
+	if (count(&n) || count(&n))
+		r += 1;
+	if (count(&n) && count(&n))
+		r += 1;
+	r = r + (i && j) - (k || n);
+	return printf("%d %d\n", n, r);
+}
@@ -0,0 +1,98 @@
+int printf(const char *, ...);
+
+union number {
+	long l;
+	double d;
+	unsigned char b[8];
+};
+
+long global;
+
+static void bump(void) {
+	global += 10;
+}
+
+static long through_pointer(long *p) {
+	long a, b;
+
+	a = global;
+	*p = 7;
+	b = global;
+	return a * 100 + b;
+}
+
+static long after_call(void) {
+	long a, b;
+
+	global = 1;
+	a = global;
+	bump();
+	b = global;
+	return a + b;
+}
+
+static long partial(void) {
+	union number n;
+	unsigned char *c;
+	long before;
+
+	n.l = 0x0102030405060708;
+	before = n.l;
+	c = n.b;
+	c[0] = 0xff;
+	return (before & 0xff) + (n.l & 0xff);
+}
+
+static double mixed(double x) {
+	union number n;
+	long l;
+
+	n.d = x;
+	l = n.l;
+	n.l = l ^ 0x8000000000000000;
+	return n.d + x;
+}
+
+static long loop(long *p, long n) {
+	long i, s = 0;
+
+	for (i = 0; i < n; ++i) {
+		s += p[i];
+		p[i] = s;
+		s += p[i];
+	}
+
+	return s + p[n - 1];
+}
+
+static unsigned long widen(unsigned u, long l) {
+	unsigned long a, b;
+
+	a = u;
+	l = l + u;
+	b = u;
+	return a + b + (unsigned long) l;
+}
+
+static double real(float *f, double d) {
+	double a;
+
+	a = *f;
+	*f = (float) (d * 2);
+	return a + *f + d;
+}
+
+int main(void) {
+	long a[4] = {1, 2, 3, 4};
+	float f = 1.5f;
+
+	global = 3;
+	printf("%ld\n", through_pointer(&global));
+	printf("%ld\n", after_call());
+	printf("%ld\n", partial());
+	printf("%f\n", mixed(2.5));
+	printf("%ld\n", loop(a, 4));
+	printf("%lu\n", widen(4000000000u, -1));
+	printf("%f\n", real(&f, 3.0));
+	return 0;
+}
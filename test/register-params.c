@@ -0,0 +1,134 @@
+#include <stdarg.h>
+
+int printf(const char *, ...);
+
+struct big {
+	long a, b, c;
+};
+
+struct flags {
+	unsigned kind : 7;
+	unsigned slot : 6;
+	unsigned mark : 3;
+};
+
+static int count(int n) {
+	int k = 0;
+	while (n--) {
+		k += n;
+	}
+
+	return k + n;
+}
+
+static int narrow(char c, short s, unsigned char u) {
+	c += 1;
+	s = s * 2 + c;
+	u -= 3;
+	return c + s + u;
+}
+
+static int inplace(int a, int b, int c) {
+	c += a;
+	b -= c;
+	return b * 100 + c;
+}
+
+static long assign(long a, long b, signed char c, short d) {
+	if (a > 2) {
+		c = -8;
+		d = -300;
+	}
+
+	d = d + c;
+	c = c - d;
+	return c + d + a + b;
+}
+
+static long walk(const long *p, unsigned n, long scale) {
+	long s = 0;
+	while (n) {
+		s += *p++ * scale;
+		n -= 1;
+	}
+
+	return s;
+}
+
+static int identity(int x) {
+	return x;
+}
+
+static int across(int a, int b, int c, int d, int e, int f) {
+	int s = identity(a) + identity(b);
+	s += identity(c) * d;
+	s -= identity(e) + f;
+	return s + a * f;
+}
+
+static int address(int x) {
+	int *p = &x;
+	*p += 5;
+	return x;
+}
+
+static int field(struct flags *f, int n) {
+	f->slot = ++n;
+	f->mark = n;
+	return n;
+}
+
+static int compare(int a, int b) {
+	int n = 0;
+	if (a < b) n += 1;
+	if (a == b) n += 2;
+	if (b > 10) n += 4;
+	return n;
+}
+
+static long variadic(int n, ...) {
+	long s = 0;
+	va_list args;
+
+	va_start(args, n);
+	while (n-- > 0) {
+		s += va_arg(args, long);
+		s += (long) va_arg(args, double);
+	}
+
+	va_end(args);
+	return s;
+}
+
+static struct big make(int n, ...) {
+	struct big b;
+	va_list args;
+
+	va_start(args, n);
+	b.a = n;
+	b.b = va_arg(args, long);
+	b.c = n + va_arg(args, int);
+	va_end(args);
+	return b;
+}
+
+int main(void) {
+	long a[] = {1, 2, 3, 4, 5};
+	struct big b;
+	struct flags f = {0};
+
+	printf("%d\n", count(10));
+	printf("%d\n", narrow(127, 1000, 1));
+	printf("%d\n", inplace(4, 3, 2));
+	printf("%ld %ld\n", assign(1, 2, 3, 4), assign(5, 6, 7, 8));
+	printf("%ld\n", walk(a, 5, 3));
+	printf("%d\n", across(1, 2, 3, 4, 5, 6));
+	printf("%d\n", address(7));
+	printf("%d\n", field(&f, 10));
+	printf("%d %d %d\n", f.kind, f.slot, f.mark);
+	printf("%d\n", compare(3, 12));
+	printf("%ld\n", variadic(2, 10L, 2.5, 20L, 3.5));
+	b = make(4, 8L, 9);
+	printf("%ld %ld %ld\n", b.a, b.b, b.c);
+	return 0;
+}
@@ -0,0 +1,52 @@
+#include <setjmp.h>
+
+int printf(const char *, ...);
+
+static jmp_buf env;
+
+static void jump(int n) {
+	if (n) {
+		longjmp(env, n);
+	}
+}
+
+static int sum(int n) {
+	int i, s = 0;
+
+	for (i = 0; i < n; ++i) {
+		s += i;
+	}
+
+	return s;
+}
+
+static int run(int n) {
+	int i, a = 13;
+
+	if (setjmp(env)) {
+		return a;
+	}
+
+	for (i = 0; i < n; ++i) {
+		printf("i = %d\n", i);
+	}
+
+	if (n > 1) {
+		int b = 33;
+		printf("b = %d\n", b);
+		jump(b);
+	}
+
+	jump(n);
+	return 0;
+}
+
+int main(void) {
+	int a, b;
+
+	printf("%d\n", sum(5));
+	a = run(1);
+	b = run(2);
+	printf("%d %d\n", a, b);
+	return 0;
+}
@@ -0,0 +1,111 @@
+int printf(const char *, ...);
+
+struct pair {
+	char a, b, c;
+};
+
+static struct pair make(char a) {
+	struct pair p;
+
+	p.a = a;
+	p.b = a + 1;
+	p.c = a + 2;
+	return p;
+}
+
+static int touch(int *p) {
+	return *p += 1;
+}
+
+static long sequence(int n) {
+	long total = 0;
+
+	if (n > 0) {
+		char c = 3;
+		short s = 400;
+		total += c * s;
+	}
+
+	if (n > 1) {
+		long l = 5000000000;
+		total += l / 1000;
+	}
+
+	if (n > 2) {
+		double d = 1.25;
+		total += (long) (d * 8);
+	}
+
+	return total;
+}
+
+static int carried(int n) {
+	int i, prev = 0, sum = 0;
+
+	for (i = 0; i < n; ++i) {
+		int cur = i * i;
+		sum += cur - prev;
+		prev = cur;
+	}
+
+	return sum + prev;
+}
+
+static int pointers(int n) {
+	int a = 1, b = 2, *p = &a;
+
+	if (n) {
+		int c = 10;
+		p = &b;
+		c += touch(p);
+		n += c;
+	}
+
+	{
+		int d = 7;
+		n += d + *p;
+	}
+
+	return n + a + b;
+}
+
+static int structs(int n) {
+	struct pair x, y;
+	int i, s = 0;
+
+	for (i = 0; i < n; ++i) {
+		x = make('a' + i);
+		s += x.a + x.b;
+		y = make('A' + i);
+		s += y.c + x.c;
+	}
+
+	return s;
+}
+
+static int mixed(int n) {
+	char a = 1;
+	long b = 2;
+	char c = 3;
+	int d = 4;
+	short e = 5;
+
+	while (n--) {
+		a += c;
+		b += d;
+		c += e;
+		d += a;
+		e += (short) b;
+	}
+
+	return a + (int) b + c + d + e;
+}
+
+int main(void) {
+	printf("%ld %ld\n", sequence(1), sequence(3));
+	printf("%d\n", carried(10));
+	printf("%d %d\n", pointers(0), pointers(1));
+	printf("%d\n", structs(4));
+	printf("%d\n", mixed(6));
+	return 0;
+}
@@ -0,0 +1,58 @@
+int printf(const char *, ...);
+
+static int sdiv(int x) {
+	return x / 8;
+}
+
+static long smod(long x) {
+	return x % 16;
+}
+
+static unsigned udiv(unsigned x) {
+	return x / 4;
+}
+
+static unsigned long umod(unsigned long x) {
+	return x % 32;
+}
+
+static int mul(int x) {
+	return x * 8 + 0 * x + (x | 0) * 1 + x * -1;
+}
+
+static int neg(int x) {
+	int y = -x;
+	return -y + ~(~x);
+}
+
+static int cmp(int x) {
+	return 5 == x || x >= 10 || x >= -2147483647 - 1;
+}
+
+static int identity(int x, int y) {
+	return (x & -1) + (y ^ 0) + (x - x) + (y << 0) + (x ^ x) + (y >> 0);
+}
+
+static long sdiv2(long x) {
+	return x / 2 + x / (1L << 40) + x % 2;
+}
+
+static int negative(int x) {
+	return x / -4 + x % -8;
+}
+
+int main(void) {
+	int v[] = {0, 1, -1, 7, -7, 8, -8, 9, -9, 15, -15, 16, -16,
+		2147483647, -2147483647 - 1};
+	int i;
+
+	for (i = 0; i < sizeof(v) / sizeof(v[0]); ++i) {
+		printf("%d %ld %u %lu\n",
+			sdiv(v[i]), smod(v[i]), udiv(v[i]), umod(v[i]));
+		printf("%d %d %d %d\n",
+			mul(v[i]), neg(v[i]), cmp(v[i]), identity(v[i], i));
+		printf("%ld %d\n", sdiv2((long) v[i] * 300000), negative(v[i]));
+	}
+
+	return 0;
+}
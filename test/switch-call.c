@@ -0,0 +1,32 @@
+int printf(const char *, ...);
+
+static int calls;
+
+static int next(int *p) {
+	calls++;
+	return (*p)++;
+}
+
+int main(void) {
+	int i = 0, n = 0, r = 0;
+
+	while (n < 8) {
+		switch (next(&n) % 4) {
+		case 0:
+			r += 1;
+			break;
+		case 1:
+			r += 10;
+		case 2:
+			r += 100;
+			break;
+		default:
+			r += 1000;
+		}
+	}
+
+	switch (next(&i)) {
+	}
+
+	return printf("%d %d %d %d\n", i, n, r, calls);
+}
@@ -0,0 +1,116 @@
+int printf(const char *, ...);
+
+static int calls;
+
+static int next(int n) {
+	calls++;
+	return n + 1;
+}
+
+static int classify(int n, int m) {
+	int k = n * m;
+
+	if (n < 0) {
+		return -1;
+	}
+
+	if (k > 100) {
+		k -= n;
+		if (m > 10) {
+			return -1;
+		}
+		return k;
+	} else if (k > 10) {
+		k += m;
+		if (n == m) {
+			return -1;
+		}
+		return k;
+	}
+
+	return n + m;
+}
+
+static long branches(long a, int c) {
+	long r;
+
+	if (c & 1) {
+		a += 3;
+		r = a * 2;
+		a = next(r);
+	} else if (c & 2) {
+		a -= 3;
+		r = a * 2;
+		a = next(r);
+	} else {
+		a ^= 5;
+		r = a * 2;
+		a = next(r);
+	}
+
+	return a + r;
+}
+
+static int same(int a, int b) {
+	int r;
+
+	if (a > b) {
+		r = a - b;
+		r *= 2;
+	} else {
+		r = a - b;
+		r *= 2;
+	}
+
+	return r;
+}
+
+static int loop(const int *p, int n) {
+	int i, s = 0, t = 0;
+
+	for (i = 0; i < n; ++i) {
+		if (p[i] > 0) {
+			s += p[i];
+			t = s + i;
+		} else {
+			s -= p[i];
+			t = s + i;
+		}
+	}
+
+	return s + t;
+}
+
+static void record(int *out, int n) {
+	if (n > 2) {
+		out[0] = n;
+		out[1] = 7;
+		return;
+	}
+
+	if (n < -2) {
+		out[0] = -n;
+		out[1] = 7;
+		return;
+	}
+
+	out[1] = 7;
+}
+
+int main(void) {
+	int a[] = {1, -2, 3, -4, 5};
+	int out[2] = {0};
+
+	printf("%d %d %d\n", classify(-3, 1), classify(20, 11), classify(20, 2));
+	printf("%d %d %d\n", classify(4, 4), classify(4, 3), classify(1, 2));
+	printf("%ld %ld %ld\n", branches(1, 1), branches(1, 2), branches(1, 4));
+	printf("%d %d %d\n", same(5, 2), same(2, 5), calls);
+	printf("%d\n", loop(a, 5));
+	record(out, 3);
+	printf("%d %d\n", out[0], out[1]);
+	record(out, -5);
+	printf("%d %d\n", out[0], out[1]);
+	record(out, 0);
+	printf("%d %d\n", out[0], out[1]);
+	return 0;
+}
@@ -0,0 +1,43 @@
+#include <stdio.h>
+
+#ifdef __attribute__
+# define ATTRIBUTE_MACRO 1
+#else
+# define ATTRIBUTE_MACRO 0
+#endif
+
+__attribute__((visibility("hidden"))) int counter;
+
+int total __attribute__((__visibility__("hidden"))) = 10;
+
+int add(int a, int b) __attribute__((visibility("hidden")));
+
+__attribute__((visibility("protected"))) void bump(int n) {
+	counter += n;
+	total = add(total, n);
+}
+
+int add(int a, int b) {
+	return a + b;
+}
+
+#define __attribute__(x)
+
+#ifdef __attribute__
+# define USER_ATTRIBUTE_MACRO 1
+#else
+# define USER_ATTRIBUTE_MACRO 0
+#endif
+
+struct packed {
+	char c;
+	int i;
+} __attribute__((packed));
+
+int main(void) {
+	bump(3);
+	bump(4);
+	printf("%d %d %d\n", counter, total, ATTRIBUTE_MACRO);
+	printf("%d %lu\n", USER_ATTRIBUTE_MACRO, sizeof(struct packed));
+	return ATTRIBUTE_MACRO || !USER_ATTRIBUTE_MACRO;
+}
@@ -0,0 +1,44 @@
+int printf(const char *, ...);
+
+__attribute__((visibility("hidden"))) int counter;
+
+int total __attribute__((__visibility__("hidden"))) = 10;
+
+static int local = 3;
+
+extern int shared_value __attribute__((visibility("hidden")));
+
+int __attribute__((visibility("default"))) exported = 7;
+
+int shared_value = 5;
+
+struct point {
+	int x, y;
+};
+
+__attribute__((visibility("hidden"))) struct point origin = {1, 2};
+
+int add(int a, int b) __attribute__((visibility("hidden")));
+
+__attribute__((visibility("protected"))) int scale(int n) {
+	return n * exported;
+}
+
+__attribute__((visibility("internal"))) void bump(int n) {
+	counter += n;
+	total += add(n, local);
+}
+
+int add(int a, int b) {
+	return a + b;
+}
+
+int main(void) {
+	int (*fp)(int, int) = add;
+
+	bump(4);
+	bump(scale(2));
+	printf("%d %d %d\n", counter, total, shared_value);
+	printf("%d %d %d\n", fp(origin.x, origin.y), scale(3), exported);
+	return 0;
+}